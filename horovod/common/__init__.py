@@ -19,6 +19,33 @@ import os
 import sysconfig
 import atexit
 
+# Reduction operations of allreduce, with the values of ReduceOp in
+# horovod/common/mpi_message.h. Bitwise operations only apply to integer
+# tensors.
+Sum = 0
+Min = 1
+Max = 2
+Product = 3
+BitwiseAnd = 4
+BitwiseOr = 5
+BitwiseXor = 6
+
+
+def resolve_reduce_op(average, op):
+    """Returns whether to average and the reduction operation of an allreduce.
+
+    Averaging is the default for sums, and only applies to sums.
+    """
+    if op is None:
+        op = Sum
+    if op not in (Sum, Min, Max, Product, BitwiseAnd, BitwiseOr, BitwiseXor):
+        raise ValueError('Unknown reduction operation: %s.' % op)
+    if average is None:
+        average = op == Sum
+    if average and op != Sum:
+        raise ValueError('Only sums can be averaged, pass average=False.')
+    return average, op
+
 
 def get_ext_suffix():
     """Determine library extension for various versions of Python."""
@@ -152,3 +179,73 @@ class HorovodBasics(object):
             raise ValueError(
                 'Horovod has not been initialized; use hvd.init().')
         return bool(mpi_threads_supported)
+
+    def gpu_allreduce_built(self):
+        """A function that returns a flag indicating whether allreduces of GPU tensors are
+        performed on the GPU, as built with HOROVOD_GPU_ALLREDUCE.
+
+        Returns:
+          A boolean value indicating whether GPU allreduces were built.
+        """
+        return bool(self.MPI_LIB_CTYPES.horovod_gpu_allreduce_built())
+
+    def collective_algorithm(self, op, dtype, num_bytes, device='cpu'):
+        """A function that returns the algorithm that performs a collective operation.
+
+        The algorithm is chosen by the first rule of `HOROVOD_ALGORITHMS` or
+        `HOROVOD_ALGORITHMS_FILE` that matches the operation, followed by the rules
+        of the other knobs that choose algorithms, such as `HOROVOD_RING_ALLREDUCE`.
+
+        Arguments:
+            op: The operation, one of 'allreduce', 'allgather' or 'broadcast'.
+            dtype: The name of the data type, such as 'float32'.
+            num_bytes: The size of the operation in bytes, after Tensor Fusion.
+            device: 'cpu' for tensors in host memory, or 'gpu'.
+
+        Returns:
+          The name of the algorithm, or 'default' if no rule matches.
+        """
+        self.MPI_LIB_CTYPES.horovod_collective_algorithm.restype = ctypes.c_char_p
+        algorithm = self.MPI_LIB_CTYPES.horovod_collective_algorithm(
+            op.encode(), device.encode(), dtype.encode(),
+            ctypes.c_longlong(num_bytes))
+        if algorithm is None:
+            if self.MPI_LIB_CTYPES.horovod_rank() == -1:
+                raise ValueError(
+                    'Horovod has not been initialized; use hvd.init().')
+            raise ValueError('Unknown operation, data type or device: %s, %s, %s.'
+                             % (op, dtype, device))
+        return algorithm.decode()
+
+    def collective_algorithm_rules(self):
+        """A function that returns the rules that choose collective algorithms.
+
+        Returns:
+          A string with one rule per line, in the format of `HOROVOD_ALGORITHMS`.
+        """
+        self.MPI_LIB_CTYPES.horovod_collective_algorithm_rules.restype = \
+            ctypes.c_char_p
+        rules = self.MPI_LIB_CTYPES.horovod_collective_algorithm_rules()
+        if rules is None:
+            raise ValueError(
+                'Horovod has not been initialized; use hvd.init().')
+        return rules.decode()
+
+    def set_collective_algorithm_rules(self, rules):
+        """A function that replaces the rules that choose collective algorithms.
+
+        The rules replace those of `HOROVOD_ALGORITHMS` and of the other knobs
+        that choose algorithms. All processes must set the same rules while no
+        collective operations are outstanding, and operations submitted
+        afterwards use them.
+
+        Arguments:
+            rules: A string of rules in the format of `HOROVOD_ALGORITHMS`.
+        """
+        result = self.MPI_LIB_CTYPES.horovod_set_collective_algorithm_rules(
+            rules.encode())
+        if result == -1:
+            raise ValueError(
+                'Horovod has not been initialized; use hvd.init().')
+        if result == 0:
+            raise ValueError('Invalid algorithm rules: %s' % rules)
@@ -0,0 +1,250 @@
+// Copyright 2018 Uber Technologies, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+#include "algorithm_registry.h"
+
+namespace horovod {
+namespace common {
+
+namespace {
+
+// Algorithms implemented for each type of operation.
+const std::vector<std::string> ALLREDUCE_ALGORITHMS = {
+    DEFAULT_ALGORITHM, "ring", "recursive_doubling", "pipelined",
+    "hierarchical"};
+const std::vector<std::string> ALLGATHER_ALGORITHMS = {DEFAULT_ALGORITHM};
+const std::vector<std::string> BROADCAST_ALGORITHMS = {DEFAULT_ALGORITHM};
+
+bool IsKnownAlgorithm(const std::vector<std::string>& algorithms,
+                      const std::string& algorithm) {
+  return std::find(algorithms.begin(), algorithms.end(), algorithm) !=
+         algorithms.end();
+}
+
+// Parses a range "min-max", where either bound may be left out.
+template <typename T>
+bool ParseRange(const std::string& value, T* min, T* max) {
+  auto dash = value.find('-');
+  if (dash == std::string::npos) {
+    return false;
+  }
+  auto parse = [](const std::string& bound, T* result) {
+    if (bound.empty()) {
+      return true;
+    }
+    char* end;
+    auto parsed = std::strtoll(bound.c_str(), &end, 10);
+    if (*end != '\0' || parsed < 0) {
+      return false;
+    }
+    *result = (T)parsed;
+    return true;
+  };
+  return parse(value.substr(0, dash), min) &&
+         parse(value.substr(dash + 1), max);
+}
+
+Status ParseRule(const std::string& text, AlgorithmRule* rule) {
+  std::istringstream fields(text);
+  std::string field;
+  while (fields >> field) {
+    auto equals = field.find('=');
+    if (equals == std::string::npos) {
+      return Status::InvalidArgument("Expected key=value, got " + field + ".");
+    }
+    auto key = field.substr(0, equals);
+    auto value = field.substr(equals + 1);
+    if (key == "op") {
+      MPIResponse::ResponseType op;
+      if (!ParseResponseType(value, &op)) {
+        return Status::InvalidArgument("Unknown operation " + value + ".");
+      }
+      rule->op = op;
+    } else if (key == "device") {
+      if (value != "cpu" && value != "gpu") {
+        return Status::InvalidArgument("Unknown device " + value + ".");
+      }
+      rule->gpu = value == "gpu";
+    } else if (key == "dtype") {
+      MPIDataType dtype;
+      if (!ParseDataType(value, &dtype)) {
+        return Status::InvalidArgument("Unknown data type " + value + ".");
+      }
+      rule->dtype = dtype;
+    } else if (key == "bytes") {
+      if (!ParseRange(value, &rule->min_bytes, &rule->max_bytes)) {
+        return Status::InvalidArgument("Invalid byte range " + value + ".");
+      }
+    } else if (key == "ranks") {
+      if (!ParseRange(value, &rule->min_ranks, &rule->max_ranks)) {
+        return Status::InvalidArgument("Invalid rank range " + value + ".");
+      }
+    } else if (key == "algorithm") {
+      rule->algorithm = value;
+    } else {
+      return Status::InvalidArgument("Unknown key " + key + ".");
+    }
+  }
+
+  if (rule->algorithm.empty()) {
+    return Status::InvalidArgument("Rule \"" + text +
+                                   "\" does not name an algorithm.");
+  }
+  bool known;
+  switch (rule->op) {
+  case MPIResponse::ALLREDUCE:
+    known = IsKnownAlgorithm(ALLREDUCE_ALGORITHMS, rule->algorithm);
+    break;
+  case MPIResponse::ALLGATHER:
+    known = IsKnownAlgorithm(ALLGATHER_ALGORITHMS, rule->algorithm);
+    break;
+  case MPIResponse::BROADCAST:
+    known = IsKnownAlgorithm(BROADCAST_ALGORITHMS, rule->algorithm);
+    break;
+  default:
+    known = IsKnownAlgorithm(ALLREDUCE_ALGORITHMS, rule->algorithm) ||
+            IsKnownAlgorithm(ALLGATHER_ALGORITHMS, rule->algorithm) ||
+            IsKnownAlgorithm(BROADCAST_ALGORITHMS, rule->algorithm);
+  }
+  if (!known) {
+    return Status::InvalidArgument("Unknown algorithm " + rule->algorithm +
+                                   ".");
+  }
+  return Status::OK();
+}
+
+} // namespace
+
+bool ParseResponseType(const std::string& name,
+                       MPIResponse::ResponseType* op) {
+  for (auto candidate : {MPIResponse::ALLREDUCE, MPIResponse::ALLGATHER,
+                         MPIResponse::BROADCAST}) {
+    auto candidate_name = MPIResponse::ResponseType_Name(candidate);
+    std::transform(candidate_name.begin(), candidate_name.end(),
+                   candidate_name.begin(), ::tolower);
+    if (name == candidate_name) {
+      *op = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ParseDataType(const std::string& name, MPIDataType* dtype) {
+  for (int candidate = HOROVOD_UINT8; candidate <= HOROVOD_BFLOAT16;
+       candidate++) {
+    if (name == MPIDataType_Name((MPIDataType)candidate)) {
+      *dtype = (MPIDataType)candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+void AlgorithmRegistry::clear() { rules_.clear(); }
+
+Status AlgorithmRegistry::Parse(const std::string& spec) {
+  std::vector<AlgorithmRule> rules;
+  std::istringstream lines(spec);
+  std::string line;
+  while (std::getline(lines, line)) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream texts(line);
+    std::string text;
+    while (std::getline(texts, text, ';')) {
+      if (text.find_first_not_of(" \t\r") == std::string::npos) {
+        continue;
+      }
+      AlgorithmRule rule;
+      auto status = ParseRule(text, &rule);
+      if (!status.ok()) {
+        return status;
+      }
+      rules.push_back(rule);
+    }
+  }
+  rules_.insert(rules_.end(), rules.begin(), rules.end());
+  return Status::OK();
+}
+
+void AlgorithmRegistry::Add(const AlgorithmRule& rule) {
+  rules_.push_back(rule);
+}
+
+const std::string& AlgorithmRegistry::Lookup(MPIResponse::ResponseType op,
+                                             bool gpu, MPIDataType dtype,
+                                             int64_t bytes, int ranks) const {
+  for (auto& rule : rules_) {
+    if ((rule.op == -1 || rule.op == op) &&
+        (rule.gpu == -1 || rule.gpu == (int)gpu) &&
+        (rule.dtype == -1 || rule.dtype == dtype) && bytes >= rule.min_bytes &&
+        bytes < rule.max_bytes && ranks >= rule.min_ranks &&
+        ranks <= rule.max_ranks) {
+      return rule.algorithm;
+    }
+  }
+  static const std::string default_algorithm(DEFAULT_ALGORITHM);
+  return default_algorithm;
+}
+
+bool AlgorithmRegistry::Uses(const std::string& algorithm) const {
+  for (auto& rule : rules_) {
+    if (rule.algorithm == algorithm) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string AlgorithmRegistry::ToString() const {
+  std::stringstream ss;
+  for (auto& rule : rules_) {
+    if (rule.op != -1) {
+      auto name =
+          MPIResponse::ResponseType_Name((MPIResponse::ResponseType)rule.op);
+      std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+      ss << "op=" << name << " ";
+    }
+    if (rule.gpu != -1) {
+      ss << "device=" << (rule.gpu ? "gpu" : "cpu") << " ";
+    }
+    if (rule.dtype != -1) {
+      ss << "dtype=" << MPIDataType_Name((MPIDataType)rule.dtype) << " ";
+    }
+    if (rule.min_bytes != 0 || rule.max_bytes != INT64_MAX) {
+      ss << "bytes=" << rule.min_bytes << "-";
+      if (rule.max_bytes != INT64_MAX) {
+        ss << rule.max_bytes;
+      }
+      ss << " ";
+    }
+    if (rule.min_ranks != 1 || rule.max_ranks != INT_MAX) {
+      ss << "ranks=" << rule.min_ranks << "-";
+      if (rule.max_ranks != INT_MAX) {
+        ss << rule.max_ranks;
+      }
+      ss << " ";
+    }
+    ss << "algorithm=" << rule.algorithm << std::endl;
+  }
+  return ss.str();
+}
+
+} // namespace common
+} // namespace horovod
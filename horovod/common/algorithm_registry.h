@@ -0,0 +1,97 @@
+// Copyright 2018 Uber Technologies, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#ifndef HOROVOD_ALGORITHM_REGISTRY_H
+#define HOROVOD_ALGORITHM_REGISTRY_H
+
+#include <climits>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "mpi_message.h"
+
+namespace horovod {
+namespace common {
+
+// Algorithm used when no rule matches: MPI on CPU, NCCL or MPI on GPU.
+#define DEFAULT_ALGORITHM "default"
+
+// A rule of the algorithm registry. It matches collective operations of a
+// type, on a device and of a data type, whose size in bytes is in
+// [min_bytes, max_bytes), on [min_ranks, max_ranks] ranks. Criteria that are
+// not given match everything.
+struct AlgorithmRule {
+  // Response type, or -1 for any.
+  int op = -1;
+  // Whether tensors are on GPU, or -1 for any device.
+  int gpu = -1;
+  // Data type, or -1 for any.
+  int dtype = -1;
+  int64_t min_bytes = 0;
+  int64_t max_bytes = INT64_MAX;
+  int min_ranks = 1;
+  int max_ranks = INT_MAX;
+  std::string algorithm;
+};
+
+// Maps collective operations to the algorithm that performs them. Every rank
+// must hold the same rules, so that all ranks choose the same algorithm for a
+// response.
+class AlgorithmRegistry {
+public:
+  void clear();
+
+  // Parses rules and appends them to the registry. Rules are separated by
+  // semicolons or new lines, and text after a # is ignored. Every rule is a
+  // list of whitespace-separated key=value fields, for example:
+  //
+  //   op=allreduce device=cpu dtype=float32 bytes=0-65536 ranks=2-64
+  //   algorithm=recursive_doubling
+  //
+  // All fields but algorithm are optional. Byte ranges exclude the upper
+  // bound, rank ranges include it, and either bound may be left out. No rules
+  // are appended if any rule is invalid.
+  Status Parse(const std::string& spec);
+
+  void Add(const AlgorithmRule& rule);
+
+  // Returns the algorithm of the first rule that matches the operation, or
+  // DEFAULT_ALGORITHM if none does.
+  const std::string& Lookup(MPIResponse::ResponseType op, bool gpu,
+                            MPIDataType dtype, int64_t bytes,
+                            int ranks) const;
+
+  // Whether any rule uses the algorithm.
+  bool Uses(const std::string& algorithm) const;
+
+  // Returns the rules in the format accepted by Parse(), one per line.
+  std::string ToString() const;
+
+private:
+  std::vector<AlgorithmRule> rules_;
+};
+
+// Parses the lowercase name of a response type or data type, as used in
+// rules. Returns false if the name is unknown.
+bool ParseResponseType(const std::string& name,
+                       MPIResponse::ResponseType* op);
+bool ParseDataType(const std::string& name, MPIDataType* dtype);
+
+} // namespace common
+} // namespace horovod
+
+#endif // HOROVOD_ALGORITHM_REGISTRY_H
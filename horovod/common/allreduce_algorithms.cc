@@ -0,0 +1,269 @@
+// Copyright 2018 Uber Technologies, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include <algorithm>
+#include <climits>
+
+#include "allreduce_algorithms.h"
+#include "reduction_pool.h"
+
+namespace horovod {
+namespace common {
+
+namespace {
+
+int ElementSize(MPIDataType dtype) {
+  switch (dtype) {
+  case HOROVOD_UINT8:
+  case HOROVOD_INT8:
+  case HOROVOD_BOOL:
+    return 1;
+  case HOROVOD_UINT16:
+  case HOROVOD_INT16:
+  case HOROVOD_FLOAT16:
+  case HOROVOD_BFLOAT16:
+    return 2;
+  case HOROVOD_INT32:
+  case HOROVOD_FLOAT32:
+    return 4;
+  default:
+    return 8;
+  }
+}
+
+} // namespace
+
+bool AllreduceAlgorithmsSupported(MPIDataType dtype, ReduceOp op) {
+  return GetReductionKernel(op, dtype) != nullptr;
+}
+
+void ReduceInto(MPIDataType dtype, ReduceOp op, void* dst, const void* src,
+                int64_t count) {
+  GlobalReductionPool().Reduce(GetReductionKernel(op, dtype), dst, src, count,
+                               ElementSize(dtype));
+}
+
+int RingAllreduce(void* buffer, int64_t count, MPIDataType dtype, ReduceOp op,
+                  MPI_Comm comm, int64_t segment_size,
+                  std::vector<uint8_t>& scratch) {
+  int rank, size;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &size);
+  if (size == 1 || count == 0) {
+    return MPI_SUCCESS;
+  }
+
+  auto data = (uint8_t*)buffer;
+  int64_t element_size = ElementSize(dtype);
+  int left = (rank - 1 + size) % size;
+  int right = (rank + 1) % size;
+
+  // The buffer is split into one block per rank. The first count % size
+  // blocks hold one element more than the others.
+  auto block_begin = [count, size](int block) {
+    return block * (count / size) + std::min((int64_t)block, count % size);
+  };
+  auto block_count = [&block_begin](int block) {
+    return block_begin(block + 1) - block_begin(block);
+  };
+  int64_t segment_count =
+      std::max(std::min(segment_size, (int64_t)INT_MAX) / element_size,
+               (int64_t)1);
+  auto num_segments = [segment_count](int64_t elements) {
+    return (int)((elements + segment_count - 1) / segment_count);
+  };
+  auto segment_bytes = [segment_count, element_size](int64_t elements,
+                                                     int segment) {
+    return (int)(std::min(segment_count,
+                          elements - segment * segment_count) *
+                 element_size);
+  };
+  if (scratch.size() < (size_t)(block_count(0) * element_size)) {
+    scratch.resize((size_t)(block_count(0) * element_size));
+  }
+
+  // Reduce-scatter. In every step, a rank sends the block it reduced in the
+  // previous step to the right and reduces the block received from the left.
+  // After size - 1 steps, every rank holds the reduction of block rank + 1.
+  std::vector<MPI_Request> send_requests;
+  std::vector<MPI_Request> recv_requests;
+  for (int step = 0; step < size - 1; step++) {
+    int send_block = (rank - step + size) % size;
+    int recv_block = (rank - step - 1 + size) % size;
+    auto send_data = data + block_begin(send_block) * element_size;
+    auto recv_data = data + block_begin(recv_block) * element_size;
+    int64_t send_count = block_count(send_block);
+    int64_t recv_count = block_count(recv_block);
+
+    recv_requests.resize((size_t)num_segments(recv_count));
+    for (int i = 0; i < (int)recv_requests.size(); i++) {
+      int result = MPI_Irecv(scratch.data() + i * segment_count * element_size,
+                             segment_bytes(recv_count, i), MPI_BYTE, left,
+                             ALLREDUCE_ALGORITHMS_TAG, comm, &recv_requests[i]);
+      if (result != MPI_SUCCESS) {
+        return result;
+      }
+    }
+    send_requests.resize((size_t)num_segments(send_count));
+    for (int i = 0; i < (int)send_requests.size(); i++) {
+      int result = MPI_Isend(send_data + i * segment_count * element_size,
+                             segment_bytes(send_count, i), MPI_BYTE, right,
+                             ALLREDUCE_ALGORITHMS_TAG, comm, &send_requests[i]);
+      if (result != MPI_SUCCESS) {
+        return result;
+      }
+    }
+
+    // Reduce every segment as soon as it is received, while the following
+    // segments are still in transit.
+    for (int i = 0; i < (int)recv_requests.size(); i++) {
+      int result = MPI_Wait(&recv_requests[i], MPI_STATUS_IGNORE);
+      if (result != MPI_SUCCESS) {
+        return result;
+      }
+      int64_t offset = i * segment_count;
+      ReduceInto(dtype, op, recv_data + offset * element_size,
+                 scratch.data() + offset * element_size,
+                 std::min(segment_count, recv_count - offset));
+    }
+    int result = MPI_Waitall((int)send_requests.size(), send_requests.data(),
+                             MPI_STATUSES_IGNORE);
+    if (result != MPI_SUCCESS) {
+      return result;
+    }
+  }
+
+  // Allgather. In every step, a rank sends the last block it completed to the
+  // right and receives the next one from the left, directly into the buffer.
+  for (int step = 0; step < size - 1; step++) {
+    int send_block = (rank - step + 1 + size) % size;
+    int recv_block = (rank - step + size) % size;
+    auto send_data = data + block_begin(send_block) * element_size;
+    auto recv_data = data + block_begin(recv_block) * element_size;
+    int64_t send_count = block_count(send_block);
+    int64_t recv_count = block_count(recv_block);
+
+    recv_requests.resize((size_t)num_segments(recv_count));
+    for (int i = 0; i < (int)recv_requests.size(); i++) {
+      int result = MPI_Irecv(recv_data + i * segment_count * element_size,
+                             segment_bytes(recv_count, i), MPI_BYTE, left,
+                             ALLREDUCE_ALGORITHMS_TAG, comm, &recv_requests[i]);
+      if (result != MPI_SUCCESS) {
+        return result;
+      }
+    }
+    send_requests.resize((size_t)num_segments(send_count));
+    for (int i = 0; i < (int)send_requests.size(); i++) {
+      int result = MPI_Isend(send_data + i * segment_count * element_size,
+                             segment_bytes(send_count, i), MPI_BYTE, right,
+                             ALLREDUCE_ALGORITHMS_TAG, comm, &send_requests[i]);
+      if (result != MPI_SUCCESS) {
+        return result;
+      }
+    }
+    int result = MPI_Waitall((int)recv_requests.size(), recv_requests.data(),
+                             MPI_STATUSES_IGNORE);
+    if (result != MPI_SUCCESS) {
+      return result;
+    }
+    result = MPI_Waitall((int)send_requests.size(), send_requests.data(),
+                         MPI_STATUSES_IGNORE);
+    if (result != MPI_SUCCESS) {
+      return result;
+    }
+  }
+
+  return MPI_SUCCESS;
+}
+
+int RecursiveDoublingAllreduce(void* buffer, int64_t count, MPIDataType dtype,
+                               ReduceOp op, MPI_Comm comm,
+                               std::vector<uint8_t>& scratch) {
+  int rank, size;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &size);
+  if (size == 1 || count == 0) {
+    return MPI_SUCCESS;
+  }
+
+  int bytes = (int)(count * ElementSize(dtype));
+  if (scratch.size() < (size_t)bytes) {
+    scratch.resize((size_t)bytes);
+  }
+
+  // With size = pof2 + rem ranks, the first 2 * rem ranks are paired up. The
+  // even rank of every pair sends its buffer to the odd rank, which reduces it
+  // and takes part in the exchanges on behalf of both. Ranks taking part in
+  // the exchanges are renumbered from 0 to pof2 - 1.
+  int pof2 = 1;
+  while (pof2 * 2 <= size) {
+    pof2 *= 2;
+  }
+  int rem = size - pof2;
+  int new_rank;
+  if (rank < 2 * rem) {
+    if (rank % 2 == 0) {
+      int result = MPI_Send(buffer, bytes, MPI_BYTE, rank + 1,
+                            ALLREDUCE_ALGORITHMS_TAG, comm);
+      if (result != MPI_SUCCESS) {
+        return result;
+      }
+      new_rank = -1;
+    } else {
+      int result = MPI_Recv(scratch.data(), bytes, MPI_BYTE, rank - 1,
+                            ALLREDUCE_ALGORITHMS_TAG, comm, MPI_STATUS_IGNORE);
+      if (result != MPI_SUCCESS) {
+        return result;
+      }
+      ReduceInto(dtype, op, buffer, scratch.data(), count);
+      new_rank = rank / 2;
+    }
+  } else {
+    new_rank = rank - rem;
+  }
+
+  // Both ranks of every exchange compute the same result, since every
+  // reduction operation is commutative, so all ranks end up with identical
+  // results.
+  if (new_rank >= 0) {
+    for (int mask = 1; mask < pof2; mask *= 2) {
+      int new_partner = new_rank ^ mask;
+      int partner =
+          new_partner < rem ? new_partner * 2 + 1 : new_partner + rem;
+      int result = MPI_Sendrecv(buffer, bytes, MPI_BYTE, partner,
+                                ALLREDUCE_ALGORITHMS_TAG, scratch.data(), bytes,
+                                MPI_BYTE, partner, ALLREDUCE_ALGORITHMS_TAG,
+                                comm, MPI_STATUS_IGNORE);
+      if (result != MPI_SUCCESS) {
+        return result;
+      }
+      ReduceInto(dtype, op, buffer, scratch.data(), count);
+    }
+  }
+
+  // The odd rank of every pair sends the result to the even rank.
+  if (rank < 2 * rem) {
+    if (rank % 2 == 1) {
+      return MPI_Send(buffer, bytes, MPI_BYTE, rank - 1,
+                      ALLREDUCE_ALGORITHMS_TAG, comm);
+    }
+    return MPI_Recv(buffer, bytes, MPI_BYTE, rank + 1,
+                    ALLREDUCE_ALGORITHMS_TAG, comm, MPI_STATUS_IGNORE);
+  }
+  return MPI_SUCCESS;
+}
+
+} // namespace common
+} // namespace horovod
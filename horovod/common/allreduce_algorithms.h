@@ -0,0 +1,64 @@
+// Copyright 2018 Uber Technologies, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#ifndef HOROVOD_ALLREDUCE_ALGORITHMS_H
+#define HOROVOD_ALLREDUCE_ALGORITHMS_H
+
+#include <cstdint>
+#include <vector>
+
+#define OMPI_SKIP_MPICXX
+#include "mpi.h"
+#include "mpi_message.h"
+
+namespace horovod {
+namespace common {
+
+// Tag of the point-to-point messages of the built-in allreduce algorithms.
+#define ALLREDUCE_ALGORITHMS_TAG 0x484f52
+
+// Whether the built-in allreduce algorithms can reduce tensors of the data type
+// with op.
+bool AllreduceAlgorithmsSupported(MPIDataType dtype, ReduceOp op);
+
+// Reduce count elements of src into dst with op.
+void ReduceInto(MPIDataType dtype, ReduceOp op, void* dst, const void* src,
+                int64_t count);
+
+// Reduce count elements of the data type in buffer with op over all ranks of
+// comm, in place, with a bandwidth-optimal ring allreduce: a reduce-scatter
+// followed by an allgather, each in size - 1 steps between neighbouring ranks.
+// Blocks are sent in segments of segment_size bytes, and every received
+// segment is reduced while the following segments are still being received.
+// Scratch holds the received segments. Returns an MPI error code.
+int RingAllreduce(void* buffer, int64_t count, MPIDataType dtype, ReduceOp op,
+                  MPI_Comm comm, int64_t segment_size,
+                  std::vector<uint8_t>& scratch);
+
+// Reduce count elements of the data type in buffer with op over all ranks of
+// comm, in place, with a latency-optimal recursive-doubling allreduce: in
+// log2(size) steps, every rank exchanges its whole buffer with the rank whose
+// rank differs in one bit and reduces it. With a rank count that is not a
+// power of two, the first ranks are paired up and one rank of every pair takes
+// no part in the exchanges. Scratch holds the received buffer. Returns an MPI
+// error code.
+int RecursiveDoublingAllreduce(void* buffer, int64_t count, MPIDataType dtype,
+                               ReduceOp op, MPI_Comm comm,
+                               std::vector<uint8_t>& scratch);
+
+} // namespace common
+} // namespace horovod
+
+#endif // HOROVOD_ALLREDUCE_ALGORITHMS_H
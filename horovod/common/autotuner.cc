@@ -0,0 +1,217 @@
+// Copyright 2018 Uber Technologies, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+
+#include "autotuner.h"
+
+namespace horovod {
+namespace common {
+
+namespace {
+
+// Keys of the parameters in saved files, named after the knobs they
+// override.
+#define FUSION_THRESHOLD_KEY "HOROVOD_FUSION_THRESHOLD"
+#define CYCLE_TIME_KEY "HOROVOD_CYCLE_TIME"
+
+// Returns the index of value in the sorted grid, inserting it if needed.
+template <typename T> size_t GridIndex(std::vector<T>& grid, T value) {
+  auto it = std::lower_bound(grid.begin(), grid.end(), value);
+  if (it == grid.end() || *it != value) {
+    it = grid.insert(it, value);
+  }
+  return (size_t)(it - grid.begin());
+}
+
+} // namespace
+
+void AutoTuner::Initialize(TunedParameters initial, int warmup_samples,
+                           int cycles_per_sample) {
+  // Fusion thresholds from none to 64 MB, and cycle times from 1 ms to 40 ms,
+  // along with the initial values.
+  fusion_thresholds_ = {0};
+  for (int64_t threshold = 1024 * 1024; threshold <= 64 * 1024 * 1024;
+       threshold *= 2) {
+    fusion_thresholds_.push_back(threshold);
+  }
+  cycle_times_ms_ = {1, 2.5, 5, 10, 20, 40};
+  point_ = GridPoint(GridIndex(fusion_thresholds_, initial.fusion_threshold),
+                     GridIndex(cycle_times_ms_, initial.cycle_time_ms));
+
+  warmup_samples_ = warmup_samples;
+  cycles_per_sample_ = std::max(cycles_per_sample, 1);
+  active_ = true;
+  sample_started_ = false;
+
+  scores_.clear();
+  queue_.clear();
+  best_ = point_;
+  dimension_ = 0;
+  improved_ = false;
+  dimensions_without_improvement_ = 0;
+  QueueNeighbours();
+}
+
+bool AutoTuner::active() const { return active_; }
+
+TunedParameters AutoTuner::parameters() const { return ToParameters(point_); }
+
+TunedParameters AutoTuner::best() const { return ToParameters(best_); }
+
+int64_t AutoTuner::max_fusion_threshold() const {
+  return fusion_thresholds_.back();
+}
+
+void AutoTuner::Update(int64_t bytes,
+                       std::chrono::steady_clock::time_point now) {
+  if (!active_) {
+    return;
+  }
+
+  // A sample starts at the first cycle with its parameters.
+  if (!sample_started_) {
+    sample_started_ = true;
+    sample_start_ = now;
+    sample_bytes_ = 0;
+    sample_cycles_ = 0;
+    return;
+  }
+
+  sample_bytes_ += bytes;
+  if (bytes > 0) {
+    sample_cycles_++;
+  }
+  if (sample_cycles_ < cycles_per_sample_) {
+    return;
+  }
+  sample_started_ = false;
+
+  if (warmup_samples_ > 0) {
+    warmup_samples_--;
+    return;
+  }
+
+  double seconds = std::chrono::duration<double>(now - sample_start_).count();
+  double score = sample_bytes_ / std::max(seconds, 1e-9);
+  scores_[point_] = score;
+  if (point_ != best_ && score > scores_[best_]) {
+    best_ = point_;
+    improved_ = true;
+  }
+  NextSample();
+}
+
+TunedParameters AutoTuner::ToParameters(GridPoint point) const {
+  TunedParameters parameters;
+  parameters.fusion_threshold = fusion_thresholds_[point.first];
+  parameters.cycle_time_ms = cycle_times_ms_[point.second];
+  return parameters;
+}
+
+void AutoTuner::QueueNeighbours() {
+  size_t index = dimension_ == 0 ? best_.first : best_.second;
+  size_t grid_size =
+      dimension_ == 0 ? fusion_thresholds_.size() : cycle_times_ms_.size();
+  for (size_t neighbour : {index + 1, index - 1}) {
+    // Unsigned underflow of index - 1 also ends up out of range.
+    if (neighbour >= grid_size) {
+      continue;
+    }
+    GridPoint point = best_;
+    (dimension_ == 0 ? point.first : point.second) = neighbour;
+    if (scores_.find(point) == scores_.end()) {
+      queue_.push_back(point);
+    }
+  }
+}
+
+void AutoTuner::NextSample() {
+  while (true) {
+    while (!queue_.empty()) {
+      auto point = queue_.back();
+      queue_.pop_back();
+      if (scores_.find(point) == scores_.end()) {
+        point_ = point;
+        return;
+      }
+    }
+
+    // All neighbours along this parameter are sampled. Keep moving along it
+    // while the best point moves, and otherwise switch to the other one.
+    if (improved_) {
+      improved_ = false;
+      dimensions_without_improvement_ = 0;
+    } else {
+      dimensions_without_improvement_++;
+      if (dimensions_without_improvement_ >= 2) {
+        point_ = best_;
+        active_ = false;
+        return;
+      }
+      dimension_ = 1 - dimension_;
+    }
+    QueueNeighbours();
+  }
+}
+
+bool AutoTuner::LoadParameters(const std::string& path,
+                               TunedParameters* parameters) {
+  std::ifstream file(path);
+  if (!file) {
+    return false;
+  }
+  bool has_fusion_threshold = false;
+  bool has_cycle_time = false;
+  std::string line;
+  while (std::getline(file, line)) {
+    auto equals = line.find('=');
+    if (line.empty() || line[0] == '#' || equals == std::string::npos) {
+      continue;
+    }
+    auto key = line.substr(0, equals);
+    auto value = line.substr(equals + 1);
+    if (key == FUSION_THRESHOLD_KEY) {
+      parameters->fusion_threshold = std::strtoll(value.c_str(), nullptr, 10);
+      has_fusion_threshold = true;
+    } else if (key == CYCLE_TIME_KEY) {
+      parameters->cycle_time_ms = std::strtod(value.c_str(), nullptr);
+      has_cycle_time = true;
+    }
+  }
+  return has_fusion_threshold && has_cycle_time;
+}
+
+bool AutoTuner::SaveParameters(const std::string& path) const {
+  std::ofstream file(path);
+  if (!file) {
+    return false;
+  }
+  auto parameters = best();
+  auto score = scores_.find(best_);
+  if (score != scores_.end()) {
+    file << "# " << (int64_t)score->second << " bytes per second"
+         << std::endl;
+  }
+  file << FUSION_THRESHOLD_KEY << "=" << parameters.fusion_threshold
+       << std::endl;
+  file << CYCLE_TIME_KEY << "=" << parameters.cycle_time_ms << std::endl;
+  return (bool)file;
+}
+
+} // namespace common
+} // namespace horovod
@@ -0,0 +1,113 @@
+// Copyright 2018 Uber Technologies, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#ifndef HOROVOD_AUTOTUNER_H
+#define HOROVOD_AUTOTUNER_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace horovod {
+namespace common {
+
+// Values of the tuned parameters.
+struct TunedParameters {
+  int64_t fusion_threshold;
+  double cycle_time_ms;
+};
+
+// Tunes the Tensor Fusion threshold and the cycle time while training runs.
+// Every sample measures the bytes performed per second over a number of
+// cycles that perform operations, with one choice of parameters. The first
+// samples are discarded while the job warms up.
+//
+// The search is a coordinate descent over a grid of values of each parameter:
+// starting from the initial values, it samples the neighbours of the best
+// values along one parameter, moves to the best neighbour, and switches to
+// the other parameter once neither neighbour is better. Tuning ends once no
+// neighbour along either parameter is better.
+//
+// The autotuner only runs on the coordinator, which broadcasts the parameters.
+class AutoTuner {
+public:
+  void Initialize(TunedParameters initial, int warmup_samples,
+                  int cycles_per_sample);
+
+  bool active() const;
+
+  // The parameters to use for the next cycle, and the best parameters found.
+  TunedParameters parameters() const;
+  TunedParameters best() const;
+
+  // Largest fusion threshold the search may choose.
+  int64_t max_fusion_threshold() const;
+
+  // Records the bytes performed during a cycle, and moves on to the next
+  // parameters once the sample is complete.
+  void Update(int64_t bytes, std::chrono::steady_clock::time_point now);
+
+  // Saves the best parameters to a file, from which LoadParameters() reads
+  // them in later jobs. Both return false if the file cannot be read or
+  // written.
+  static bool LoadParameters(const std::string& path,
+                             TunedParameters* parameters);
+  bool SaveParameters(const std::string& path) const;
+
+private:
+  typedef std::pair<size_t, size_t> GridPoint;
+
+  TunedParameters ToParameters(GridPoint point) const;
+
+  // Queues the unsampled neighbours of the best point along the current
+  // parameter.
+  void QueueNeighbours();
+
+  // Moves on to the next point to sample, or to the best point once tuning
+  // ends.
+  void NextSample();
+
+  std::vector<int64_t> fusion_thresholds_;
+  std::vector<double> cycle_times_ms_;
+
+  int warmup_samples_ = 0;
+  int cycles_per_sample_ = 1;
+  bool active_ = false;
+
+  // Current sample.
+  GridPoint point_;
+  int64_t sample_bytes_ = 0;
+  int sample_cycles_ = 0;
+  std::chrono::steady_clock::time_point sample_start_;
+  bool sample_started_ = false;
+
+  // Search state: throughput of sampled points, points left to sample along
+  // the current parameter, and the number of parameters in a row along which
+  // the best point did not move.
+  std::map<GridPoint, double> scores_;
+  std::vector<GridPoint> queue_;
+  GridPoint best_;
+  int dimension_ = 0;
+  bool improved_ = false;
+  int dimensions_without_improvement_ = 0;
+};
+
+} // namespace common
+} // namespace horovod
+
+#endif // HOROVOD_AUTOTUNER_H
@@ -13,65 +13,65 @@
 // limitations under the License.
 // =============================================================================
 
-#if __AVX__ && __F16C__
-#include <cpuid.h>
-#include <immintrin.h>
-#endif
-
 #include "half.h"
+#include "reduction_pool.h"
 
 namespace horovod {
 namespace common {
 
-#if __AVX__ && __F16C__
-// Query CPUID to determine AVX and F16C runtime support.
-bool is_avx_and_f16c() {
-  static bool initialized = false;
-  static bool result = false;
-  if (!initialized) {
-    unsigned int eax, ebx, ecx, edx;
-    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
-      result = (ecx & bit_AVX) && (ecx & bit_F16C);
-    }
-    initialized = true;
-  }
-  return result;
+namespace {
+
+// Reduces with the fastest kernel that the CPU supports. Large buffers are
+// split across the threads of the reduction pool.
+template <MPIDataType dtype, ReduceOp op>
+void Reduce(void* invec, void* inoutvec, int* len) {
+  static const ReductionKernel kernel = GetReductionKernel(op, dtype);
+  GlobalReductionPool().Reduce(kernel, inoutvec, invec, *len,
+                               sizeof(uint16_t));
 }
-#endif
 
-// float16 custom data type summation operation.
+} // namespace
+
+// float16 custom data type reduction operations.
 void float16_sum(void* invec, void* inoutvec, int* len,
                  MPI_Datatype* datatype) {
-  // cast invec and inoutvec to your float16 type
-  auto* in = (unsigned short*)invec;
-  auto* inout = (unsigned short*)inoutvec;
+  Reduce<HOROVOD_FLOAT16, ReduceOp::SUM>(invec, inoutvec, len);
+}
+
+void float16_min(void* invec, void* inoutvec, int* len,
+                 MPI_Datatype* datatype) {
+  Reduce<HOROVOD_FLOAT16, ReduceOp::MIN>(invec, inoutvec, len);
+}
+
+void float16_max(void* invec, void* inoutvec, int* len,
+                 MPI_Datatype* datatype) {
+  Reduce<HOROVOD_FLOAT16, ReduceOp::MAX>(invec, inoutvec, len);
+}
+
+void float16_product(void* invec, void* inoutvec, int* len,
+                     MPI_Datatype* datatype) {
+  Reduce<HOROVOD_FLOAT16, ReduceOp::PRODUCT>(invec, inoutvec, len);
+}
 
-  int i = 0;
-#if __AVX__ && __F16C__
-  if (is_avx_and_f16c()) {
-    for (; i < (*len / 8) * 8; i += 8) {
-      // convert in & inout to m256
-      __m256 in_m256 = _mm256_cvtph_ps(_mm_loadu_si128((__m128i*)(in + i)));
-      __m256 inout_m256 =
-          _mm256_cvtph_ps(_mm_loadu_si128((__m128i*)(inout + i)));
+// bfloat16 custom data type reduction operations.
+void bfloat16_sum(void* invec, void* inoutvec, int* len,
+                  MPI_Datatype* datatype) {
+  Reduce<HOROVOD_BFLOAT16, ReduceOp::SUM>(invec, inoutvec, len);
+}
+
+void bfloat16_min(void* invec, void* inoutvec, int* len,
+                  MPI_Datatype* datatype) {
+  Reduce<HOROVOD_BFLOAT16, ReduceOp::MIN>(invec, inoutvec, len);
+}
 
-      // add them together to new_inout_m256
-      __m256 new_inout_m256 = _mm256_add_ps(in_m256, inout_m256);
+void bfloat16_max(void* invec, void* inoutvec, int* len,
+                  MPI_Datatype* datatype) {
+  Reduce<HOROVOD_BFLOAT16, ReduceOp::MAX>(invec, inoutvec, len);
+}
 
-      // convert back and store in inout
-      __m128i new_inout_m128i = _mm256_cvtps_ph(new_inout_m256, 0);
-      _mm_storeu_si128((__m128i*)(inout + i), new_inout_m128i);
-    }
-  }
-#endif
-  for (; i < *len; ++i) {
-    float in_float;
-    float inout_float;
-    HalfBits2Float(in + i, &in_float);
-    HalfBits2Float(inout + i, &inout_float);
-    inout_float += in_float;
-    Float2HalfBits(&inout_float, inout + i);
-  }
+void bfloat16_product(void* invec, void* inoutvec, int* len,
+                      MPI_Datatype* datatype) {
+  Reduce<HOROVOD_BFLOAT16, ReduceOp::PRODUCT>(invec, inoutvec, len);
 }
 
 } // namespace common
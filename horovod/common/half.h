@@ -27,6 +27,7 @@
 #define HOROVOD_HALF_H
 
 #include <stdint.h>
+#include <string.h>
 
 #define OMPI_SKIP_MPICXX
 #include "mpi.h"
@@ -67,7 +68,7 @@ inline void HalfBits2Float(unsigned short* src, float* res) {
     }
   }
 
-  *res = *reinterpret_cast<float const*>(&f);
+  memcpy(res, &f, sizeof(f));
 }
 
 inline void Float2HalfBits(float* src, unsigned short* dest) {
@@ -132,7 +133,39 @@ inline void Float2HalfBits(float* src, unsigned short* dest) {
   *dest = u;
 }
 
+// bfloat16 keeps the upper 16 bits of a float32, so widening it is a shift.
+inline void BFloat16Bits2Float(unsigned short* src, float* res) {
+  unsigned f = unsigned(*src) << 16;
+  memcpy(res, &f, sizeof(f));
+}
+
+inline void Float2BFloat16Bits(float* src, unsigned short* dest) {
+  // software implementation rounds toward nearest even
+  unsigned s;
+  memcpy(&s, src, sizeof(s));
+  if ((s & 0x7fffffff) > 0x7f800000) {
+    // not a number, kept quiet so that truncation cannot make it infinite
+    *dest = uint16_t((s >> 16) | 0x40);
+    return;
+  }
+  s += 0x7fff + ((s >> 16) & 1);
+  *dest = uint16_t(s >> 16);
+}
+
 void float16_sum(void* invec, void* inoutvec, int* len, MPI_Datatype* datatype);
+void float16_min(void* invec, void* inoutvec, int* len, MPI_Datatype* datatype);
+void float16_max(void* invec, void* inoutvec, int* len, MPI_Datatype* datatype);
+void float16_product(void* invec, void* inoutvec, int* len,
+                     MPI_Datatype* datatype);
+
+void bfloat16_sum(void* invec, void* inoutvec, int* len,
+                  MPI_Datatype* datatype);
+void bfloat16_min(void* invec, void* inoutvec, int* len,
+                  MPI_Datatype* datatype);
+void bfloat16_max(void* invec, void* inoutvec, int* len,
+                  MPI_Datatype* datatype);
+void bfloat16_product(void* invec, void* inoutvec, int* len,
+                      MPI_Datatype* datatype);
 
 } // namespace common
 } // namespace horovod
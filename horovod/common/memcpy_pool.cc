@@ -0,0 +1,180 @@
+// Copyright 2018 Uber Technologies, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "memcpy_pool.h"
+
+namespace horovod {
+namespace common {
+
+namespace {
+
+void StreamingMemcpy(void* dst, const void* src, size_t len) {
+#if __SSE2__
+  if (len >= STREAMING_MEMCPY_MIN_SIZE) {
+    auto* d = (uint8_t*)dst;
+    auto* s = (const uint8_t*)src;
+
+    // Copy up to the first 16-byte aligned destination address normally.
+    size_t head = std::min((16 - ((uintptr_t)d & 15)) & 15, len);
+    std::memcpy(d, s, head);
+    d += head;
+    s += head;
+    len -= head;
+
+    for (; len >= 64; len -= 64, d += 64, s += 64) {
+      auto v0 = _mm_loadu_si128((const __m128i*)s);
+      auto v1 = _mm_loadu_si128((const __m128i*)(s + 16));
+      auto v2 = _mm_loadu_si128((const __m128i*)(s + 32));
+      auto v3 = _mm_loadu_si128((const __m128i*)(s + 48));
+      _mm_stream_si128((__m128i*)d, v0);
+      _mm_stream_si128((__m128i*)(d + 16), v1);
+      _mm_stream_si128((__m128i*)(d + 32), v2);
+      _mm_stream_si128((__m128i*)(d + 48), v3);
+    }
+    std::memcpy(d, s, len);
+
+    // Make the non-temporal stores visible to other threads.
+    _mm_sfence();
+    return;
+  }
+#endif
+  std::memcpy(dst, src, len);
+}
+
+// Copy the bytes [begin, end) of the concatenation of the copies. Scaled
+// copies are split at the start of the element that holds the boundary.
+void CopyRange(const std::vector<MemcpyTask>& tasks, size_t begin,
+               size_t end) {
+  size_t offset = 0;
+  for (auto& task : tasks) {
+    size_t from = std::max(begin, offset);
+    size_t to = std::min(end, offset + task.len);
+    if (task.scale != nullptr) {
+      from -= (from - offset) % task.element_size;
+      to -= (to - offset) % task.element_size;
+      if (from < to) {
+        task.scale((uint8_t*)task.dst + (from - offset),
+                   (const uint8_t*)task.src + (from - offset),
+                   (int64_t)((to - from) / task.element_size), task.factor);
+      }
+    } else if (from < to) {
+      StreamingMemcpy((uint8_t*)task.dst + (from - offset),
+                      (const uint8_t*)task.src + (from - offset), to - from);
+    }
+    offset += task.len;
+    if (offset >= end) {
+      break;
+    }
+  }
+}
+
+} // namespace
+
+MemcpyPool::~MemcpyPool() { Shutdown(); }
+
+void MemcpyPool::Initialize(int num_threads) {
+  Shutdown();
+  shut_down_ = false;
+  generation_ = 0;
+  range_starts_.assign((size_t)std::max(num_threads, 1) + 1, 0);
+  for (size_t i = 1; i < (size_t)num_threads; i++) {
+    threads_.emplace_back(&MemcpyPool::WorkerLoop, this, i);
+  }
+}
+
+void MemcpyPool::Shutdown() {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    shut_down_ = true;
+  }
+  start_cv_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+}
+
+void MemcpyPool::Copy(const std::vector<MemcpyTask>& tasks) {
+  size_t total_len = 0;
+  for (auto& task : tasks) {
+    total_len += task.len;
+  }
+  if (threads_.empty() || total_len < PARALLEL_MEMCPY_MIN_SIZE) {
+    CopyRange(tasks, 0, total_len);
+    return;
+  }
+
+  // Split the copies into ranges aligned to cache lines.
+  size_t num_ranges = threads_.size() + 1;
+  size_t range_len = ((total_len / num_ranges + 63) / 64) * 64;
+  for (size_t i = 0; i < num_ranges; i++) {
+    range_starts_[i] = std::min(i * range_len, total_len);
+  }
+  range_starts_[num_ranges] = total_len;
+
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    tasks_ = &tasks;
+    pending_ = threads_.size();
+    generation_++;
+  }
+  start_cv_.notify_all();
+
+  CopyRange(tasks, range_starts_[0], range_starts_[1]);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [this]() { return pending_ == 0; });
+  tasks_ = nullptr;
+}
+
+void MemcpyPool::WorkerLoop(size_t index) {
+  uint64_t generation = 0;
+  while (true) {
+    const std::vector<MemcpyTask>* tasks;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_cv_.wait(lock, [this, generation]() {
+        return generation_ != generation || shut_down_;
+      });
+      if (shut_down_) {
+        return;
+      }
+      generation = generation_;
+      tasks = tasks_;
+    }
+
+    CopyRange(*tasks, range_starts_[index], range_starts_[index + 1]);
+
+    bool done;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      done = --pending_ == 0;
+    }
+    if (done) {
+      done_cv_.notify_one();
+    }
+  }
+}
+
+} // namespace common
+} // namespace horovod
@@ -0,0 +1,93 @@
+// Copyright 2018 Uber Technologies, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#ifndef HOROVOD_MEMCPY_POOL_H
+#define HOROVOD_MEMCPY_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "reduction_kernels.h"
+
+namespace horovod {
+namespace common {
+
+// Copies smaller than this are not split across threads.
+#define PARALLEL_MEMCPY_MIN_SIZE (256 * 1024)
+
+// Copies of at least this many bytes use non-temporal stores, so that they do
+// not evict the working set from the caches.
+#define STREAMING_MEMCPY_MIN_SIZE (1024 * 1024)
+
+// A copy of len bytes. Copies with a scaling kernel multiply the elements by
+// factor on the way, in which case len is a multiple of element_size.
+struct MemcpyTask {
+  MemcpyTask(void* dst, const void* src, size_t len)
+      : dst(dst), src(src), len(len) {}
+  MemcpyTask(void* dst, const void* src, size_t len, ScaleKernel scale,
+             double factor, size_t element_size)
+      : dst(dst), src(src), len(len), scale(scale), factor(factor),
+        element_size(element_size) {}
+
+  void* dst;
+  const void* src;
+  size_t len;
+  ScaleKernel scale = nullptr;
+  double factor = 1.0;
+  size_t element_size = 1;
+};
+
+// Pool of helper threads that copy tensors into and out of the fusion buffer.
+// A batch of copies is split into contiguous byte ranges of the concatenated
+// copies, one per thread, and the calling thread copies the first range
+// itself.
+class MemcpyPool {
+public:
+  ~MemcpyPool();
+
+  // Starts num_threads - 1 helper threads. With a single thread all copies
+  // are done by the calling thread.
+  void Initialize(int num_threads);
+  void Shutdown();
+
+  // Performs all copies and returns once they are done. Not thread-safe.
+  void Copy(const std::vector<MemcpyTask>& tasks);
+
+private:
+  void WorkerLoop(size_t index);
+
+  std::vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  std::condition_variable start_cv_;
+  std::condition_variable done_cv_;
+
+  // The batch of copies being performed, the byte ranges of the threads, and
+  // a counter that tells the helper threads that a new batch started.
+  const std::vector<MemcpyTask>* tasks_ = nullptr;
+  std::vector<size_t> range_starts_;
+  uint64_t generation_ = 0;
+  size_t pending_ = 0;
+  bool shut_down_ = false;
+};
+
+} // namespace common
+} // namespace horovod
+
+#endif // HOROVOD_MEMCPY_POOL_H
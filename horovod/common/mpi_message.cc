@@ -14,6 +14,7 @@
 // limitations under the License.
 // =============================================================================
 
+#include "common.h"
 #include "mpi_message.h"
 #include "wire/mpi_message_generated.h"
 #include <iostream>
@@ -53,12 +54,60 @@ const std::string& MPIDataType_Name(MPIDataType value) {
   case HOROVOD_BOOL:
     static const std::string bool_("bool");
     return bool_;
+  case HOROVOD_BFLOAT16:
+    static const std::string bfloat16("bfloat16");
+    return bfloat16;
   default:
     static const std::string unknown("<unknown>");
     return unknown;
   }
 }
 
+const std::string& ReduceOp_Name(ReduceOp value) {
+  switch (value) {
+  case ReduceOp::SUM:
+    static const std::string sum("sum");
+    return sum;
+  case ReduceOp::MIN:
+    static const std::string min("min");
+    return min;
+  case ReduceOp::MAX:
+    static const std::string max("max");
+    return max;
+  case ReduceOp::PRODUCT:
+    static const std::string product("product");
+    return product;
+  case ReduceOp::BAND:
+    static const std::string band("band");
+    return band;
+  case ReduceOp::BOR:
+    static const std::string bor("bor");
+    return bor;
+  case ReduceOp::BXOR:
+    static const std::string bxor("bxor");
+    return bxor;
+  default:
+    static const std::string unknown("<unknown>");
+    return unknown;
+  }
+}
+
+bool ReduceOpSupported(ReduceOp op, MPIDataType dtype) {
+  bool bitwise = op == ReduceOp::BAND || op == ReduceOp::BOR ||
+                 op == ReduceOp::BXOR;
+  switch (dtype) {
+  case HOROVOD_BOOL:
+    return bitwise;
+  case HOROVOD_FLOAT16:
+  case HOROVOD_BFLOAT16:
+  case HOROVOD_FLOAT32:
+  case HOROVOD_FLOAT64:
+    return !bitwise;
+  default:
+    return true;
+  }
+}
+
 const std::string& MPIRequest::RequestType_Name(RequestType value) {
   switch (value) {
   case RequestType::ALLREDUCE:
@@ -116,6 +165,71 @@ void MPIRequest::add_tensor_shape(int64_t value) {
   tensor_shape_.push_back(value);
 }
 
+int32_t MPIRequest::tensor_id() const { return tensor_id_; }
+
+void MPIRequest::set_tensor_id(int32_t value) { tensor_id_ = value; }
+
+uint64_t MPIRequest::signature() const { return signature_; }
+
+void MPIRequest::set_signature(uint64_t value) { signature_ = value; }
+
+int32_t MPIRequest::priority() const { return priority_; }
+
+void MPIRequest::set_priority(int32_t value) { priority_ = value; }
+
+ReduceOp MPIRequest::reduce_op() const { return reduce_op_; }
+
+void MPIRequest::set_reduce_op(ReduceOp value) { reduce_op_ = value; }
+
+const std::vector<int32_t>& MPIRequest::node_ranks() const {
+  return node_ranks_;
+}
+
+const std::vector<int32_t>& MPIRequest::node_devices() const {
+  return node_devices_;
+}
+
+const std::vector<int64_t>& MPIRequest::node_first_dims() const {
+  return node_first_dims_;
+}
+
+void MPIRequest::add_node_rank(int32_t rank, int32_t device,
+                               int64_t first_dim) {
+  node_ranks_.push_back(rank);
+  node_devices_.push_back(device);
+  node_first_dims_.push_back(first_dim);
+}
+
+void MPIRequest::clear_node_ranks() {
+  node_ranks_.clear();
+  node_devices_.clear();
+  node_first_dims_.clear();
+}
+
+uint64_t MPIRequest::ComputeSignature(const MPIRequest& request) {
+  // 64-bit FNV-1a over the bytes of the fields.
+  uint64_t hash = 0xcbf29ce484222325ull;
+  auto hash_value = [&hash](int64_t value) {
+    for (int i = 0; i < 8; i++) {
+      hash ^= (uint64_t)(value >> (8 * i)) & 0xffull;
+      hash *= 0x100000001b3ull;
+    }
+  };
+
+  hash_value(request.tensor_type());
+  hash_value(request.request_type());
+  hash_value((int64_t)request.reduce_op());
+  hash_value(request.root_rank());
+  hash_value(request.device() == CPU_DEVICE_ID);
+  auto& shape = request.tensor_shape();
+  hash_value((int64_t)shape.size());
+  size_t first_dim = request.request_type() == ALLGATHER ? 1 : 0;
+  for (size_t i = first_dim; i < shape.size(); i++) {
+    hash_value(shape[i]);
+  }
+  return hash;
+}
+
 namespace {
 
 void MPIRequest_ParseFromWire(MPIRequest& request,
@@ -123,29 +237,65 @@ void MPIRequest_ParseFromWire(MPIRequest& request,
   request.set_request_rank(obj->request_rank());
   request.set_request_type((MPIRequest::RequestType)obj->request_type());
   request.set_tensor_type((MPIDataType)obj->tensor_type());
-  request.set_tensor_name(obj->tensor_name()->str());
+  if (obj->tensor_name() != nullptr) {
+    request.set_tensor_name(obj->tensor_name()->str());
+  }
   request.set_root_rank(obj->root_rank());
   request.set_device(obj->device());
   request.set_tensor_shape(std::vector<int64_t>(obj->tensor_shape()->begin(),
                                                 obj->tensor_shape()->end()));
+  request.set_tensor_id(obj->tensor_id());
+  request.set_signature(obj->signature());
+  request.set_priority(obj->priority());
+  request.set_reduce_op((ReduceOp)obj->reduce_op());
+  if (obj->node_ranks() != nullptr) {
+    for (flatbuffers::uoffset_t i = 0; i < obj->node_ranks()->size(); i++) {
+      request.add_node_rank(obj->node_ranks()->Get(i),
+                            obj->node_devices()->Get(i),
+                            obj->node_first_dims()->Get(i));
+    }
+  }
 }
 
 void MPIRequest_SerializeToWire(const MPIRequest& request,
                                 flatbuffers::FlatBufferBuilder& builder,
                                 flatbuffers::Offset<wire::MPIRequest>& obj) {
-  // FlatBuffers must be built bottom-up.
-  auto tensor_name_wire = builder.CreateString(request.tensor_name());
+  // FlatBuffers must be built bottom-up. Requests with an interned tensor ID
+  // do not send the tensor name.
+  flatbuffers::Offset<flatbuffers::String> tensor_name_wire;
+  if (!request.tensor_name().empty()) {
+    tensor_name_wire = builder.CreateString(request.tensor_name());
+  }
   auto tensor_shape_wire = builder.CreateVector(request.tensor_shape());
+  flatbuffers::Offset<flatbuffers::Vector<int32_t>> node_ranks_wire;
+  flatbuffers::Offset<flatbuffers::Vector<int32_t>> node_devices_wire;
+  flatbuffers::Offset<flatbuffers::Vector<int64_t>> node_first_dims_wire;
+  if (!request.node_ranks().empty()) {
+    node_ranks_wire = builder.CreateVector(request.node_ranks());
+    node_devices_wire = builder.CreateVector(request.node_devices());
+    node_first_dims_wire = builder.CreateVector(request.node_first_dims());
+  }
 
   wire::MPIRequestBuilder request_builder(builder);
   request_builder.add_request_rank(request.request_rank());
   request_builder.add_request_type(
       (wire::MPIRequestType)request.request_type());
   request_builder.add_tensor_type((wire::MPIDataType)request.tensor_type());
-  request_builder.add_tensor_name(tensor_name_wire);
+  if (!request.tensor_name().empty()) {
+    request_builder.add_tensor_name(tensor_name_wire);
+  }
   request_builder.add_root_rank(request.root_rank());
   request_builder.add_device(request.device());
   request_builder.add_tensor_shape(tensor_shape_wire);
+  request_builder.add_tensor_id(request.tensor_id());
+  request_builder.add_signature(request.signature());
+  request_builder.add_priority(request.priority());
+  request_builder.add_reduce_op((wire::MPIReduceOp)request.reduce_op());
+  if (!request.node_ranks().empty()) {
+    request_builder.add_node_ranks(node_ranks_wire);
+    request_builder.add_node_devices(node_devices_wire);
+    request_builder.add_node_first_dims(node_first_dims_wire);
+  }
   obj = request_builder.Finish();
 }
 
@@ -172,6 +322,10 @@ const std::vector<MPIRequest>& MPIRequestList::requests() const {
   return requests_;
 }
 
+std::vector<MPIRequest>& MPIRequestList::mutable_requests() {
+  return requests_;
+}
+
 void MPIRequestList::set_requests(const std::vector<MPIRequest>& value) {
   requests_ = value;
 }
@@ -285,6 +439,26 @@ void MPIResponse::add_tensor_sizes(int64_t value) {
   tensor_sizes_.push_back(value);
 }
 
+const std::vector<int32_t>& MPIResponse::tensor_ids() const {
+  return tensor_ids_;
+}
+
+void MPIResponse::set_tensor_ids(const std::vector<int32_t>& value) {
+  tensor_ids_ = value;
+}
+
+void MPIResponse::add_tensor_ids(int32_t value) {
+  tensor_ids_.push_back(value);
+}
+
+int32_t MPIResponse::priority() const { return priority_; }
+
+void MPIResponse::set_priority(int32_t value) { priority_ = value; }
+
+ReduceOp MPIResponse::reduce_op() const { return reduce_op_; }
+
+void MPIResponse::set_reduce_op(ReduceOp value) { reduce_op_ = value; }
+
 void MPIResponse_ParseFromWire(MPIResponse& response,
                               const wire::MPIResponse* obj) {
   response.set_response_type((MPIResponse::ResponseType)obj->response_type());
@@ -296,6 +470,12 @@ void MPIResponse_ParseFromWire(MPIResponse& response,
       std::vector<int32_t>(obj->devices()->begin(), obj->devices()->end()));
   response.set_tensor_sizes(std::vector<int64_t>(obj->tensor_sizes()->begin(),
                                                  obj->tensor_sizes()->end()));
+  if (obj->tensor_ids() != nullptr) {
+    response.set_tensor_ids(std::vector<int32_t>(obj->tensor_ids()->begin(),
+                                                 obj->tensor_ids()->end()));
+  }
+  response.set_priority(obj->priority());
+  response.set_reduce_op((ReduceOp)obj->reduce_op());
 }
 
 void MPIResponse::ParseFromString(MPIResponse& response,
@@ -313,6 +493,10 @@ void MPIResponse_SerializeToWire(const MPIResponse& response,
   auto error_message_wire = builder.CreateString(response.error_message());
   auto devices_wire = builder.CreateVector(response.devices());
   auto tensor_sizes_wire = builder.CreateVector(response.tensor_sizes());
+  flatbuffers::Offset<flatbuffers::Vector<int32_t>> tensor_ids_wire;
+  if (!response.tensor_ids().empty()) {
+    tensor_ids_wire = builder.CreateVector(response.tensor_ids());
+  }
 
   wire::MPIResponseBuilder response_builder(builder);
   response_builder.add_response_type(
@@ -321,6 +505,11 @@ void MPIResponse_SerializeToWire(const MPIResponse& response,
   response_builder.add_error_message(error_message_wire);
   response_builder.add_devices(devices_wire);
   response_builder.add_tensor_sizes(tensor_sizes_wire);
+  if (!response.tensor_ids().empty()) {
+    response_builder.add_tensor_ids(tensor_ids_wire);
+  }
+  response_builder.add_priority(response.priority());
+  response_builder.add_reduce_op((wire::MPIReduceOp)response.reduce_op());
   obj = response_builder.Finish();
 }
 
@@ -340,6 +529,10 @@ const std::vector<MPIResponse>& MPIResponseList::responses() const {
   return responses_;
 }
 
+std::vector<MPIResponse>& MPIResponseList::mutable_responses() {
+  return responses_;
+}
+
 void MPIResponseList::set_responses(const std::vector<MPIResponse>& value) {
   responses_ = value;
 }
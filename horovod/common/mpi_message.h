@@ -33,11 +33,30 @@ enum MPIDataType {
   HOROVOD_FLOAT16 = 6,
   HOROVOD_FLOAT32 = 7,
   HOROVOD_FLOAT64 = 8,
-  HOROVOD_BOOL = 9
+  HOROVOD_BOOL = 9,
+  HOROVOD_BFLOAT16 = 10
 };
 
 const std::string& MPIDataType_Name(MPIDataType value);
 
+// Reduction operations of allreduce. Bitwise operations only apply to integer
+// and boolean tensors, on which they are the logical operations, and the
+// others only to numeric tensors.
+enum class ReduceOp {
+  SUM = 0,
+  MIN = 1,
+  MAX = 2,
+  PRODUCT = 3,
+  BAND = 4,
+  BOR = 5,
+  BXOR = 6
+};
+
+const std::string& ReduceOp_Name(ReduceOp value);
+
+// Whether tensors of the data type can be reduced with the operation.
+bool ReduceOpSupported(ReduceOp op, MPIDataType dtype);
+
 // An MPIRequest is a message sent from a rank greater than zero to the
 // coordinator (rank zero), informing the coordinator of an operation that
 // the rank wants to do and the tensor that it wants to apply the operation to.
@@ -59,6 +78,7 @@ public:
   MPIDataType tensor_type() const;
   void set_tensor_type(MPIDataType value);
 
+  // Only set while the request is on the wire, for tensors without a wire ID.
   const std::string& tensor_name() const;
   void set_tensor_name(const std::string& value);
 
@@ -72,6 +92,40 @@ public:
   void set_tensor_shape(const std::vector<int64_t>& value);
   void add_tensor_shape(int64_t value);
 
+  // Local ID of the tensor on this rank (see TensorIdTable). While the request
+  // is on the wire, the wire ID of the tensor, or -1 if it has none yet, in
+  // which case the tensor name is set instead.
+  int32_t tensor_id() const;
+  void set_tensor_id(int32_t value);
+
+  // Reduction operation of an allreduce.
+  ReduceOp reduce_op() const;
+  void set_reduce_op(ReduceOp value);
+
+  // Hash of the fields that must agree across ranks: data type, operation,
+  // reduction operation, shape (except dimension zero for allgather), root
+  // rank and whether the device is a CPU. Requests with different signatures
+  // do not match.
+  uint64_t signature() const;
+  void set_signature(uint64_t value);
+  static uint64_t ComputeSignature(const MPIRequest& request);
+
+  // Tensors with a higher priority are reduced before tensors with a lower
+  // priority once they are ready on all ranks. Not part of the signature.
+  int32_t priority() const;
+  void set_priority(int32_t value);
+
+  // Ranks of a node whose requests this request stands for, with hierarchical
+  // negotiation. Node leaders forward a single request per tensor once all
+  // ranks of their node made requests that match it, along with the device
+  // and dimension zero of the tensor (0 for scalars) of every node rank, in
+  // the order of node_ranks. Empty for the request of request_rank alone.
+  const std::vector<int32_t>& node_ranks() const;
+  const std::vector<int32_t>& node_devices() const;
+  const std::vector<int64_t>& node_first_dims() const;
+  void add_node_rank(int32_t rank, int32_t device, int64_t first_dim);
+  void clear_node_ranks();
+
   static void ParseFromString(MPIRequest& request, const std::string& input);
   static void SerializeToString(MPIRequest& request, std::string& output);
 
@@ -81,13 +135,21 @@ private:
   MPIDataType tensor_type_ = MPIDataType::HOROVOD_UINT8;
   int32_t root_rank_ = 0;
   int32_t device_ = 0;
+  int32_t tensor_id_ = -1;
+  uint64_t signature_ = 0;
+  int32_t priority_ = 0;
+  ReduceOp reduce_op_ = ReduceOp::SUM;
   std::string tensor_name_;
   std::vector<int64_t> tensor_shape_;
+  std::vector<int32_t> node_ranks_;
+  std::vector<int32_t> node_devices_;
+  std::vector<int64_t> node_first_dims_;
 };
 
 class MPIRequestList {
 public:
   const std::vector<MPIRequest>& requests() const;
+  std::vector<MPIRequest>& mutable_requests();
   void set_requests(const std::vector<MPIRequest>& value);
   void add_requests(const MPIRequest& value);
   bool shutdown() const;
@@ -122,7 +184,8 @@ public:
   ResponseType response_type() const;
   void set_response_type(ResponseType value);
 
-  // Empty if the type is DONE or SHUTDOWN.
+  // Names of the tensors without a wire ID, in order. Only set while the
+  // response is on the wire.
   const std::vector<std::string>& tensor_names() const;
   void set_tensor_names(const std::vector<std::string>& value);
   void add_tensor_names(const std::string& value);
@@ -137,11 +200,28 @@ public:
 
   // Empty unless response_type is ALLGATHER.
   // These tensor sizes are the dimension zero sizes of all the input matrices,
-  // indexed by the rank.
+  // indexed by the rank. Fused allgathers hold the sizes of every tensor one
+  // after another.
   const std::vector<int64_t>& tensor_sizes() const;
   void set_tensor_sizes(const std::vector<int64_t>& value);
   void add_tensor_sizes(int64_t value);
 
+  // Local IDs of the tensors on this rank (see TensorIdTable). If there is
+  // more than one, this is a fused operation. While the response is on the
+  // wire, the wire IDs of the tensors, or -1 for tensors without one, whose
+  // names are in tensor_names.
+  const std::vector<int32_t>& tensor_ids() const;
+  void set_tensor_ids(const std::vector<int32_t>& value);
+  void add_tensor_ids(int32_t value);
+
+  // Highest priority of the tensors in this response.
+  int32_t priority() const;
+  void set_priority(int32_t value);
+
+  // Reduction operation of an allreduce, shared by all fused tensors.
+  ReduceOp reduce_op() const;
+  void set_reduce_op(ReduceOp value);
+
   static void ParseFromString(MPIResponse& response, const std::string& input);
   static void SerializeToString(MPIResponse& response, std::string& output);
 
@@ -151,11 +231,15 @@ private:
   std::string error_message_;
   std::vector<int32_t> devices_;
   std::vector<int64_t> tensor_sizes_;
+  std::vector<int32_t> tensor_ids_;
+  int32_t priority_ = 0;
+  ReduceOp reduce_op_ = ReduceOp::SUM;
 };
 
 class MPIResponseList {
 public:
   const std::vector<MPIResponse>& responses() const;
+  std::vector<MPIResponse>& mutable_responses();
   void set_responses(const std::vector<MPIResponse>& value);
   void add_responses(const MPIResponse& value);
   bool shutdown() const;
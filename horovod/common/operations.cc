@@ -14,14 +14,17 @@
 // limitations under the License.
 // =============================================================================
 
+#include <algorithm>
 #include <atomic>
 #include <cassert>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
+#include <fstream>
 #include <queue>
 #include <sstream>
 #include <thread>
 #include <unordered_map>
-#include <unordered_set>
 
 #if HAVE_CUDA
 #include <cuda_runtime.h>
@@ -36,11 +39,18 @@
 #endif
 
 #define OMPI_SKIP_MPICXX
+#include "algorithm_registry.h"
+#include "allreduce_algorithms.h"
+#include "autotuner.h"
 #include "half.h"
 #include "hashes.h"
+#include "memcpy_pool.h"
 #include "mpi.h"
 #include "mpi_message.h"
 #include "operations.h"
+#include "reduction_pool.h"
+#include "response_cache.h"
+#include "tensor_id_table.h"
 #include "timeline.h"
 
 /*
@@ -74,8 +84,8 @@ namespace common {
 
 namespace {
 
-// Table storing Tensors to be reduced, keyed by unique name.
-// This table contains everything necessary to do the reduction.
+// Table storing Tensors to be reduced, keyed by the local ID of their unique
+// name. This table contains everything necessary to do the reduction.
 struct TensorTableEntry {
   // Name of the tensor.
   std::string tensor_name;
@@ -91,17 +101,90 @@ struct TensorTableEntry {
   std::shared_ptr<ReadyEvent> ready_event;
   // GPU to do reduction on, or CPU_DEVICE_ID in case of CPU.
   int device = CPU_DEVICE_ID;
+  // Factors that the elements of an allreduce are multiplied by before and
+  // after the reduction, while they are copied.
+  double prescale_factor = 1.0;
+  double postscale_factor = 1.0;
   // A callback to call with the status.
   StatusCallback callback;
 };
-using TensorTable = std::unordered_map<std::string, TensorTableEntry>;
+using TensorTable = std::unordered_map<int32_t, TensorTableEntry>;
+
+// Tensor metadata stored on rank zero until all ranks are ready for the
+// tensor. Requests are checked against the first request for the tensor as
+// they arrive, so only the values that may differ between ranks are kept per
+// rank.
+struct MessageTableEntry {
+  // Request of the first rank that was ready for the tensor.
+  MPIRequest request;
+
+  // Bitset of ranks that are ready for the tensor, and their number.
+  std::vector<uint64_t> ready_ranks;
+  int ready_count = 0;
+
+  // Devices indexed by rank. Empty as long as all ranks use the device of the
+  // first request.
+  std::vector<int32_t> devices;
+
+  // Dimension zero sizes of allgather inputs indexed by rank.
+  std::vector<int64_t> tensor_sizes;
+
+  // Description of the first mismatch between the requests, if any.
+  std::string error_message;
+
+  // Time point when the first request arrived.
+  std::chrono::steady_clock::time_point start_at;
+};
 
 // Table for storing Tensor metadata on rank zero. This is used for error
 // checking, stall checking and size calculations, as well as determining
 // when a reduction is ready to be done (when all nodes are ready to do it).
-using MessageTable = std::unordered_map<
-    std::string,
-    std::tuple<std::vector<MPIRequest>, std::chrono::steady_clock::time_point>>;
+// Keyed by local tensor ID.
+using MessageTable = std::unordered_map<int32_t, MessageTableEntry>;
+
+struct NodeRequestTableEntry {
+  // Request of the first rank of the node that was ready for the tensor. Its
+  // node ranks are the ranks of the node whose requests have its signature.
+  MPIRequest request;
+
+  // Requests of ranks of the node whose signature differs from the first
+  // request. They are forwarded as they are, so that the coordinator reports
+  // the mismatch.
+  std::vector<MPIRequest> mismatched_requests;
+
+  // Time point when the first request arrived.
+  std::chrono::steady_clock::time_point start_at;
+};
+
+// Table of requests kept by local rank zero of every node with hierarchical
+// negotiation, until all ranks of the node are ready for the tensor. The
+// matching requests of a tensor are then forwarded to the coordinator as a
+// single request. Keyed by local tensor ID.
+using NodeRequestTable = std::unordered_map<int32_t, NodeRequestTableEntry>;
+
+// Shortest time the background thread waits for requests between cycles in
+// event-driven mode.
+#define IDLE_BACKOFF_MIN std::chrono::microseconds(50)
+
+// A collective operation in host memory that was started, but not completed.
+struct InFlightOperation {
+  // Tensors of the operation.
+  std::vector<TensorTableEntry> entries;
+  // Position of the fusion buffer used by the operation in the ring of fusion
+  // buffers, or -1 if the operation does not use a fusion buffer.
+  int buffer_index = -1;
+  // Request of the nonblocking collective.
+  MPI_Request request = MPI_REQUEST_NULL;
+  // Copies out of the fusion buffer, performed once the request completed.
+  std::vector<MemcpyTask> copies;
+  // Counts and displacements of an allgather, which must remain valid until
+  // the request completed.
+  std::vector<int> recvcounts;
+  std::vector<int> displcmnts;
+  // Whether the request completed, and its status.
+  bool done = false;
+  Status status;
+};
 
 // The global state required for the MPI ops.
 //
@@ -132,17 +215,47 @@ struct HorovodGlobalState {
   // Whether Horovod should finalize MPI (only if it has initialized it).
   bool should_finalize = false;
 
-  // Only exists on the coordinator node (rank zero). Maintains a count of
-  // how many nodes are ready to allreduce every tensor (keyed by tensor
-  // name) and time point when tensor started allreduce op.
+  // Only exists on the coordinator node (rank zero), or on every shard
+  // coordinator with sharded negotiation. Maintains a count of how many nodes
+  // are ready to allreduce every tensor (keyed by local tensor ID) and time
+  // point when tensor started allreduce op.
   std::unique_ptr<MessageTable> message_table;
 
+  // Only exists on local rank zero of every node when hierarchical negotiation
+  // is enabled. Holds requests of tensors which some, but not all, ranks of
+  // the node are ready for.
+  std::unique_ptr<NodeRequestTable> node_request_table;
+
   // Time point when coordinator last checked for stalled tensors.
   std::chrono::steady_clock::time_point last_stall_check;
 
   // Flag indicating whether to perform stall tensor check.
   bool perform_stall_check = true;
 
+  // Maximum number of responses held by the response cache.
+  uint32_t cache_capacity = 1024;
+
+  // Responses of tensors negotiated in previous ticks. Repeated requests for
+  // these tensors are coordinated by exchanging cache bits instead of going
+  // through the coordinator.
+  ResponseCache response_cache;
+
+  // Requests that hit the response cache and are waiting for the remaining
+  // ranks to report the same cache bit, keyed by local tensor ID, along with
+  // the time point when they were first seen.
+  std::unordered_map<int32_t,
+                     std::tuple<MPIRequest, std::chrono::steady_clock::time_point>>
+      cache_hits;
+
+  // Requests sent through full negotiation while the response cache is
+  // enabled, keyed by local tensor ID. Responses to them are cached on
+  // arrival.
+  std::unordered_map<int32_t, MPIRequest> uncached_requests;
+
+  // Interned tensor names. Local tensor IDs key the tables above, and wire IDs
+  // are sent instead of names in requests and responses.
+  TensorIdTable tensor_ids;
+
   // Timeline writer.
   Timeline timeline;
 
@@ -150,6 +263,49 @@ struct HorovodGlobalState {
   // threshold will be fused.
   int64_t tensor_fusion_threshold = 64 * 1024 * 1024;
 
+  // Fusion thresholds are rounded up to a multiple of this many bytes.
+  int64_t fusion_threshold_unit = 1;
+
+  // Size in bytes of the fusion buffers, which is the largest fusion
+  // threshold the autotuner may choose.
+  int64_t fusion_buffer_size = 0;
+
+  // Tunes the fusion threshold and the cycle time on the coordinator while
+  // autotune is set. The autotuner receives the bytes performed by every
+  // cycle, and saves the best parameters to autotune_file.
+  AutoTuner autotuner;
+  std::atomic_bool autotune {false};
+  std::atomic<int64_t> autotune_bytes {0};
+  std::string autotune_file;
+
+  // Size in bytes of the chunks in which fused tensors in host memory are
+  // copied and reduced in a pipeline by the pipelined allreduce.
+  int64_t fusion_chunk_size = 4 * 1024 * 1024;
+
+  // Size in bytes of the segments in which the ring allreduce sends blocks.
+  int64_t ring_segment_size = 1024 * 1024;
+
+  // Rules that choose the algorithm of every collective operation. Only the
+  // background thread modifies them, under mutex.
+  AlgorithmRegistry algorithms;
+
+  // Rules set by the frameworks that have not replaced algorithms yet. The
+  // background thread applies them along with the requests enqueued after
+  // them. Guarded by mutex.
+  std::unique_ptr<AlgorithmRegistry> pending_algorithms;
+
+  // Buffer that receives the data of other ranks in the built-in allreduce
+  // algorithms.
+  std::vector<uint8_t> allreduce_buffer;
+
+  // Only fuse tensors that are next to each other in the order in which they
+  // became ready, instead of packing all ready tensors into fused responses.
+  bool ordered_fusion = false;
+
+  // Threads that copy tensors in host memory into and out of the fusion
+  // buffer.
+  MemcpyPool memcpy_pool;
+
   // Background thread cycle time in milliseconds.  Fractional numbers are
   // permitted.
   double cycle_time_ms = 5;
@@ -157,13 +313,45 @@ struct HorovodGlobalState {
   // Time point when last cycle started.
   std::chrono::steady_clock::time_point last_cycle_start;
 
+  // Start a cycle as soon as requests are enqueued instead of waiting for the
+  // cycle time to pass. The cycle time then caps the idle backoff.
+  bool event_driven_cycle = false;
+
+  // Signalled when requests are enqueued or shutdown is requested. Used with
+  // the mutex above.
+  std::condition_variable cycle_cv;
+
+  // Time in milliseconds to wait for more requests after being woken up, so
+  // that they are negotiated and fused together.
+  double cycle_batch_time_ms = 0;
+
+  // Time to wait for requests before starting an idle cycle. Doubles with
+  // every idle cycle and is reset once there is work to do.
+  std::chrono::steady_clock::duration idle_backoff = IDLE_BACKOFF_MIN;
+
   // Memory buffers for Tensor Fusion.  They are keyed off device ID and
   // framework, and all are allocated tensor_fusion_threshold bytes if
-  // initialized.
+  // initialized. Every key has a ring of num_fusion_buffers buffers.
   std::unordered_map<std::tuple<int, Framework>,
-                     std::shared_ptr<PersistentBuffer>>
+                     std::vector<std::shared_ptr<PersistentBuffer>>>
       tensor_fusion_buffers;
 
+  // Number of fusion buffers per device and framework. In-flight operations
+  // take turns in the ring of fusion buffers.
+  int num_fusion_buffers = 1;
+
+  // Position in the ring of fusion buffers of the next in-flight operation.
+  int next_fusion_buffer = 0;
+
+  // Maximum number of collective operations in host memory that are started
+  // without waiting for the previous ones to complete. Defaults to the number
+  // of fusion buffers.
+  int max_in_flight = 0;
+
+  // Operations started but not completed, in the order in which they were
+  // started. Only accessed by the thread performing the operations.
+  std::deque<InFlightOperation> in_flight_operations;
+
   // Whether MPI_Init has been completed on the background thread.
   std::atomic_bool initialization_done {false};
 
@@ -183,9 +371,12 @@ struct HorovodGlobalState {
   // COMM_WORLD ranks of processes running on this node.
   std::vector<int> local_comm_ranks;
 
-  // MPI custom data type for float16.
-  MPI_Datatype mpi_float16_t;
-  MPI_Op mpi_float16_sum;
+  // MPI custom data types for float16 and bfloat16, and their sum, min, max
+  // and product operations, indexed by ReduceOp.
+  MPI_Datatype mpi_float16_t = MPI_DATATYPE_NULL;
+  MPI_Op mpi_float16_ops[4];
+  MPI_Datatype mpi_bfloat16_t = MPI_DATATYPE_NULL;
+  MPI_Op mpi_bfloat16_ops[4];
 
   // Private MPI communicator for Horovod to ensure no collisions with other
   // threads using MPI.
@@ -197,8 +388,34 @@ struct HorovodGlobalState {
   // Cross-node communicator for hierarchical allreduce.
   MPI_Comm cross_comm;
 
-  // Do hierarchical allreduce with MPI + NCCL.
-  bool hierarchical_allreduce = false;
+  // Negotiate through local rank zero of every node, so that the coordinator
+  // only exchanges messages with one rank per node.
+  bool hierarchical_negotiation = false;
+
+  // Number of ranks coordinating negotiation. Tensors are assigned to the
+  // coordinators by a hash of their name.
+  int coordinator_shards = 1;
+
+  // Communicators used for negotiation. They are duplicates of the
+  // communicators above if negotiation overlaps with execution, and the same
+  // communicators otherwise.
+  MPI_Comm negotiation_comm;
+  MPI_Comm negotiation_local_comm;
+  MPI_Comm negotiation_cross_comm;
+
+  // Perform the collective operations on a separate execution thread, so that
+  // the background thread can negotiate the next tick in the meantime.
+  bool overlap_negotiation = false;
+
+  // Thread performing the collective operations, and the queue of responses
+  // it performs in order. Guarded by execution_mutex.
+  std::thread execution_thread;
+  std::mutex execution_mutex;
+  std::condition_variable execution_cv;
+  std::queue<MPIResponse> execution_queue;
+
+  // Set once the background thread queued its last response.
+  bool execution_done = false;
 
 // The CUDA stream used for data transfers and within-allreduce operations.
 // A naive implementation would use the TensorFlow StreamExecutor CUDA
@@ -238,6 +455,7 @@ struct HorovodGlobalState {
     // destructor cannot be called.
     if (background_thread.joinable()) {
       shut_down = true;
+      cycle_cv.notify_one();
       background_thread.join();
     }
   }
@@ -276,242 +494,242 @@ const Status DUPLICATE_NAME_ERROR = Status::InvalidArgument(
     return;                                                                    \
   }
 
-// Store the MPIRequest for a name, and return whether the total count of
-// MPIRequests for that tensor is now equal to the MPI size (and thus we are
-// ready to reduce the tensor).
-bool IncrementTensorCount(std::unique_ptr<MessageTable>& message_table,
-                          MPIRequest msg, int mpi_size) {
-  auto& name = msg.tensor_name();
-  auto& timeline = horovod_global.timeline;
-  auto table_iter = message_table->find(name);
-  if (table_iter == message_table->end()) {
-    std::vector<MPIRequest> messages = {msg};
-    auto now = std::chrono::steady_clock::now();
-    message_table->emplace(name, std::make_tuple(std::move(messages), now));
-    table_iter = message_table->find(name);
-    timeline.NegotiateStart(name, msg.request_type());
-  } else {
-    std::vector<MPIRequest>& messages = std::get<0>(table_iter->second);
-    messages.push_back(msg);
-  }
-
-  timeline.NegotiateRankReady(name, msg.request_rank());
-
-  std::vector<MPIRequest>& messages = std::get<0>(table_iter->second);
-  int count = (int)messages.size();
-  bool ready_to_reduce = count == mpi_size;
-  if (ready_to_reduce) {
-    timeline.NegotiateEnd(name);
-  }
-  return ready_to_reduce;
-}
-
-// Once a tensor is ready to be reduced, the coordinator sends an MPIResponse
-// instructing all ranks to start the reduction to all ranks. The MPIResponse
-// also contains error messages in case the submitted MPIRequests were not
-// valid (for example, contained mismatched shapes or types).
-//
-// Constructing the MPIResponse, thus, requires a whole lot of error checking.
-MPIResponse ConstructMPIResponse(std::unique_ptr<MessageTable>& message_table,
-                                 std::string name) {
-  bool error = false;
-  auto it = message_table->find(name);
-  assert(it != message_table->end());
-
-  std::vector<MPIRequest>& requests = std::get<0>(it->second);
-  assert(requests.size() > 0);
-
+// Check a request against the first request for the same tensor. Returns a
+// description of the mismatch, or an empty string if the requests agree.
+std::string CheckRequest(const MPIRequest& first, const MPIRequest& request) {
   std::ostringstream error_message_stream;
 
   // Check that all data types of tensors being reduced, gathered or broadcasted
   // are identical.
-  auto data_type = requests[0].tensor_type();
-  for (unsigned int i = 1; i < requests.size(); i++) {
-    auto request_type = requests[i].tensor_type();
-    if (data_type != request_type) {
-      error = true;
-      error_message_stream << "Mismatched data types: One rank had type "
-                           << MPIDataType_Name(data_type)
-                           << ", but another rank had type "
-                           << MPIDataType_Name(request_type) << ".";
-      break;
-    }
+  auto data_type = first.tensor_type();
+  auto request_data_type = request.tensor_type();
+  if (data_type != request_data_type) {
+    error_message_stream << "Mismatched data types: One rank had type "
+                         << MPIDataType_Name(data_type)
+                         << ", but another rank had type "
+                         << MPIDataType_Name(request_data_type) << ".";
+    return error_message_stream.str();
   }
 
   // Check that all requested operations are the same
-  auto message_type = requests[0].request_type();
-  for (unsigned int i = 1; i < requests.size(); i++) {
-    if (error) {
-      break;
-    }
+  auto message_type = first.request_type();
+  auto request_type = request.request_type();
+  if (message_type != request_type) {
+    error_message_stream << "Mismatched MPI operations: One rank did an "
+                         << MPIRequest::RequestType_Name(message_type)
+                         << ", but another rank did an "
+                         << MPIRequest::RequestType_Name(request_type) << ".";
+    return error_message_stream.str();
+  }
 
-    auto request_type = requests[i].request_type();
-    if (message_type != request_type) {
-      error = true;
-      error_message_stream << "Mismatched MPI operations: One rank did an "
-                           << MPIRequest::RequestType_Name(message_type)
-                           << ", but another rank did an "
-                           << MPIRequest::RequestType_Name(request_type) << ".";
-      break;
-    }
+  // Check that all ranks reduce with the same operation.
+  if (message_type == MPIRequest::ALLREDUCE &&
+      first.reduce_op() != request.reduce_op()) {
+    error_message_stream << "Mismatched "
+                         << MPIRequest::RequestType_Name(message_type)
+                         << " reduction operations: One rank specified "
+                         << ReduceOp_Name(first.reduce_op())
+                         << ", but another rank specified "
+                         << ReduceOp_Name(request.reduce_op()) << ".";
+    return error_message_stream.str();
+  }
+
+  TensorShape tensor_shape;
+  for (auto dim : first.tensor_shape()) {
+    tensor_shape.AddDim(dim);
+  }
+  TensorShape request_shape;
+  for (auto dim : request.tensor_shape()) {
+    request_shape.AddDim(dim);
   }
 
   // If we are doing an allreduce or broadcast, check that all tensor shapes are
   // identical.
   if (message_type == MPIRequest::ALLREDUCE ||
       message_type == MPIRequest::BROADCAST) {
-    TensorShape tensor_shape;
-    for (auto dim : requests[0].tensor_shape()) {
-      tensor_shape.AddDim(dim);
-    }
-    for (unsigned int i = 1; i < requests.size(); i++) {
-      if (error) {
-        break;
-      }
-
-      TensorShape request_shape;
-      for (auto dim : requests[i].tensor_shape()) {
-        request_shape.AddDim(dim);
-      }
-      if (tensor_shape != request_shape) {
-        error = true;
-        error_message_stream
-            << "Mismatched " << MPIRequest::RequestType_Name(message_type)
-            << " tensor shapes: One rank sent a tensor of shape "
-            << tensor_shape.DebugString()
-            << ", but another rank sent a tensor of shape "
-            << request_shape.DebugString() << ".";
-        break;
-      }
+    if (tensor_shape != request_shape) {
+      error_message_stream
+          << "Mismatched " << MPIRequest::RequestType_Name(message_type)
+          << " tensor shapes: One rank sent a tensor of shape "
+          << tensor_shape.DebugString()
+          << ", but another rank sent a tensor of shape "
+          << request_shape.DebugString() << ".";
+      return error_message_stream.str();
     }
   }
 
   // If we are doing an allgather, make sure all but the first dimension are
   // the same. The first dimension may be different and the output tensor is
-  // the sum of the first dimension. Collect the sizes by rank.
-  std::vector<int64_t> tensor_sizes(requests.size());
+  // the sum of the first dimension.
   if (message_type == MPIRequest::ALLGATHER) {
-    TensorShape tensor_shape;
-    for (auto dim : requests[0].tensor_shape()) {
-      tensor_shape.AddDim(dim);
-    }
-
-    if (tensor_shape.dims() == 0) {
-      error = true;
-      error_message_stream << "Rank zero tried to "
-                           << MPIRequest::RequestType_Name(message_type)
-                           << " a rank-zero tensor.";
-    } else {
-      tensor_sizes[requests[0].request_rank()] = tensor_shape.dim_size(0);
+    if (tensor_shape.dims() != request_shape.dims()) {
+      error_message_stream
+          << "Mismatched " << MPIRequest::RequestType_Name(message_type)
+          << " tensor shapes: One rank sent a tensor of rank "
+          << tensor_shape.dims()
+          << ", but another rank sent a tensor of rank "
+          << request_shape.dims() << ".";
+      return error_message_stream.str();
     }
 
-    for (unsigned int i = 1; i < requests.size(); i++) {
-      if (error) {
-        break;
-      }
-
-      TensorShape request_shape;
-      for (auto dim : requests[i].tensor_shape()) {
-        request_shape.AddDim(dim);
-      }
-      if (tensor_shape.dims() != request_shape.dims()) {
-        error = true;
+    for (int dim = 1; dim < tensor_shape.dims(); dim++) {
+      if (tensor_shape.dim_size(dim) != request_shape.dim_size(dim)) {
         error_message_stream
             << "Mismatched " << MPIRequest::RequestType_Name(message_type)
-            << " tensor shapes: One rank sent a tensor of rank "
-            << tensor_shape.dims()
-            << ", but another rank sent a tensor of rank "
-            << request_shape.dims() << ".";
-        break;
+            << " tensor shapes: One rank sent a tensor with dimension " << dim
+            << " equal to " << tensor_shape.dim_size(dim)
+            << ", but another rank sent a tensor with dimension " << dim
+            << " equal to " << request_shape.dim_size(dim) << ".";
+        return error_message_stream.str();
       }
-
-      bool dim_mismatch = false;
-      for (int dim = 1; dim < tensor_shape.dims(); dim++) {
-        if (tensor_shape.dim_size(dim) != request_shape.dim_size(dim)) {
-          error = true;
-          error_message_stream
-              << "Mismatched " << MPIRequest::RequestType_Name(message_type)
-              << " tensor shapes: One rank sent a tensor with dimension " << dim
-              << " equal to " << tensor_shape.dim_size(dim)
-              << ", but another rank sent a tensor with dimension " << dim
-              << " equal to " << request_shape.dim_size(dim) << ".";
-          dim_mismatch = true;
-          break;
-        }
-      }
-      if (dim_mismatch) {
-        break;
-      }
-
-      tensor_sizes[requests[i].request_rank()] = request_shape.dim_size(0);
     }
   }
 
   // If we are doing a broadcast, check that all root ranks are identical.
   if (message_type == MPIRequest::BROADCAST) {
-    int first_root_rank = requests[0].root_rank();
-    for (unsigned int i = 1; i < requests.size(); i++) {
-      if (error) {
-        break;
-      }
+    int first_root_rank = first.root_rank();
+    int this_root_rank = request.root_rank();
+    if (first_root_rank != this_root_rank) {
+      error_message_stream
+          << "Mismatched " << MPIRequest::RequestType_Name(message_type)
+          << " root ranks: One rank specified root rank " << first_root_rank
+          << ", but another rank specified root rank " << this_root_rank
+          << ".";
+      return error_message_stream.str();
+    }
+  }
 
-      int this_root_rank = requests[i].root_rank();
-      if (first_root_rank != this_root_rank) {
-        error = true;
-        error_message_stream
-            << "Mismatched " << MPIRequest::RequestType_Name(message_type)
-            << " root ranks: One rank specified root rank " << first_root_rank
-            << ", but another rank specified root rank " << this_root_rank
-            << ".";
-        break;
+  bool first_device_is_cpu = first.device() == CPU_DEVICE_ID;
+  bool this_device_is_cpu = request.device() == CPU_DEVICE_ID;
+  if (first_device_is_cpu != this_device_is_cpu) {
+    error_message_stream
+        << "Mismatched " << MPIRequest::RequestType_Name(message_type)
+        << " CPU/GPU device selection: One rank specified device "
+        << (first_device_is_cpu ? "CPU" : "GPU")
+        << ", but another rank specified device "
+        << (this_device_is_cpu ? "CPU" : "GPU") << ".";
+    return error_message_stream.str();
+  }
+
+  return std::string();
+}
+
+// Record that the rank of the MPIRequest, or all of its node ranks, are ready
+// for the tensor, and return whether all ranks are now ready (and thus we are
+// ready to reduce the tensor). The request is checked against the first
+// request for the tensor right away, so that no per-rank copies of the
+// requests have to be kept.
+bool IncrementTensorCount(std::unique_ptr<MessageTable>& message_table,
+                          const MPIRequest& msg, int mpi_size) {
+  auto tensor_id = msg.tensor_id();
+  auto& timeline = horovod_global.timeline;
+  std::string name;
+  if (timeline.Initialized()) {
+    name = horovod_global.tensor_ids.name(tensor_id);
+  }
+  auto table_iter = message_table->find(tensor_id);
+  if (table_iter == message_table->end()) {
+    MessageTableEntry entry;
+    entry.request = msg;
+    entry.request.clear_node_ranks();
+    entry.ready_ranks.resize((size_t)(mpi_size + 63) / 64);
+    entry.start_at = std::chrono::steady_clock::now();
+    if (msg.request_type() == MPIRequest::ALLGATHER) {
+      if (msg.tensor_shape().empty()) {
+        entry.error_message = "Rank zero tried to " +
+                              MPIRequest::RequestType_Name(msg.request_type()) +
+                              " a rank-zero tensor.";
       }
+      entry.tensor_sizes.resize((size_t)mpi_size);
     }
+    table_iter = message_table->emplace(tensor_id, std::move(entry)).first;
+    horovod_global.tensor_ids.Acquire(tensor_id);
+    timeline.NegotiateStart(name, msg.request_type());
+  } else if (table_iter->second.error_message.empty() &&
+             msg.signature() != table_iter->second.request.signature()) {
+    // Requests with equal signatures agree on all checked fields, so the
+    // detailed check only runs for requests that are likely mismatched.
+    table_iter->second.error_message =
+        CheckRequest(table_iter->second.request, msg);
   }
 
-  bool first_device_is_cpu = requests[0].device() == CPU_DEVICE_ID;
-  for (unsigned int i = 1; i < requests.size(); i++) {
-    if (error) {
-      break;
-    }
+  auto& entry = table_iter->second;
+  auto rank_ready = [&](int32_t rank, int32_t device, int64_t first_dim) {
+    assert((entry.ready_ranks[rank / 64] & (1ull << (rank % 64))) == 0);
+    entry.ready_ranks[rank / 64] |= 1ull << (rank % 64);
+    entry.ready_count++;
 
-    bool this_device_is_cpu = requests[i].device() == CPU_DEVICE_ID;
-    if (first_device_is_cpu != this_device_is_cpu) {
-      error = true;
-      error_message_stream
-          << "Mismatched " << MPIRequest::RequestType_Name(message_type)
-          << " CPU/GPU device selection: One rank specified device "
-          << (first_device_is_cpu ? "CPU" : "GPU")
-          << ", but another rank specified device "
-          << (this_device_is_cpu ? "CPU" : "GPU") << ".";
-      break;
+    if (entry.devices.empty() && device != entry.request.device()) {
+      entry.devices.assign((size_t)mpi_size, entry.request.device());
+    }
+    if (!entry.devices.empty()) {
+      entry.devices[rank] = device;
     }
+    if (!entry.tensor_sizes.empty()) {
+      entry.tensor_sizes[rank] = first_dim;
+    }
+
+    timeline.NegotiateRankReady(name, rank);
+  };
+
+  // A request forwarded by a node leader counts for all of its node ranks at
+  // once.
+  auto& node_ranks = msg.node_ranks();
+  if (node_ranks.empty()) {
+    auto& shape = msg.tensor_shape();
+    rank_ready(msg.request_rank(), msg.device(), shape.empty() ? 0 : shape[0]);
+  }
+  for (size_t i = 0; i < node_ranks.size(); i++) {
+    rank_ready(node_ranks[i], msg.node_devices()[i],
+               msg.node_first_dims()[i]);
   }
-  std::vector<int32_t> devices(requests.size());
-  for (auto& request : requests) {
-    devices[request.request_rank()] = request.device();
+
+  bool ready_to_reduce = entry.ready_count == mpi_size;
+  if (ready_to_reduce) {
+    timeline.NegotiateEnd(name);
   }
+  return ready_to_reduce;
+}
+
+// Once a tensor is ready to be reduced, the coordinator sends an MPIResponse
+// instructing all ranks to start the reduction to all ranks. The MPIResponse
+// also contains error messages in case the submitted MPIRequests were not
+// valid (for example, contained mismatched shapes or types), which were
+// detected by IncrementTensorCount as the requests arrived.
+MPIResponse ConstructMPIResponse(std::unique_ptr<MessageTable>& message_table,
+                                 int32_t tensor_id) {
+  auto it = message_table->find(tensor_id);
+  assert(it != message_table->end());
+
+  auto& entry = it->second;
+  auto message_type = entry.request.request_type();
 
   MPIResponse response;
-  response.add_tensor_names(name);
-  if (error) {
-    std::string error_message = error_message_stream.str();
+  response.add_tensor_ids(tensor_id);
+  response.set_priority(entry.request.priority());
+  if (!entry.error_message.empty()) {
     response.set_response_type(MPIResponse::ERROR);
-    response.set_error_message(error_message);
+    response.set_error_message(entry.error_message);
   } else if (message_type == MPIRequest::ALLGATHER) {
     response.set_response_type(MPIResponse::ALLGATHER);
-    for (auto dim : tensor_sizes) {
-      response.add_tensor_sizes(dim);
-    }
+    response.set_tensor_sizes(entry.tensor_sizes);
   } else if (message_type == MPIRequest::ALLREDUCE) {
     response.set_response_type(MPIResponse::ALLREDUCE);
+    response.set_reduce_op(entry.request.reduce_op());
   } else if (message_type == MPIRequest::BROADCAST) {
     response.set_response_type(MPIResponse::BROADCAST);
   }
-  response.set_devices(devices);
+  if (entry.devices.empty()) {
+    response.set_devices(std::vector<int32_t>((size_t)entry.ready_count,
+                                              entry.request.device()));
+  } else {
+    response.set_devices(entry.devices);
+  }
 
-  // Clear all queued up requests for this name. They are now taken care of
+  // Clear all queued up requests for this tensor. They are now taken care of
   // by the constructed MPI response.
   message_table->erase(it);
+  horovod_global.tensor_ids.Release(tensor_id);
 
   return response;
 }
@@ -532,6 +750,8 @@ MPI_Datatype GetMPIDataType(const std::shared_ptr<Tensor> tensor) {
     return MPI_INT64_T;
   case HOROVOD_FLOAT16:
     return horovod_global.mpi_float16_t;
+  case HOROVOD_BFLOAT16:
+    return horovod_global.mpi_bfloat16_t;
   case HOROVOD_FLOAT32:
     return MPI_FLOAT;
   case HOROVOD_FLOAT64:
@@ -544,7 +764,56 @@ MPI_Datatype GetMPIDataType(const std::shared_ptr<Tensor> tensor) {
   }
 }
 
+// MPI has no reduction of 16-bit floats, which use custom operations. Bitwise
+// operations of booleans are the logical ones.
+MPI_Op GetMPIReduceOp(const std::shared_ptr<Tensor> tensor, ReduceOp op) {
+  switch (tensor->dtype()) {
+  case HOROVOD_FLOAT16:
+    return horovod_global.mpi_float16_ops[(int)op];
+  case HOROVOD_BFLOAT16:
+    return horovod_global.mpi_bfloat16_ops[(int)op];
+  default:
+    break;
+  }
+  bool is_bool = tensor->dtype() == HOROVOD_BOOL;
+  switch (op) {
+  case ReduceOp::SUM:
+    return MPI_SUM;
+  case ReduceOp::MIN:
+    return MPI_MIN;
+  case ReduceOp::MAX:
+    return MPI_MAX;
+  case ReduceOp::PRODUCT:
+    return MPI_PROD;
+  case ReduceOp::BAND:
+    return is_bool ? MPI_LAND : MPI_BAND;
+  case ReduceOp::BOR:
+    return is_bool ? MPI_LOR : MPI_BOR;
+  case ReduceOp::BXOR:
+    return is_bool ? MPI_LXOR : MPI_BXOR;
+  default:
+    throw std::logic_error("Reduction operation " + ReduceOp_Name(op) +
+                           " is not supported in MPI mode.");
+  }
+}
+
 #if HAVE_NCCL
+ncclRedOp_t GetNCCLReduceOp(ReduceOp op) {
+  switch (op) {
+  case ReduceOp::SUM:
+    return ncclSum;
+  case ReduceOp::MIN:
+    return ncclMin;
+  case ReduceOp::MAX:
+    return ncclMax;
+  case ReduceOp::PRODUCT:
+    return ncclProd;
+  default:
+    throw std::logic_error("Reduction operation " + ReduceOp_Name(op) +
+                           " is not supported in NCCL mode.");
+  }
+}
+
 ncclDataType_t GetNCCLDataType(const std::shared_ptr<Tensor> tensor) {
   switch (tensor->dtype()) {
   case HOROVOD_INT32:
@@ -709,6 +978,216 @@ cudaError_t ReleaseCudaEvent(cudaEvent_t event) {
     }                                                                          \
   }
 
+// Returns the fusion buffer at the given position in the ring of fusion buffers
+// of the device and framework of the entry.
+std::shared_ptr<PersistentBuffer>& FusionBuffer(const TensorTableEntry& entry,
+                                                int index = 0) {
+  auto& buffers = horovod_global.tensor_fusion_buffers[std::make_tuple(
+      entry.device, entry.context->framework())];
+  if (buffers.size() < (size_t)horovod_global.num_fusion_buffers) {
+    buffers.resize((size_t)horovod_global.num_fusion_buffers);
+  }
+  return buffers[index];
+}
+
+// Rules that apply to the operations enqueued from now on. The caller holds
+// state.mutex.
+const AlgorithmRegistry& CurrentAlgorithms(const HorovodGlobalState& state) {
+  return state.pending_algorithms ? *state.pending_algorithms
+                                  : state.algorithms;
+}
+
+// Look up the algorithm of an allreduce of the entries in the registry.
+const std::string&
+LookupAllreduceAlgorithm(const std::vector<TensorTableEntry>& entries) {
+  auto& first_entry = entries[0];
+  int64_t bytes = 0;
+  for (auto& e : entries) {
+    bytes += e.tensor->size();
+  }
+  return horovod_global.algorithms.Lookup(
+      MPIResponse::ALLREDUCE, first_entry.device != CPU_DEVICE_ID,
+      first_entry.tensor->dtype(), bytes, horovod_global.size);
+}
+
+// Algorithms that sum tensors in host memory.
+enum class AllreduceAlgorithm { MPI, PIPELINED, RING, RECURSIVE_DOUBLING };
+
+// Choose the algorithm that reduces the tensors of the entries with op in host
+// memory. Algorithms of the registry that cannot reduce the entries fall back
+// to MPI_Allreduce: pipelining only applies to fused tensors, and the built-in
+// algorithms do not support every data type and operation.
+AllreduceAlgorithm
+ChooseAllreduceAlgorithm(const std::vector<TensorTableEntry>& entries,
+                         ReduceOp op) {
+  auto& first_entry = entries[0];
+  if (first_entry.device != CPU_DEVICE_ID) {
+    return AllreduceAlgorithm::MPI;
+  }
+  auto& algorithm = LookupAllreduceAlgorithm(entries);
+  if (algorithm == "pipelined" && entries.size() > 1) {
+    return AllreduceAlgorithm::PIPELINED;
+  }
+  if (AllreduceAlgorithmsSupported(first_entry.tensor->dtype(), op)) {
+    if (algorithm == "ring") {
+      return AllreduceAlgorithm::RING;
+    }
+    if (algorithm == "recursive_doubling") {
+      return AllreduceAlgorithm::RECURSIVE_DOUBLING;
+    }
+  }
+  return AllreduceAlgorithm::MPI;
+}
+
+// Reduce count elements in buffer with op in place with a built-in allreduce
+// algorithm. Returns an MPI error code.
+int BuiltInAllreduce(AllreduceAlgorithm algorithm, void* buffer, int64_t count,
+                     MPIDataType dtype, ReduceOp op) {
+  if (algorithm == AllreduceAlgorithm::RING) {
+    return RingAllreduce(buffer, count, dtype, op, horovod_global.mpi_comm,
+                         horovod_global.ring_segment_size,
+                         horovod_global.allreduce_buffer);
+  }
+  return RecursiveDoublingAllreduce(buffer, count, dtype, op,
+                                    horovod_global.mpi_comm,
+                                    horovod_global.allreduce_buffer);
+}
+
+// Returns a copy of len bytes of a tensor of the entry that multiplies the
+// elements by factor, or a plain copy if the factor is 1.
+MemcpyTask ScaledCopy(const TensorTableEntry& e, void* dst, const void* src,
+                      size_t len, double factor) {
+  if (factor == 1.0) {
+    return MemcpyTask(dst, src, len);
+  }
+  int element_size;
+  MPI_Type_size(GetMPIDataType(e.tensor), &element_size);
+  return MemcpyTask(dst, src, len, GetScaleKernel(e.tensor->dtype()), factor,
+                    (size_t)element_size);
+}
+
+// Multiplies the elements of the output of the entry by factor in place,
+// unless the factor is 1.
+void ScaleOutput(const TensorTableEntry& e, double factor) {
+  if (factor != 1.0) {
+    horovod_global.memcpy_pool.Copy({ScaledCopy(
+        e, (void*)e.output->data(), e.output->data(),
+        (size_t)e.output->size(), factor)});
+  }
+}
+
+// Collective operations in host memory are left in flight when more than one
+// operation may be in flight, except for allreduces pipelined in chunks or
+// performed by a built-in algorithm.
+bool IsInFlightOperation(const MPIResponse& response,
+                         const std::vector<TensorTableEntry>& entries) {
+  if (horovod_global.max_in_flight <= 1 || entries.empty() ||
+      entries[0].device != CPU_DEVICE_ID) {
+    return false;
+  }
+  switch (response.response_type()) {
+  case MPIResponse::ALLREDUCE:
+    return ChooseAllreduceAlgorithm(entries, response.reduce_op()) ==
+           AllreduceAlgorithm::MPI;
+  case MPIResponse::ALLGATHER:
+  case MPIResponse::BROADCAST:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Mark an in-flight operation whose request completed as done, and copy its
+// results out of the fusion buffer.
+void FinishInFlightOperation(InFlightOperation& op, int mpi_result,
+                             const char* op_name) {
+  auto& timeline = horovod_global.timeline;
+  ACTIVITY_END_ALL(op.entries, timeline)
+  op.done = true;
+  if (mpi_result != MPI_SUCCESS) {
+    op.status = Status::UnknownError(std::string(op_name) +
+                                     " failed, see MPI output for details.");
+    return;
+  }
+  if (!op.copies.empty()) {
+    ACTIVITY_START_ALL(op.entries, timeline, MEMCPY_OUT_FUSION_BUFFER)
+    horovod_global.memcpy_pool.Copy(op.copies);
+    ACTIVITY_END_ALL(op.entries, timeline)
+  }
+}
+
+// Finish the in-flight operations whose requests completed, without waiting
+// for the others.
+void TestInFlightOperations() {
+  std::vector<InFlightOperation*> pending;
+  std::vector<MPI_Request> requests;
+  for (auto& op : horovod_global.in_flight_operations) {
+    if (!op.done) {
+      pending.push_back(&op);
+      requests.push_back(op.request);
+    }
+  }
+  if (requests.empty()) {
+    return;
+  }
+
+  int outcount = 0;
+  std::vector<int> indices(requests.size());
+  auto mpi_result =
+      MPI_Testsome((int)requests.size(), requests.data(), &outcount,
+                   indices.data(), MPI_STATUSES_IGNORE);
+  if (mpi_result != MPI_SUCCESS) {
+    for (auto op : pending) {
+      FinishInFlightOperation(*op, mpi_result, "MPI_Testsome");
+    }
+    return;
+  }
+  for (int i = 0; i < outcount; i++) {
+    FinishInFlightOperation(*pending[indices[i]], MPI_SUCCESS, "MPI_Testsome");
+  }
+}
+
+// Wait for the request of an in-flight operation and finish it.
+void WaitForInFlightOperation(InFlightOperation& op) {
+  if (!op.done) {
+    FinishInFlightOperation(op, MPI_Wait(&op.request, MPI_STATUS_IGNORE),
+                            "MPI_Wait");
+  }
+}
+
+// Call the callbacks of the finished operations at the front of the in-flight
+// operations. Callbacks are called in the order in which the operations were
+// started, which is the same on every rank, regardless of the order in which
+// the requests complete.
+void CallInFlightCallbacks() {
+  auto& timeline = horovod_global.timeline;
+  auto& in_flight_operations = horovod_global.in_flight_operations;
+  while (!in_flight_operations.empty() && in_flight_operations.front().done) {
+    auto op = std::move(in_flight_operations.front());
+    in_flight_operations.pop_front();
+    for (auto& e : op.entries) {
+      timeline.End(e.tensor_name, op.status.ok() ? e.output : nullptr);
+      e.callback(op.status);
+    }
+  }
+}
+
+// Complete all in-flight operations.
+void CompleteInFlightOperations() {
+  for (auto& op : horovod_global.in_flight_operations) {
+    WaitForInFlightOperation(op);
+  }
+  CallInFlightCallbacks();
+}
+
+// Start tracking the nonblocking collective of an operation that was started,
+// and call the callbacks of operations that completed in the meantime.
+void AddInFlightOperation(InFlightOperation op) {
+  horovod_global.in_flight_operations.push_back(std::move(op));
+  TestInFlightOperations();
+  CallInFlightCallbacks();
+}
+
 // Process an MPIResponse by doing a reduction, a gather, a broadcast, or
 // raising an error.
 void PerformOperation(TensorTable& tensor_table, MPIResponse response) {
@@ -717,9 +1196,9 @@ void PerformOperation(TensorTable& tensor_table, MPIResponse response) {
     // Lock on the tensor table.
     std::lock_guard<std::mutex> guard(horovod_global.mutex);
 
-    for (auto& name : response.tensor_names()) {
+    for (auto tensor_id : response.tensor_ids()) {
       // We should never fail at finding this key in the tensor table.
-      auto iter = tensor_table.find(name);
+      auto iter = tensor_table.find(tensor_id);
       assert(iter != tensor_table.end());
 
       assert(response.response_type() == MPIResponse::ALLREDUCE ||
@@ -732,7 +1211,45 @@ void PerformOperation(TensorTable& tensor_table, MPIResponse response) {
       // Clear the tensor table of this tensor and its callbacks; the rest of
       // this function takes care of it.
       tensor_table.erase(iter);
+      horovod_global.tensor_ids.Release(tensor_id);
+    }
+  }
+
+  if (horovod_global.autotune) {
+    int64_t bytes = 0;
+    for (auto& e : entries) {
+      bytes += e.tensor->size();
+    }
+    horovod_global.autotune_bytes += bytes;
+  }
+
+  // Other operations are performed once all in-flight operations completed,
+  // so that callbacks are called in the order of the responses. In-flight
+  // operations with several tensors take turns in the ring of fusion buffers,
+  // and wait for the previous operation in their fusion buffer.
+  bool in_flight = IsInFlightOperation(response, entries);
+  int buffer_index = 0;
+  if (in_flight) {
+    auto& in_flight_operations = horovod_global.in_flight_operations;
+    TestInFlightOperations();
+    while (in_flight_operations.size() >=
+           (size_t)horovod_global.max_in_flight) {
+      WaitForInFlightOperation(in_flight_operations.front());
+      CallInFlightCallbacks();
+    }
+    if (entries.size() > 1) {
+      buffer_index = horovod_global.next_fusion_buffer;
+      horovod_global.next_fusion_buffer =
+          (buffer_index + 1) % horovod_global.num_fusion_buffers;
+      for (auto& op : in_flight_operations) {
+        if (op.buffer_index == buffer_index) {
+          WaitForInFlightOperation(op);
+        }
+      }
     }
+    CallInFlightCallbacks();
+  } else {
+    CompleteInFlightOperations();
   }
 
   auto& timeline = horovod_global.timeline;
@@ -745,15 +1262,14 @@ void PerformOperation(TensorTable& tensor_table, MPIResponse response) {
     // Note: it is OK for different entries to come from different frameworks
     // since buffer allocated here is guaranteed to survive at least till the
     // end of this operation.
-    auto& buffer = horovod_global.tensor_fusion_buffers[std::make_tuple(
-        first_entry.device, first_entry.context->framework())];
+    auto& buffer = FusionBuffer(first_entry, buffer_index);
     if (buffer == nullptr) {
       ACTIVITY_START_ALL(entries, timeline, INIT_FUSION_BUFFER)
 
       // Lazily allocate persistent buffer for Tensor Fusion and keep it
       // forever per device.
       Status status = first_entry.context->AllocatePersistent(
-          horovod_global.tensor_fusion_threshold, &buffer);
+          horovod_global.fusion_buffer_size, &buffer);
       if (!status.ok()) {
         for (auto& e : entries) {
           timeline.End(e.tensor_name, nullptr);
@@ -794,69 +1310,226 @@ void PerformOperation(TensorTable& tensor_table, MPIResponse response) {
 
   Status status;
   if (response.response_type() == MPIResponse::ALLGATHER) {
-    assert(entries.size() == 1);
-    auto e = entries[0];
-
-    // Copy tensor sizes from the MPI response into a vector of int64_t
-    // and compute total size.  This is size of first dimension.
-    std::vector<int64_t> tensor_sizes;
-    int64_t total_dimension_size = 0;
-    for (auto sz : response.tensor_sizes()) {
-      tensor_sizes.push_back(sz);
-      total_dimension_size += sz;
-    }
+    // Tensor sizes hold the first dimension sizes of the tensor on every rank,
+    // one tensor after another for fused allgathers.
+    assert(response.tensor_sizes().size() % entries.size() == 0);
+    auto num_ranks = response.tensor_sizes().size() / entries.size();
+    auto tensor_sizes = [&response, num_ranks](size_t tensor, size_t rank) {
+      return response.tensor_sizes()[tensor * num_ranks + rank];
+    };
 
     // Every tensor participating in Allgather operation may have different
     // first dimension size, but the rest of dimensions are same for all
-    // tensors.  Here we get shape of tensor sliced by first dimension.
-    TensorShape single_slice_shape;
-    for (int i = 1; i < e.tensor->shape().dims(); ++i) {
-      single_slice_shape.AddDim(e.tensor->shape().dim_size(i));
-    }
-
-    // Allgather output will have shape of:
+    // tensors. Allgather output will have shape of:
     // (sum of first dimension of every tensor) x (tensor slice shape).
-    TensorShape output_shape;
-    output_shape.AddDim((int64_t)total_dimension_size);
-    output_shape.AppendShape(single_slice_shape);
-
     ACTIVITY_START_ALL(entries, timeline, ALLOCATE_OUTPUT)
-    status = e.context->AllocateOutput(output_shape, &e.output);
-    if (!status.ok()) {
-      timeline.End(e.tensor_name, nullptr);
-      e.callback(status);
-      return;
+    std::vector<int64_t> slice_elements;
+    for (size_t i = 0; i < entries.size(); i++) {
+      auto& e = entries[i];
+      TensorShape single_slice_shape;
+      for (int j = 1; j < e.tensor->shape().dims(); ++j) {
+        single_slice_shape.AddDim(e.tensor->shape().dim_size(j));
+      }
+      slice_elements.push_back(single_slice_shape.num_elements());
+
+      int64_t total_dimension_size = 0;
+      for (size_t rank = 0; rank < num_ranks; rank++) {
+        total_dimension_size += tensor_sizes(i, rank);
+      }
+      TensorShape output_shape;
+      output_shape.AddDim(total_dimension_size);
+      output_shape.AppendShape(single_slice_shape);
+
+      status = e.context->AllocateOutput(output_shape, &e.output);
+      if (!status.ok()) {
+        for (auto& entry : entries) {
+          timeline.End(entry.tensor_name, nullptr);
+          entry.callback(status);
+        }
+        return;
+      }
     }
     ACTIVITY_END_ALL(entries, timeline)
 
     // Tensors may have different first dimension, so we need to use
     // MPI_Allgatherv API that supports gathering arrays of different length.
-    ACTIVITY_START_ALL(entries, timeline, MPI_ALLGATHER)
-    auto* recvcounts = new int[tensor_sizes.size()];
-    auto* displcmnts = new int[tensor_sizes.size()];
-    for (unsigned int i = 0; i < tensor_sizes.size(); i++) {
-      recvcounts[i] =
-          (int)(single_slice_shape.num_elements() * tensor_sizes[i]);
-      if (i == 0) {
-        displcmnts[i] = 0;
-      } else {
-        displcmnts[i] = recvcounts[i - 1] + displcmnts[i - 1];
+    // With fusion, every rank contributes all its tensors one after another.
+    auto& first_entry = entries[0];
+    auto dtype = GetMPIDataType(first_entry.tensor);
+    std::vector<int> recvcounts(num_ranks);
+    std::vector<int> displcmnts(num_ranks);
+    for (size_t rank = 0; rank < num_ranks; rank++) {
+      int64_t count = 0;
+      for (size_t i = 0; i < entries.size(); i++) {
+        count += slice_elements[i] * tensor_sizes(i, rank);
       }
+      recvcounts[rank] = (int)count;
+      displcmnts[rank] =
+          rank == 0 ? 0 : displcmnts[rank - 1] + recvcounts[rank - 1];
     }
-    auto result = MPI_Allgatherv(
-        e.tensor->data(), (int)e.tensor->shape().num_elements(),
-        GetMPIDataType(e.tensor), (void*)e.output->data(), recvcounts,
-        displcmnts, GetMPIDataType(e.tensor), horovod_global.mpi_comm);
-    delete[] recvcounts;
-    delete[] displcmnts;
-    MPI_CHECK(entries, "MPI_Allgatherv", result)
-    ACTIVITY_END_ALL(entries, timeline)
 
-    timeline.End(e.tensor_name, e.output);
-    e.callback(Status::OK());
+    if (in_flight) {
+      InFlightOperation op;
+      const void* sendbuf;
+      int sendcount;
+      void* recvbuf;
+      if (entries.size() > 1) {
+        int element_size;
+        MPI_Type_size(dtype, &element_size);
+        auto buffer_data = (uint8_t*)FusionBuffer(first_entry, buffer_index)
+                               ->AccessData(first_entry.context);
+
+        ACTIVITY_START_ALL(entries, timeline, MEMCPY_IN_FUSION_BUFFER)
+        std::vector<MemcpyTask> copies;
+        int64_t offset =
+            (int64_t)displcmnts[horovod_global.rank] * element_size;
+        for (auto& e : entries) {
+          copies.emplace_back(buffer_data + offset, e.tensor->data(),
+                              (size_t)e.tensor->size());
+          offset += e.tensor->size();
+        }
+        horovod_global.memcpy_pool.Copy(copies);
+        ACTIVITY_END_ALL(entries, timeline)
 
-  } else if (response.response_type() == MPIResponse::ALLREDUCE) {
-    auto& first_entry = entries[0];
+        std::vector<int64_t> rank_offsets(displcmnts.begin(),
+                                          displcmnts.end());
+        for (size_t i = 0; i < entries.size(); i++) {
+          auto output_data = (uint8_t*)entries[i].output->data();
+          for (size_t rank = 0; rank < num_ranks; rank++) {
+            auto len =
+                slice_elements[i] * tensor_sizes(i, rank) * element_size;
+            op.copies.emplace_back(
+                output_data, buffer_data + rank_offsets[rank] * element_size,
+                (size_t)len);
+            output_data += len;
+            rank_offsets[rank] += slice_elements[i] * tensor_sizes(i, rank);
+          }
+        }
+
+        op.buffer_index = buffer_index;
+        sendbuf = MPI_IN_PLACE;
+        sendcount = 0;
+        recvbuf = buffer_data;
+      } else {
+        sendbuf = first_entry.tensor->data();
+        sendcount = (int)first_entry.tensor->shape().num_elements();
+        recvbuf = (void*)first_entry.output->data();
+      }
+
+      // The counts and displacements are kept with the operation, since they
+      // must remain valid until the allgather completes.
+      op.recvcounts = std::move(recvcounts);
+      op.displcmnts = std::move(displcmnts);
+      ACTIVITY_START_ALL(entries, timeline, MPI_ALLGATHER)
+      MPI_CHECK(entries, "MPI_Iallgatherv",
+                MPI_Iallgatherv(sendbuf, sendcount,
+                                sendbuf == MPI_IN_PLACE ? MPI_DATATYPE_NULL
+                                                        : dtype,
+                                recvbuf, op.recvcounts.data(),
+                                op.displcmnts.data(), dtype,
+                                horovod_global.mpi_comm, &op.request))
+      op.entries = std::move(entries);
+      AddInFlightOperation(std::move(op));
+      return;
+    }
+
+    if (entries.size() > 1) {
+      int element_size;
+      MPI_Type_size(dtype, &element_size);
+#if HAVE_CUDA
+      bool on_gpu = first_entry.device != CPU_DEVICE_ID;
+      if (on_gpu) {
+        CUDA_CHECK(entries, "cudaSetDevice", cudaSetDevice(first_entry.device))
+      }
+#endif
+
+      // Access the fusion buffer.
+      auto& buffer = FusionBuffer(first_entry);
+      auto buffer_data = (uint8_t*)buffer->AccessData(first_entry.context);
+
+      // Copy memory into the part of the fusion buffer that this rank
+      // receives into, so that the allgather can be performed in place.
+      ACTIVITY_START_ALL(entries, timeline, MEMCPY_IN_FUSION_BUFFER)
+      int64_t offset =
+          (int64_t)displcmnts[horovod_global.rank] * element_size;
+      std::vector<MemcpyTask> copies;
+      for (auto& e : entries) {
+#if HAVE_CUDA
+        if (on_gpu) {
+          CUDA_CHECK(entries, "cudaMemcpy",
+                     cudaMemcpy(buffer_data + offset, e.tensor->data(),
+                                (size_t)e.tensor->size(),
+                                cudaMemcpyDeviceToDevice))
+        } else {
+#endif
+          copies.emplace_back(buffer_data + offset, e.tensor->data(),
+                              (size_t)e.tensor->size());
+#if HAVE_CUDA
+        }
+#endif
+        offset += e.tensor->size();
+      }
+      horovod_global.memcpy_pool.Copy(copies);
+      ACTIVITY_END_ALL(entries, timeline)
+
+      ACTIVITY_START_ALL(entries, timeline, MPI_ALLGATHER)
+      MPI_CHECK(entries, "MPI_Allgatherv",
+                MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL,
+                               (void*)buffer_data, recvcounts.data(),
+                               displcmnts.data(), dtype,
+                               horovod_global.mpi_comm))
+      ACTIVITY_END_ALL(entries, timeline)
+
+      // Copy the slices of every rank out of the fusion buffer.
+      ACTIVITY_START_ALL(entries, timeline, MEMCPY_OUT_FUSION_BUFFER)
+      std::vector<int64_t> rank_offsets(displcmnts.begin(), displcmnts.end());
+      copies.clear();
+      for (size_t i = 0; i < entries.size(); i++) {
+        auto& e = entries[i];
+        auto output_data = (uint8_t*)e.output->data();
+        for (size_t rank = 0; rank < num_ranks; rank++) {
+          auto len = slice_elements[i] * tensor_sizes(i, rank) * element_size;
+#if HAVE_CUDA
+          if (on_gpu) {
+            CUDA_CHECK(entries, "cudaMemcpy",
+                       cudaMemcpy(output_data,
+                                  buffer_data +
+                                      rank_offsets[rank] * element_size,
+                                  (size_t)len, cudaMemcpyDeviceToDevice))
+          } else {
+#endif
+            copies.emplace_back(output_data,
+                                buffer_data + rank_offsets[rank] * element_size,
+                                (size_t)len);
+#if HAVE_CUDA
+          }
+#endif
+          output_data += len;
+          rank_offsets[rank] += slice_elements[i] * tensor_sizes(i, rank);
+        }
+      }
+      horovod_global.memcpy_pool.Copy(copies);
+      ACTIVITY_END_ALL(entries, timeline)
+    } else {
+      auto& e = first_entry;
+      ACTIVITY_START_ALL(entries, timeline, MPI_ALLGATHER)
+      MPI_CHECK(entries, "MPI_Allgatherv",
+                MPI_Allgatherv(e.tensor->data(),
+                               (int)e.tensor->shape().num_elements(), dtype,
+                               (void*)e.output->data(), recvcounts.data(),
+                               displcmnts.data(), dtype,
+                               horovod_global.mpi_comm))
+      ACTIVITY_END_ALL(entries, timeline)
+    }
+
+    for (auto& e : entries) {
+      timeline.End(e.tensor_name, e.output);
+      e.callback(Status::OK());
+    }
+
+  } else if (response.response_type() == MPIResponse::ALLREDUCE) {
+    auto& first_entry = entries[0];
+    auto reduce_op = response.reduce_op();
 #if HAVE_CUDA
     bool on_gpu = first_entry.device != CPU_DEVICE_ID;
     if (on_gpu) {
@@ -881,9 +1554,28 @@ void PerformOperation(TensorTable& tensor_table, MPIResponse response) {
       auto stream = horovod_global.streams[first_entry.device];
       auto event_queue = std::queue<std::pair<std::string, cudaEvent_t>>();
 
+#if HOROVOD_GPU_ALLREDUCE == 'N'
+      ncclRedOp_t nccl_op;
+      try {
+        nccl_op = GetNCCLReduceOp(reduce_op);
+      } catch (const std::logic_error& ex) {
+        OP_ERROR(entries, ex.what())
+      }
+#elif HOROVOD_GPU_ALLREDUCE == 'D'
+      if (reduce_op != ReduceOp::SUM) {
+        OP_ERROR(entries, "Reduction operation " + ReduceOp_Name(reduce_op) +
+                              " is not supported in DDL mode.")
+      }
+#endif
+
+      // Hierarchical allreduce only applies to jobs spanning several nodes.
+      bool hierarchical =
+          horovod_global.size != horovod_global.local_size &&
+          LookupAllreduceAlgorithm(entries) == "hierarchical";
+
       // Determine GPU IDs of the devices participating in this communicator.
       std::vector<int32_t> nccl_device_map;
-      if (horovod_global.hierarchical_allreduce) {
+      if (hierarchical) {
         for (int rank : horovod_global.local_comm_ranks) {
           nccl_device_map.push_back(response.devices()[rank]);
         }
@@ -899,7 +1591,7 @@ void PerformOperation(TensorTable& tensor_table, MPIResponse response) {
 
         int nccl_rank, nccl_size;
         MPI_Comm nccl_id_bcast_comm;
-        if (horovod_global.hierarchical_allreduce) {
+        if (hierarchical) {
           nccl_rank = horovod_global.local_rank;
           nccl_size = horovod_global.local_size;
           nccl_id_bcast_comm = horovod_global.local_comm;
@@ -961,8 +1653,7 @@ void PerformOperation(TensorTable& tensor_table, MPIResponse response) {
       size_t buffer_len;
       if (entries.size() > 1) {
         // Access the fusion buffer.
-        auto& buffer = horovod_global.tensor_fusion_buffers[std::make_tuple(
-            first_entry.device, first_entry.context->framework())];
+        auto& buffer = FusionBuffer(first_entry);
         buffer_data =
             const_cast<void*>(buffer->AccessData(first_entry.context));
 
@@ -1022,7 +1713,7 @@ void PerformOperation(TensorTable& tensor_table, MPIResponse response) {
                 ddl_allreduce(buffer_data, (size_t)num_elements, ddl_data_type,
                               DDL_OP_SUM))
 #else
-      if (horovod_global.hierarchical_allreduce) {
+      if (hierarchical) {
         int element_size;
         MPI_Type_size(GetMPIDataType(first_entry.tensor), &element_size);
 
@@ -1093,7 +1784,7 @@ void PerformOperation(TensorTable& tensor_table, MPIResponse response) {
                                        buffer_data_at_rank_offset,
                                        (size_t)num_elements_per_rank,
                                        GetNCCLDataType(first_entry.tensor),
-                                       ncclSum, nccl_comm, stream))
+                                       nccl_op, nccl_comm, stream))
 
           if (timeline.Initialized()) {
             RECORD_EVENT(entries, event_queue, NCCL_REDUCESCATTER, stream)
@@ -1107,7 +1798,7 @@ void PerformOperation(TensorTable& tensor_table, MPIResponse response) {
                      ncclReduce(fused_input_data_remainder,
                                 buffer_data_remainder,
                                 (size_t)num_elements_remaining,
-                                GetNCCLDataType(first_entry.tensor), ncclSum,
+                                GetNCCLDataType(first_entry.tensor), nccl_op,
                                 root_rank, nccl_comm, stream))
 
           if (timeline.Initialized()) {
@@ -1135,14 +1826,12 @@ void PerformOperation(TensorTable& tensor_table, MPIResponse response) {
           ACTIVITY_END_ALL(entries, timeline)
 
           ACTIVITY_START_ALL(entries, timeline, MPI_ALLREDUCE)
-          MPI_CHECK(entries, "MPI_Allreduce",
-                    MPI_Allreduce(MPI_IN_PLACE, host_buffer,
-                                  (int)total_num_elements,
-                                  GetMPIDataType(first_entry.tensor),
-                                  first_entry.tensor->dtype() == HOROVOD_FLOAT16
-                                      ? horovod_global.mpi_float16_sum
-                                      : MPI_SUM,
-                                  horovod_global.cross_comm))
+          MPI_CHECK(
+              entries, "MPI_Allreduce",
+              MPI_Allreduce(MPI_IN_PLACE, host_buffer, (int)total_num_elements,
+                            GetMPIDataType(first_entry.tensor),
+                            GetMPIReduceOp(first_entry.tensor, reduce_op),
+                            horovod_global.cross_comm))
           ACTIVITY_END_ALL(entries, timeline)
 
           ACTIVITY_START_ALL(entries, timeline, MEMCPY_OUT_HOST_BUFFER)
@@ -1179,7 +1868,7 @@ void PerformOperation(TensorTable& tensor_table, MPIResponse response) {
         NCCL_CHECK(entries, "ncclAllReduce",
                    ncclAllReduce(fused_input_data, buffer_data,
                                  (size_t)num_elements,
-                                 GetNCCLDataType(first_entry.tensor), ncclSum,
+                                 GetNCCLDataType(first_entry.tensor), nccl_op,
                                  nccl_comm, stream))
         if (timeline.Initialized()) {
           RECORD_EVENT(entries, event_queue, NCCL_ALLREDUCE, stream)
@@ -1229,14 +1918,164 @@ void PerformOperation(TensorTable& tensor_table, MPIResponse response) {
     }
 #endif
 
-    if (entries.size() > 1) {
+    if (in_flight) {
+      InFlightOperation op;
+      const void* sendbuf;
+      void* recvbuf;
+      int64_t num_elements = 0;
+      if (entries.size() > 1) {
+        auto buffer_data = (uint8_t*)FusionBuffer(first_entry, buffer_index)
+                               ->AccessData(first_entry.context);
+
+        ACTIVITY_START_ALL(entries, timeline, MEMCPY_IN_FUSION_BUFFER)
+        std::vector<MemcpyTask> copies;
+        int64_t offset = 0;
+        for (auto& e : entries) {
+          copies.push_back(ScaledCopy(e, buffer_data + offset,
+                                      e.tensor->data(),
+                                      (size_t)e.tensor->size(),
+                                      e.prescale_factor));
+          op.copies.push_back(ScaledCopy(e, (void*)e.output->data(),
+                                         buffer_data + offset,
+                                         (size_t)e.tensor->size(),
+                                         e.postscale_factor));
+          offset += e.tensor->size();
+          num_elements += e.tensor->shape().num_elements();
+        }
+        horovod_global.memcpy_pool.Copy(copies);
+        ACTIVITY_END_ALL(entries, timeline)
+
+        op.buffer_index = buffer_index;
+        sendbuf = MPI_IN_PLACE;
+        recvbuf = buffer_data;
+      } else {
+        // A single tensor is scaled in place in the output.
+        auto& e = first_entry;
+        sendbuf = e.tensor->data() == e.output->data() ? MPI_IN_PLACE
+                                                       : e.tensor->data();
+        if (e.prescale_factor != 1.0) {
+          horovod_global.memcpy_pool.Copy(
+              {ScaledCopy(e, (void*)e.output->data(), e.tensor->data(),
+                          (size_t)e.tensor->size(), e.prescale_factor)});
+          sendbuf = MPI_IN_PLACE;
+        }
+        if (e.postscale_factor != 1.0) {
+          op.copies.push_back(ScaledCopy(
+              e, (void*)e.output->data(), e.output->data(),
+              (size_t)e.output->size(), e.postscale_factor));
+        }
+        recvbuf = (void*)e.output->data();
+        num_elements = e.tensor->shape().num_elements();
+      }
+
+      // Start the reduction and leave it in flight. It overlaps the following
+      // operations until the results are needed.
+      ACTIVITY_START_ALL(entries, timeline, MPI_ALLREDUCE)
+      MPI_CHECK(entries, "MPI_Iallreduce",
+                MPI_Iallreduce(sendbuf, recvbuf, (int)num_elements,
+                               GetMPIDataType(first_entry.tensor),
+                               GetMPIReduceOp(first_entry.tensor, reduce_op),
+                               horovod_global.mpi_comm, &op.request))
+      op.entries = std::move(entries);
+      AddInFlightOperation(std::move(op));
+      return;
+    }
+
+    auto algorithm = ChooseAllreduceAlgorithm(entries, reduce_op);
+    if (algorithm == AllreduceAlgorithm::PIPELINED) {
+      // Access the fusion buffer.
+      auto& buffer = FusionBuffer(first_entry);
+      auto buffer_data = (uint8_t*)buffer->AccessData(first_entry.context);
+
+      auto dtype = GetMPIDataType(first_entry.tensor);
+      auto op = GetMPIReduceOp(first_entry.tensor, reduce_op);
+      int element_size;
+      MPI_Type_size(dtype, &element_size);
+      int64_t buffer_len = 0;
+      for (auto& e : entries) {
+        buffer_len += e.tensor->size();
+      }
+      int64_t chunk_len =
+          std::max(horovod_global.fusion_chunk_size / element_size,
+                   (int64_t)1) *
+          element_size;
+      int64_t num_chunks = (buffer_len + chunk_len - 1) / chunk_len;
+
+      // Copy the bytes [begin, end) of the fused tensors into the fusion
+      // buffer, or of the fusion buffer into the fused outputs, and scale
+      // them.
+      auto copy_chunk = [&entries, buffer_data](int64_t begin, int64_t end,
+                                                bool into_buffer) {
+        std::vector<MemcpyTask> copies;
+        int64_t offset = 0;
+        for (auto& e : entries) {
+          int64_t from = std::max(begin, offset);
+          int64_t to = std::min(end, offset + e.tensor->size());
+          if (from < to) {
+            if (into_buffer) {
+              copies.push_back(ScaledCopy(
+                  e, buffer_data + from,
+                  (const uint8_t*)e.tensor->data() + (from - offset),
+                  (size_t)(to - from), e.prescale_factor));
+            } else {
+              copies.push_back(ScaledCopy(
+                  e, (uint8_t*)e.output->data() + (from - offset),
+                  buffer_data + from, (size_t)(to - from),
+                  e.postscale_factor));
+            }
+          }
+          offset += e.tensor->size();
+          if (offset >= end) {
+            break;
+          }
+        }
+        horovod_global.memcpy_pool.Copy(copies);
+      };
+
+      // Copy a chunk in and start its reduction. The copy-in of the next
+      // chunk and the copy-out of the previous chunk overlap the reduction.
+      std::vector<MPI_Request> requests((size_t)num_chunks, MPI_REQUEST_NULL);
+
+      // Reductions still outstanding when an MPI call fails write into the
+      // fusion buffer, which the next response reuses right away, so they
+      // are waited for before returning.
+      struct WaitAllGuard {
+        std::vector<MPI_Request>& requests;
+        ~WaitAllGuard() {
+          MPI_Waitall((int)requests.size(), requests.data(),
+                      MPI_STATUSES_IGNORE);
+        }
+      } wait_all{requests};
+
+      auto start_chunk = [&](int64_t chunk) {
+        int64_t begin = chunk * chunk_len;
+        int64_t end = std::min(begin + chunk_len, buffer_len);
+        copy_chunk(begin, end, true);
+        return MPI_Iallreduce(MPI_IN_PLACE, (void*)(buffer_data + begin),
+                              (int)((end - begin) / element_size), dtype, op,
+                              horovod_global.mpi_comm, &requests[chunk]);
+      };
+
+      ACTIVITY_START_ALL(entries, timeline, MPI_PIPELINED_ALLREDUCE)
+      MPI_CHECK(entries, "MPI_Iallreduce", start_chunk(0))
+      for (int64_t chunk = 0; chunk < num_chunks; chunk++) {
+        if (chunk + 1 < num_chunks) {
+          MPI_CHECK(entries, "MPI_Iallreduce", start_chunk(chunk + 1))
+        }
+        MPI_CHECK(entries, "MPI_Wait",
+                  MPI_Wait(&requests[chunk], MPI_STATUS_IGNORE))
+        int64_t begin = chunk * chunk_len;
+        copy_chunk(begin, std::min(begin + chunk_len, buffer_len), false);
+      }
+      ACTIVITY_END_ALL(entries, timeline)
+    } else if (entries.size() > 1) {
       // Access the fusion buffer.
-      auto& buffer = horovod_global.tensor_fusion_buffers[std::make_tuple(
-          first_entry.device, first_entry.context->framework())];
+      auto& buffer = FusionBuffer(first_entry);
       auto buffer_data = buffer->AccessData(first_entry.context);
 
       // Copy memory into the fusion buffer.
       ACTIVITY_START_ALL(entries, timeline, MEMCPY_IN_FUSION_BUFFER)
+      std::vector<MemcpyTask> copies;
       int64_t offset = 0;
       for (auto& e : entries) {
         void* buffer_data_at_offset = (uint8_t*)buffer_data + offset;
@@ -1249,13 +2088,16 @@ void PerformOperation(TensorTable& tensor_table, MPIResponse response) {
                          horovod_global.streams[first_entry.device]))
         } else {
 #endif
-          std::memcpy(buffer_data_at_offset, e.tensor->data(),
-                      (size_t)e.tensor->size());
+          copies.push_back(ScaledCopy(e, buffer_data_at_offset,
+                                      e.tensor->data(),
+                                      (size_t)e.tensor->size(),
+                                      e.prescale_factor));
 #if HAVE_CUDA
         }
 #endif
         offset += e.tensor->size();
       }
+      horovod_global.memcpy_pool.Copy(copies);
 #if HAVE_CUDA
       if (on_gpu) {
         CUDA_CHECK(
@@ -1265,23 +2107,33 @@ void PerformOperation(TensorTable& tensor_table, MPIResponse response) {
 #endif
       ACTIVITY_END_ALL(entries, timeline)
 
-      ACTIVITY_START_ALL(entries, timeline, MPI_ALLREDUCE)
       int64_t num_elements = 0;
       for (auto& e : entries) {
         num_elements += e.tensor->shape().num_elements();
       }
-      MPI_CHECK(entries, "MPI_Allreduce",
-                MPI_Allreduce(MPI_IN_PLACE, (void*)buffer_data,
-                              (int)num_elements,
-                              GetMPIDataType(first_entry.tensor),
-                              first_entry.tensor->dtype() == HOROVOD_FLOAT16
-                                  ? horovod_global.mpi_float16_sum
-                                  : MPI_SUM,
-                              horovod_global.mpi_comm))
+      if (algorithm != AllreduceAlgorithm::MPI) {
+        ACTIVITY_START_ALL(entries, timeline,
+                           algorithm == AllreduceAlgorithm::RING
+                               ? RING_ALLREDUCE
+                               : RECURSIVE_DOUBLING_ALLREDUCE)
+        MPI_CHECK(entries, "Allreduce",
+                  BuiltInAllreduce(algorithm, (void*)buffer_data,
+                                   num_elements, first_entry.tensor->dtype(),
+                                   reduce_op))
+      } else {
+        ACTIVITY_START_ALL(entries, timeline, MPI_ALLREDUCE)
+        MPI_CHECK(entries, "MPI_Allreduce",
+                  MPI_Allreduce(MPI_IN_PLACE, (void*)buffer_data,
+                                (int)num_elements,
+                                GetMPIDataType(first_entry.tensor),
+                                GetMPIReduceOp(first_entry.tensor, reduce_op),
+                                horovod_global.mpi_comm))
+      }
       ACTIVITY_END_ALL(entries, timeline)
 
       // Copy memory out of the fusion buffer.
       ACTIVITY_START_ALL(entries, timeline, MEMCPY_OUT_FUSION_BUFFER)
+      copies.clear();
       offset = 0;
       for (auto& e : entries) {
         void* buffer_data_at_offset = (uint8_t*)buffer_data + offset;
@@ -1294,13 +2146,16 @@ void PerformOperation(TensorTable& tensor_table, MPIResponse response) {
                          horovod_global.streams[first_entry.device]))
         } else {
 #endif
-          std::memcpy((void*)e.output->data(), buffer_data_at_offset,
-                      (size_t)e.tensor->size());
+          copies.push_back(ScaledCopy(e, (void*)e.output->data(),
+                                      buffer_data_at_offset,
+                                      (size_t)e.tensor->size(),
+                                      e.postscale_factor));
 #if HAVE_CUDA
         }
 #endif
         offset += e.tensor->size();
       }
+      horovod_global.memcpy_pool.Copy(copies);
 #if HAVE_CUDA
       if (on_gpu) {
         CUDA_CHECK(
@@ -1309,20 +2164,43 @@ void PerformOperation(TensorTable& tensor_table, MPIResponse response) {
       }
 #endif
       ACTIVITY_END_ALL(entries, timeline)
+    } else if (algorithm != AllreduceAlgorithm::MPI) {
+      // Built-in allreduce algorithms work in place on the output.
+      auto& e = first_entry;
+      ACTIVITY_START_ALL(entries, timeline,
+                         algorithm == AllreduceAlgorithm::RING
+                             ? RING_ALLREDUCE
+                             : RECURSIVE_DOUBLING_ALLREDUCE)
+      if (e.tensor->data() != e.output->data() || e.prescale_factor != 1.0) {
+        horovod_global.memcpy_pool.Copy(
+            {ScaledCopy(e, (void*)e.output->data(), e.tensor->data(),
+                        (size_t)e.tensor->size(), e.prescale_factor)});
+      }
+      MPI_CHECK(entries, "Allreduce",
+                BuiltInAllreduce(algorithm, (void*)e.output->data(),
+                                 e.tensor->shape().num_elements(),
+                                 e.tensor->dtype(), reduce_op))
+      ScaleOutput(e, e.postscale_factor);
+      ACTIVITY_END_ALL(entries, timeline)
     } else {
       auto& e = first_entry;
       ACTIVITY_START_ALL(entries, timeline, MPI_ALLREDUCE)
       const void* sendbuf = e.tensor->data() == e.output->data()
                                 ? MPI_IN_PLACE
                                 : e.tensor->data();
+      if (e.prescale_factor != 1.0) {
+        horovod_global.memcpy_pool.Copy(
+            {ScaledCopy(e, (void*)e.output->data(), e.tensor->data(),
+                        (size_t)e.tensor->size(), e.prescale_factor)});
+        sendbuf = MPI_IN_PLACE;
+      }
       MPI_CHECK(entries, "MPI_Allreduce",
                 MPI_Allreduce(sendbuf, (void*)e.output->data(),
                               (int)e.tensor->shape().num_elements(),
                               GetMPIDataType(e.tensor),
-                              first_entry.tensor->dtype() == HOROVOD_FLOAT16
-                                  ? horovod_global.mpi_float16_sum
-                                  : MPI_SUM,
+                              GetMPIReduceOp(e.tensor, reduce_op),
                               horovod_global.mpi_comm))
+      ScaleOutput(e, e.postscale_factor);
       ACTIVITY_END_ALL(entries, timeline)
     }
 
@@ -1331,26 +2209,150 @@ void PerformOperation(TensorTable& tensor_table, MPIResponse response) {
       e.callback(Status::OK());
     }
   } else if (response.response_type() == MPIResponse::BROADCAST) {
-    assert(entries.size() == 1);
-    auto e = entries[0];
+    auto& first_entry = entries[0];
+    bool is_root = horovod_global.rank == first_entry.root_rank;
 
-    // On root rank, MPI_Bcast sends data, on other ranks it receives data.
-    void* data_ptr;
-    if (horovod_global.rank == e.root_rank) {
-      data_ptr = (void*)e.tensor->data();
-    } else {
-      data_ptr = (void*)e.output->data();
+    if (in_flight) {
+      InFlightOperation op;
+      void* data_ptr;
+      int count;
+      MPI_Datatype dtype;
+      if (entries.size() > 1) {
+        auto buffer_data = (uint8_t*)FusionBuffer(first_entry, buffer_index)
+                               ->AccessData(first_entry.context);
+        std::vector<MemcpyTask> copies;
+        int64_t offset = 0;
+        for (auto& e : entries) {
+          if (is_root) {
+            copies.emplace_back(buffer_data + offset, e.tensor->data(),
+                                (size_t)e.tensor->size());
+          } else {
+            op.copies.emplace_back((void*)e.output->data(),
+                                   buffer_data + offset,
+                                   (size_t)e.tensor->size());
+          }
+          offset += e.tensor->size();
+        }
+        if (is_root) {
+          ACTIVITY_START_ALL(entries, timeline, MEMCPY_IN_FUSION_BUFFER)
+          horovod_global.memcpy_pool.Copy(copies);
+          ACTIVITY_END_ALL(entries, timeline)
+        }
+
+        op.buffer_index = buffer_index;
+        data_ptr = buffer_data;
+        count = (int)offset;
+        dtype = MPI_BYTE;
+      } else {
+        auto& e = first_entry;
+        data_ptr = is_root ? (void*)e.tensor->data() : (void*)e.output->data();
+        count = (int)e.tensor->shape().num_elements();
+        dtype = GetMPIDataType(e.tensor);
+      }
+
+      ACTIVITY_START_ALL(entries, timeline, MPI_BCAST)
+      MPI_CHECK(entries, "MPI_Ibcast",
+                MPI_Ibcast(data_ptr, count, dtype, first_entry.root_rank,
+                           horovod_global.mpi_comm, &op.request))
+      op.entries = std::move(entries);
+      AddInFlightOperation(std::move(op));
+      return;
     }
 
-    ACTIVITY_START_ALL(entries, timeline, MPI_BCAST)
-    MPI_CHECK(entries, "MPI_Bcast",
-              MPI_Bcast(data_ptr, (int)e.tensor->shape().num_elements(),
-                        GetMPIDataType(e.tensor), e.root_rank,
-                        horovod_global.mpi_comm))
-    ACTIVITY_END_ALL(entries, timeline)
+    if (entries.size() > 1) {
+#if HAVE_CUDA
+      bool on_gpu = first_entry.device != CPU_DEVICE_ID;
+      if (on_gpu) {
+        CUDA_CHECK(entries, "cudaSetDevice", cudaSetDevice(first_entry.device))
+      }
+#endif
+
+      // Access the fusion buffer.
+      auto& buffer = FusionBuffer(first_entry);
+      auto buffer_data = (uint8_t*)buffer->AccessData(first_entry.context);
+
+      // The root rank copies its tensors into the fusion buffer. Tensors of
+      // different data types are broadcasted together as bytes.
+      std::vector<MemcpyTask> copies;
+      int64_t offset = 0;
+      if (is_root) {
+        ACTIVITY_START_ALL(entries, timeline, MEMCPY_IN_FUSION_BUFFER)
+        for (auto& e : entries) {
+#if HAVE_CUDA
+          if (on_gpu) {
+            CUDA_CHECK(entries, "cudaMemcpy",
+                       cudaMemcpy(buffer_data + offset, e.tensor->data(),
+                                  (size_t)e.tensor->size(),
+                                  cudaMemcpyDeviceToDevice))
+          } else {
+#endif
+            copies.emplace_back(buffer_data + offset, e.tensor->data(),
+                                (size_t)e.tensor->size());
+#if HAVE_CUDA
+          }
+#endif
+          offset += e.tensor->size();
+        }
+        horovod_global.memcpy_pool.Copy(copies);
+        ACTIVITY_END_ALL(entries, timeline)
+      } else {
+        for (auto& e : entries) {
+          offset += e.tensor->size();
+        }
+      }
+
+      ACTIVITY_START_ALL(entries, timeline, MPI_BCAST)
+      MPI_CHECK(entries, "MPI_Bcast",
+                MPI_Bcast((void*)buffer_data, (int)offset, MPI_BYTE,
+                          first_entry.root_rank, horovod_global.mpi_comm))
+      ACTIVITY_END_ALL(entries, timeline)
+
+      // Other ranks copy the broadcasted tensors out of the fusion buffer.
+      if (!is_root) {
+        ACTIVITY_START_ALL(entries, timeline, MEMCPY_OUT_FUSION_BUFFER)
+        offset = 0;
+        for (auto& e : entries) {
+#if HAVE_CUDA
+          if (on_gpu) {
+            CUDA_CHECK(entries, "cudaMemcpy",
+                       cudaMemcpy((void*)e.output->data(), buffer_data + offset,
+                                  (size_t)e.tensor->size(),
+                                  cudaMemcpyDeviceToDevice))
+          } else {
+#endif
+            copies.emplace_back((void*)e.output->data(), buffer_data + offset,
+                                (size_t)e.tensor->size());
+#if HAVE_CUDA
+          }
+#endif
+          offset += e.tensor->size();
+        }
+        horovod_global.memcpy_pool.Copy(copies);
+        ACTIVITY_END_ALL(entries, timeline)
+      }
+    } else {
+      auto& e = first_entry;
 
-    timeline.End(e.tensor_name, e.output);
-    e.callback(Status::OK());
+      // On root rank, MPI_Bcast sends data, on other ranks it receives data.
+      void* data_ptr;
+      if (is_root) {
+        data_ptr = (void*)e.tensor->data();
+      } else {
+        data_ptr = (void*)e.output->data();
+      }
+
+      ACTIVITY_START_ALL(entries, timeline, MPI_BCAST)
+      MPI_CHECK(entries, "MPI_Bcast",
+                MPI_Bcast(data_ptr, (int)e.tensor->shape().num_elements(),
+                          GetMPIDataType(e.tensor), e.root_rank,
+                          horovod_global.mpi_comm))
+      ACTIVITY_END_ALL(entries, timeline)
+    }
+
+    for (auto& e : entries) {
+      timeline.End(e.tensor_name, e.output);
+      e.callback(Status::OK());
+    }
   } else if (response.response_type() == MPIResponse::ERROR) {
     assert(entries.size() == 1);
     auto e = entries[0];
@@ -1361,125 +2363,885 @@ void PerformOperation(TensorTable& tensor_table, MPIResponse response) {
   }
 }
 
+// Report a tensor that was submitted to be reduced, gathered or broadcasted by
+// some ranks but not others and is waiting for long time to get processed.
+// The preamble is printed before the first stalled tensor.
+void ReportStalledTensor(bool& preamble, const std::string& tensor_name,
+                         const std::vector<int32_t>& missing_ranks) {
+  if (!preamble) {
+    std::cerr << "WARNING: One or more tensors were submitted to be "
+                 "reduced, gathered or broadcasted by subset of ranks and "
+                 "are waiting for remainder of ranks for more than "
+              << std::chrono::duration_cast<std::chrono::seconds>(
+                     STALL_WARNING_TIME)
+                     .count()
+              << " seconds. ";
+    std::cerr << "This may indicate that different ranks are trying to "
+                 "submit different tensors or that only subset of ranks is "
+                 "submitting tensors, which will cause deadlock. "
+              << std::endl;
+    std::cerr << "Stalled ops:" << std::endl;
+    preamble = true;
+  }
+  std::cerr << tensor_name;
+  std::cerr << " [missing ranks:";
+  for (size_t i = 0; i < missing_ranks.size(); i++) {
+    std::cerr << (i == 0 ? " " : ", ") << missing_ranks[i];
+  }
+  std::cerr << "]" << std::endl;
+}
+
 // Report Tensors that were submitted to be reduced, gathered or broadcasted by
 // some ranks but not others and are waiting for long time to get processed.
-void CheckForStalledTensors(HorovodGlobalState& state) {
+void CheckForStalledTensors(const MessageTable& message_table,
+                            const TensorIdTable& tensor_ids, int size) {
   bool preamble = false;
   auto now = std::chrono::steady_clock::now();
-  for (auto& m : *state.message_table) {
-    auto tensor_name = m.first;
-    std::vector<MPIRequest>& messages = std::get<0>(m.second);
-    std::chrono::steady_clock::time_point start_at = std::get<1>(m.second);
-
-    if (now - start_at > STALL_WARNING_TIME) {
-      if (!preamble) {
-        std::cerr << "WARNING: One or more tensors were submitted to be "
-                     "reduced, gathered or broadcasted by subset of ranks and "
-                     "are waiting for remainder of ranks for more than "
-                  << std::chrono::duration_cast<std::chrono::seconds>(
-                         STALL_WARNING_TIME)
-                         .count()
-                  << " seconds. ";
-        std::cerr << "This may indicate that different ranks are trying to "
-                     "submit different tensors or that only subset of ranks is "
-                     "submitting tensors, which will cause deadlock. "
-                  << std::endl;
-        std::cerr << "Stalled ops:" << std::endl;
-        preamble = true;
-      }
-      std::cerr << tensor_name;
-      std::cerr << " [missing ranks:";
-      std::unordered_set<int32_t> ready_ranks;
-      bool missing_preamble = false;
-      for (auto msg_iter = messages.begin(); msg_iter != messages.end();
-           msg_iter++) {
-        ready_ranks.insert(msg_iter->request_rank());
-      }
-      for (int32_t rank = 0; rank < state.size; rank++) {
-        if (ready_ranks.find(rank) == ready_ranks.end()) {
-          if (!missing_preamble) {
-            std::cerr << " ";
-            missing_preamble = true;
-          } else {
-            std::cerr << ", ";
-          }
-          std::cerr << rank;
+  for (auto& m : message_table) {
+    auto& entry = m.second;
+    if (now - entry.start_at > STALL_WARNING_TIME) {
+      std::vector<int32_t> missing_ranks;
+      for (int32_t rank = 0; rank < size; rank++) {
+        if ((entry.ready_ranks[rank / 64] & (1ull << (rank % 64))) == 0) {
+          missing_ranks.push_back(rank);
         }
       }
-      std::cerr << "]" << std::endl;
+      ReportStalledTensor(preamble, tensor_ids.name(m.first), missing_ranks);
     }
   }
 }
 
-// The MPI background thread loop coordinates all the MPI processes and the
-// tensor reductions. The design of the communicator mechanism is limited by a
-// few considerations:
-//
-//      1. Some MPI implementations require all MPI calls to happen from a
-//      single thread. Since TensorFlow may use several threads for graph
-//      processing, this means we must have our own dedicated thread for dealing
-//      with MPI.
-//      2. We want to gracefully handle errors, when MPI processes do not
-//      properly agree upon what should happen (such as mismatched types or
-//      shapes). To do so requires the MPI processes to know about the shapes
-//      and types of the relevant tensors on the other processes.
-//      3. The MPI reductions and gathers should be able to happen in parallel
-//      with other ongoing operations. This means that they cannot be blocking
-//      ops, but rather must be async ops, the execution of which happens on a
-//      separate thread.
-//      4. We cannot guarantee that all the MPI processes reduce their tensors
-//      in the same order, so we cannot dispatch one thread per tensor,
-//      otherwise we may end up dispatching many blocked threads and never make
-//      progress if we have a thread pool limit.
-bool RunLoopOnce(HorovodGlobalState& state, bool is_coordinator);
-void BackgroundThreadLoop(HorovodGlobalState& state) {
-  // Initialize MPI if it was not initialized. This must happen on the
-  // background thread, since not all MPI implementations support being called
-  // from multiple threads.
-  //
-  // In some cases MPI library has multi-threading support, but it slows down
-  // certain components, e.g. OpenIB BTL in OpenMPI gets disabled if
-  // MPI_THREAD_MULTIPLE is requested.
-  //
-  // By default, we will ask for multiple threads, so other libraries like
-  // mpi4py can be used together with Horovod if multi-threaded MPI is
-  // installed.
-  auto mpi_threads_disable = std::getenv(HOROVOD_MPI_THREADS_DISABLE);
-  int required = MPI_THREAD_MULTIPLE;
-  if (mpi_threads_disable != nullptr &&
-      std::strtol(mpi_threads_disable, nullptr, 10) > 0) {
-    required = MPI_THREAD_SINGLE;
-  }
-  int provided;
-  int is_mpi_initialized = 0;
-  MPI_Initialized(&is_mpi_initialized);
-  if (is_mpi_initialized) {
-    MPI_Query_thread(&provided);
-    if (provided < MPI_THREAD_MULTIPLE) {
-      std::cerr << "WARNING: MPI has already been initialized without "
-                   "multi-threading support (MPI_THREAD_MULTIPLE). This will "
-                   "likely cause a segmentation fault."
-                << std::endl;
+// Report Tensors that only some ranks of this node are ready for, with
+// hierarchical negotiation.
+void CheckForStalledTensors(const NodeRequestTable& node_request_table,
+                            const TensorIdTable& tensor_ids,
+                            const std::vector<int>& node_ranks) {
+  bool preamble = false;
+  auto now = std::chrono::steady_clock::now();
+  for (auto& m : node_request_table) {
+    auto& entry = m.second;
+    if (now - entry.start_at > STALL_WARNING_TIME) {
+      auto& ready_ranks = entry.request.node_ranks();
+      auto& mismatched = entry.mismatched_requests;
+      std::vector<int32_t> missing_ranks;
+      for (int32_t rank : node_ranks) {
+        auto ready =
+            std::find(ready_ranks.begin(), ready_ranks.end(), rank) !=
+                ready_ranks.end() ||
+            std::any_of(mismatched.begin(), mismatched.end(),
+                        [rank](const MPIRequest& request) {
+                          return request.request_rank() == rank;
+                        });
+        if (!ready) {
+          missing_ranks.push_back(rank);
+        }
+      }
+      ReportStalledTensor(preamble, tensor_ids.name(m.first), missing_ranks);
     }
-  } else {
-    MPI_Init_thread(NULL, NULL, required, &provided);
-    state.should_finalize = true;
   }
+}
 
-  if (state.ranks.size() > 0) {
-    MPI_Group world_group;
-    MPI_Comm_group(MPI_COMM_WORLD, &world_group);
-    MPI_Group work_group;
-    MPI_Group_incl(world_group, state.ranks.size(), &(state.ranks[0]),
-                   &work_group);
-    MPI_Comm_create_group(MPI_COMM_WORLD, work_group, 0, &(state.mpi_comm));
-    if (state.mpi_comm == MPI_COMM_NULL) {
-      std::cerr << "WARNING: Unable to create Horovod communicator, using "
-                   "MPI_COMM_WORLD instead."
-                << std::endl;
-      state.mpi_comm = MPI_COMM_WORLD;
+// Returns the number of bytes a response needs in the Tensor Fusion buffer:
+// the size of the tensor for an allreduce, and the size of the gathered tensor
+// for an allgather.
+int64_t FusionBufferSize(const MPIResponse& response,
+                         const TensorTableEntry& entry) {
+  if (response.response_type() == MPIResponse::ResponseType::ALLGATHER) {
+    int element_size;
+    MPI_Type_size(GetMPIDataType(entry.tensor), &element_size);
+    int64_t slice_size = element_size;
+    for (int i = 1; i < entry.tensor->shape().dims(); ++i) {
+      slice_size *= entry.tensor->shape().dim_size(i);
     }
-    MPI_Group_free(&world_group);
+    int64_t total_dimension_size = 0;
+    for (auto sz : response.tensor_sizes()) {
+      total_dimension_size += sz;
+    }
+    return slice_size * total_dimension_size;
+  }
+  return entry.tensor->size();
+}
+
+// Only allreduces, allgathers and broadcasts are performed on the Tensor
+// Fusion buffer.
+bool IsFusable(const MPIResponse& response) {
+  return response.response_type() == MPIResponse::ResponseType::ALLREDUCE ||
+         response.response_type() == MPIResponse::ResponseType::ALLGATHER ||
+         response.response_type() == MPIResponse::ResponseType::BROADCAST;
+}
+
+// Responses can be fused if they share devices and the fusion key, which is
+// the operation along with the root rank for broadcasts, since they are
+// performed on bytes, and with the data type and reduction operation
+// otherwise.
+std::tuple<int, int, int> FusionKey(const MPIResponse& response,
+                                    const TensorTableEntry& entry) {
+  if (response.response_type() == MPIResponse::ResponseType::BROADCAST) {
+    return std::make_tuple((int)response.response_type(), entry.root_rank, 0);
+  }
+  return std::make_tuple((int)response.response_type(),
+                         (int)entry.tensor->dtype(),
+                         (int)response.reduce_op());
+}
+
+// Add the single tensor of a response to a fused response of the same type.
+void AddToFusedResponse(MPIResponse& response,
+                        const MPIResponse& new_response) {
+  response.add_tensor_ids(new_response.tensor_ids()[0]);
+  for (auto sz : new_response.tensor_sizes()) {
+    response.add_tensor_sizes(sz);
+  }
+}
+
+// Fuse runs of consecutive responses into larger responses, as long as they
+// share devices and fusion key and fit into the Tensor Fusion buffer. The
+// caller holds state.mutex.
+MPIResponseList FuseResponsesInOrder(std::deque<MPIResponse>& responses,
+                                     HorovodGlobalState& state) {
+  MPIResponseList response_list;
+  while (!responses.empty()) {
+    auto response = responses.front();
+    assert(response.tensor_ids().size() == 1);
+    responses.pop_front();
+
+    if (IsFusable(response)) {
+      // Attempt to add more responses to this fused response.
+      auto& entry = state.tensor_table[response.tensor_ids()[0]];
+      int64_t tensor_size = FusionBufferSize(response, entry);
+
+      while (!responses.empty()) {
+        auto new_response = responses.front();
+        assert(new_response.tensor_ids().size() == 1);
+        if (!IsFusable(new_response)) {
+          break;
+        }
+        auto& new_entry = state.tensor_table[new_response.tensor_ids()[0]];
+        int64_t new_tensor_size = FusionBufferSize(new_response, new_entry);
+
+        if (response.devices() == new_response.devices() &&
+            FusionKey(response, entry) == FusionKey(new_response, new_entry) &&
+            tensor_size + new_tensor_size <= state.tensor_fusion_threshold) {
+          // These tensors will fuse together well.
+          tensor_size += new_tensor_size;
+          AddToFusedResponse(response, new_response);
+          responses.pop_front();
+        } else {
+          // Don't try to fuse additional tensors since they are usually
+          // computed in order of requests and skipping tensors may mean
+          // that the batch will have to wait longer while skipped tensors
+          // could be reduced at that time.
+          break;
+        }
+      }
+    }
+
+    response_list.add_responses(response);
+  }
+  return response_list;
+}
+
+// Pack all responses that share devices and fusion key into as few fused
+// responses as possible, using a best-fit decreasing heuristic: tensors are
+// placed from largest to smallest into the fused response with the least room
+// left in the Tensor Fusion buffer that still fits them. Fused responses
+// list their tensors in the original order and take the position of their
+// first tensor, so the response with the highest priority tensor goes first.
+// The caller holds state.mutex.
+MPIResponseList PackResponses(std::deque<MPIResponse>& responses,
+                              HorovodGlobalState& state) {
+  struct Bin {
+    int64_t size = 0;
+    std::vector<size_t> members;
+  };
+
+  // Group responses by fusion key and devices, in order of their first
+  // response.
+  std::unordered_map<
+      std::tuple<std::tuple<int, int, int>, std::vector<int32_t>>, size_t>
+      group_ids;
+  std::vector<std::vector<size_t>> groups;
+  std::vector<int64_t> sizes(responses.size());
+  std::vector<std::vector<size_t>> fused(responses.size());
+  for (size_t i = 0; i < responses.size(); i++) {
+    auto& response = responses[i];
+    assert(response.tensor_ids().size() == 1);
+    if (!IsFusable(response)) {
+      fused[i].push_back(i);
+      continue;
+    }
+    auto& entry = state.tensor_table[response.tensor_ids()[0]];
+    sizes[i] = FusionBufferSize(response, entry);
+    auto key = std::make_tuple(FusionKey(response, entry), response.devices());
+    auto it = group_ids.find(key);
+    if (it == group_ids.end()) {
+      it = group_ids.emplace(key, groups.size()).first;
+      groups.emplace_back();
+    }
+    groups[it->second].push_back(i);
+  }
+
+  for (auto& group : groups) {
+    // The sort is stable so that every rank packs the same bins.
+    std::stable_sort(group.begin(), group.end(),
+                     [&sizes](size_t a, size_t b) {
+                       return sizes[a] > sizes[b];
+                     });
+    std::vector<Bin> bins;
+    for (auto i : group) {
+      Bin* best = nullptr;
+      for (auto& bin : bins) {
+        if (bin.size + sizes[i] <= state.tensor_fusion_threshold &&
+            (best == nullptr || bin.size > best->size)) {
+          best = &bin;
+        }
+      }
+      if (best == nullptr) {
+        bins.emplace_back();
+        best = &bins.back();
+      }
+      best->size += sizes[i];
+      best->members.push_back(i);
+    }
+    for (auto& bin : bins) {
+      std::sort(bin.members.begin(), bin.members.end());
+      fused[bin.members[0]] = std::move(bin.members);
+    }
+  }
+
+  MPIResponseList response_list;
+  for (auto& members : fused) {
+    if (members.empty()) {
+      continue;
+    }
+    auto response = responses[members[0]];
+    for (size_t j = 1; j < members.size(); j++) {
+      AddToFusedResponse(response, responses[members[j]]);
+    }
+    response_list.add_responses(response);
+  }
+  responses.clear();
+  return response_list;
+}
+
+// Fuse ALLREDUCE, ALLGATHER and BROADCAST responses that are ready at the same
+// time into larger responses, as long as they share operation, devices, data
+// type and reduction operation (root rank for broadcasts) and fit into the
+// Tensor Fusion buffer.
+// Responses are ordered by decreasing priority first; the sort is stable, so
+// tensors of equal priority keep the order in which they became ready and
+// every rank computes the same order.
+MPIResponseList FuseResponses(std::deque<MPIResponse>& responses,
+                              HorovodGlobalState& state) {
+  std::stable_sort(responses.begin(), responses.end(),
+                   [](const MPIResponse& a, const MPIResponse& b) {
+                     return a.priority() > b.priority();
+                   });
+
+  // Lock on the tensor table, which is modified by the framework threads and
+  // the execution thread.
+  std::lock_guard<std::mutex> guard(state.mutex);
+
+  if (state.ordered_fusion) {
+    return FuseResponsesInOrder(responses, state);
+  }
+  return PackResponses(responses, state);
+}
+
+// Flags exchanged in the first word of the response cache bit vector. They
+// are stored inverted, so that the bitwise AND across ranks is cleared if any
+// rank raised the flag.
+#define CACHE_NO_SHUTDOWN_FLAG 0x1ull
+#define CACHE_NO_UNCACHED_FLAG 0x2ull
+
+// Coordinate requests that hit the response cache. Each rank sets the cache
+// bits of the cached tensors it is ready for, clears the bits of cached
+// entries its requests invalidated, and raises flags if it has uncached
+// requests or wants to shut down. A single bitwise AND allreduce then tells
+// every rank which cached tensors are ready on all ranks, which entries to
+// evict, and whether a full negotiation is needed in this tick.
+//
+// Cached tensors ready on all ranks are returned in cache bit order, which is
+// the same on every rank. Requests that need full negotiation are left in
+// message_queue. Returns whether any rank needs full negotiation.
+bool SynchronizeResponseCache(HorovodGlobalState& state,
+                              std::queue<MPIRequest>& message_queue,
+                              bool should_shut_down,
+                              std::deque<MPIResponse>& cached_responses) {
+  auto& cache = state.response_cache;
+  auto num_words = (size_t)(cache.capacity() + 63) / 64;
+  std::vector<uint64_t> bit_vector(1 + 2 * num_words, ~0ull);
+  uint64_t* hit_bits = &bit_vector[1];
+  uint64_t* valid_bits = &bit_vector[1 + num_words];
+  std::fill(hit_bits, hit_bits + num_words, 0ull);
+
+  // Requests that need full negotiation are remembered, so that the responses
+  // to them can be cached.
+  std::queue<MPIRequest> uncached_queue;
+  auto defer_request = [&state, &uncached_queue](const MPIRequest& request) {
+    state.uncached_requests[request.tensor_id()] = request;
+    uncached_queue.push(request);
+  };
+  auto now = std::chrono::steady_clock::now();
+
+  // Requests that hit the cache in previous ticks are checked again, since
+  // their entries may have been evicted since then. Requests that wait for
+  // the remaining ranks for too long invalidate their entries, so that they
+  // go through full negotiation and get reported by the stall check.
+  for (auto it = state.cache_hits.begin(); it != state.cache_hits.end();) {
+    auto& request = std::get<0>(it->second);
+    auto cache_state = cache.cached(request);
+    bool stalled = state.perform_stall_check &&
+                   now - std::get<1>(it->second) > STALL_WARNING_TIME;
+    if (cache_state == ResponseCache::HIT && !stalled) {
+      auto bit = cache.peek_cache_bit(request.tensor_id());
+      hit_bits[bit / 64] |= 1ull << (bit % 64);
+      ++it;
+      continue;
+    }
+    if (cache_state != ResponseCache::MISS) {
+      auto bit = cache.peek_cache_bit(request.tensor_id());
+      valid_bits[bit / 64] &= ~(1ull << (bit % 64));
+    }
+    defer_request(request);
+    it = state.cache_hits.erase(it);
+  }
+
+  while (!message_queue.empty()) {
+    auto& message = message_queue.front();
+    auto cache_state = cache.cached(message);
+    if (cache_state == ResponseCache::HIT) {
+      auto bit = cache.peek_cache_bit(message.tensor_id());
+      hit_bits[bit / 64] |= 1ull << (bit % 64);
+      state.cache_hits.emplace(message.tensor_id(),
+                               std::make_tuple(message, now));
+    } else {
+      if (cache_state == ResponseCache::INVALID) {
+        auto bit = cache.peek_cache_bit(message.tensor_id());
+        valid_bits[bit / 64] &= ~(1ull << (bit % 64));
+      }
+      defer_request(message);
+    }
+    message_queue.pop();
+  }
+
+  if (!uncached_queue.empty()) {
+    bit_vector[0] &= ~CACHE_NO_UNCACHED_FLAG;
+  }
+  if (should_shut_down) {
+    bit_vector[0] &= ~CACHE_NO_SHUTDOWN_FLAG;
+  }
+
+  MPI_Allreduce(MPI_IN_PLACE, bit_vector.data(), (int)bit_vector.size(),
+                MPI_UINT64_T, MPI_BAND, state.negotiation_comm);
+
+  // Evict entries invalidated by any rank. Every rank does it in the same
+  // order to keep the caches identical.
+  for (size_t word = 0; word < num_words; word++) {
+    if (valid_bits[word] == ~0ull) {
+      continue;
+    }
+    for (uint32_t bit = 0; bit < 64; bit++) {
+      if ((valid_bits[word] & (1ull << bit)) == 0) {
+        cache.erase_response((uint32_t)(word * 64 + bit));
+      }
+    }
+  }
+
+  // Collect cached tensors that every rank is ready for.
+  for (size_t word = 0; word < num_words; word++) {
+    auto ready_bits = hit_bits[word] & valid_bits[word];
+    for (uint32_t bit = 0; ready_bits != 0 && bit < 64; bit++) {
+      if ((ready_bits & (1ull << bit)) == 0) {
+        continue;
+      }
+      auto& response = cache.get_response((uint32_t)(word * 64 + bit));
+      state.cache_hits.erase(response.tensor_ids()[0]);
+      cached_responses.push_back(response);
+    }
+  }
+
+  // Requests whose entries were invalidated by other ranks join the full
+  // negotiation in this tick. It is guaranteed to happen, since the rank that
+  // invalidated the entry has an uncached request.
+  for (auto it = state.cache_hits.begin(); it != state.cache_hits.end();) {
+    if (cache.cached(std::get<0>(it->second)) != ResponseCache::HIT) {
+      defer_request(std::get<0>(it->second));
+      it = state.cache_hits.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  std::swap(message_queue, uncached_queue);
+  return (bit_vector[0] & CACHE_NO_UNCACHED_FLAG) == 0 ||
+         (bit_vector[0] & CACHE_NO_SHUTDOWN_FLAG) == 0;
+}
+
+// Cache the responses of negotiated tensors. Every rank receives the same
+// response list, so the caches stay identical across ranks. Tensors without a
+// wire ID are not cached, since their local IDs are freed once they are done;
+// that only happens if their wire ID was reused in the same tick, and every
+// rank agrees on which tensors have a wire ID.
+void CacheResponses(HorovodGlobalState& state,
+                    const MPIResponseList& response_list) {
+  for (auto& response : response_list.responses()) {
+    // Fused allgathers hold the tensor sizes of every tensor one after
+    // another.
+    auto num_sizes =
+        response.tensor_sizes().size() / response.tensor_ids().size();
+    for (size_t i = 0; i < response.tensor_ids().size(); i++) {
+      auto tensor_id = response.tensor_ids()[i];
+      auto it = state.uncached_requests.find(tensor_id);
+      assert(it != state.uncached_requests.end());
+      if (response.response_type() != MPIResponse::ERROR &&
+          state.tensor_ids.wire_id(tensor_id) != TensorIdTable::UNKNOWN_ID) {
+        MPIResponse tensor_response = response;
+        tensor_response.set_tensor_ids({tensor_id});
+        auto sizes_begin = response.tensor_sizes().begin() + i * num_sizes;
+        tensor_response.set_tensor_sizes(
+            std::vector<int64_t>(sizes_begin, sizes_begin + num_sizes));
+        state.response_cache.put(tensor_response, it->second);
+      }
+      state.uncached_requests.erase(it);
+    }
+  }
+}
+
+// Gather the request lists of all ranks of the communicator on the root rank,
+// which receives them in request_lists indexed by rank in the communicator.
+// The root keeps its own request list as is instead of sending it to itself.
+// Tensors are sent by wire ID, or by name if they have none.
+void GatherRequestLists(MPIRequestList& message_list,
+                        std::vector<MPIRequestList>& request_lists,
+                        TensorIdTable& tensor_ids, MPI_Comm comm,
+                        int root_rank) {
+  int rank, size;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &size);
+
+  if (rank != root_rank) {
+    std::string encoded_message;
+    tensor_ids.EncodeRequests(message_list);
+    MPIRequestList::SerializeToString(message_list, encoded_message);
+    int encoded_message_length = (int)encoded_message.length() + 1;
+    MPI_Gather(&encoded_message_length, 1, MPI_INT, nullptr, 1, MPI_INT,
+               root_rank, comm);
+    MPI_Gatherv((void*)encoded_message.c_str(), encoded_message_length,
+                MPI_BYTE, nullptr, nullptr, nullptr, MPI_BYTE, root_rank, comm);
+    return;
+  }
+
+  // 1. Get message lengths from every rank.
+  auto recvcounts = new int[size];
+  recvcounts[root_rank] = 0;
+  MPI_Gather(MPI_IN_PLACE, 1, MPI_INT, recvcounts, 1, MPI_INT, root_rank,
+             comm);
+
+  // 2. Compute displacements.
+  auto displcmnts = new int[size];
+  size_t total_size = 0;
+  for (int i = 0; i < size; i++) {
+    if (i == 0) {
+      displcmnts[i] = 0;
+    } else {
+      displcmnts[i] = recvcounts[i - 1] + displcmnts[i - 1];
+    }
+    total_size += recvcounts[i];
+  }
+
+  // 3. Collect messages from every rank.
+  auto buffer = new char[total_size];
+  MPI_Gatherv(nullptr, 0, MPI_BYTE, buffer, recvcounts, displcmnts, MPI_BYTE,
+              root_rank, comm);
+
+  // 4. Parse messages.
+  request_lists.resize((size_t)size);
+  request_lists[root_rank] = std::move(message_list);
+  for (int i = 0; i < size; i++) {
+    if (i == root_rank) {
+      continue;
+    }
+    std::string received_data(buffer + displcmnts[i], (size_t)recvcounts[i]);
+    MPIRequestList::ParseFromString(request_lists[i], received_data);
+    tensor_ids.DecodeRequests(request_lists[i]);
+  }
+
+  // 5. Free buffers.
+  delete[] recvcounts;
+  delete[] displcmnts;
+  delete[] buffer;
+}
+
+// Broadcast the response list from rank zero of the communicator to all other
+// ranks of the communicator. Tensors are sent by wire ID, or by name if they
+// have none.
+void BroadcastResponseList(MPIResponseList& response_list,
+                           TensorIdTable& tensor_ids, MPI_Comm comm) {
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+
+  if (rank == RANK_ZERO) {
+    std::string encoded_response;
+    MPIResponseList wire_response_list = response_list;
+    tensor_ids.EncodeResponses(wire_response_list);
+    MPIResponseList::SerializeToString(wire_response_list, encoded_response);
+    int encoded_response_length = (int)encoded_response.length() + 1;
+    MPI_Bcast(&encoded_response_length, 1, MPI_INT, RANK_ZERO, comm);
+    MPI_Bcast((void*)encoded_response.c_str(), encoded_response_length,
+              MPI_BYTE, RANK_ZERO, comm);
+  } else {
+    int msg_length;
+    MPI_Bcast(&msg_length, 1, MPI_INT, RANK_ZERO, comm);
+    auto buffer = new char[msg_length];
+    MPI_Bcast(buffer, msg_length, MPI_BYTE, RANK_ZERO, comm);
+    std::string received_message(buffer, (size_t)msg_length);
+    MPIResponseList::ParseFromString(response_list, received_message);
+    tensor_ids.DecodeResponses(response_list);
+    delete[] buffer;
+  }
+}
+
+// Two-level negotiation. Ranks send their requests to local rank zero of their
+// node, which checks them against the first request of the tensor by signature
+// and records them in the node request table. Once all ranks of the node are
+// ready for a tensor, a single request that stands for all node ranks with a
+// matching request is forwarded to the coordinator, along with any mismatched
+// requests. The coordinator thus receives one request list per node rather
+// than one per rank, and one request per tensor and node rather than one per
+// rank. Requests of every node leader end up in request_lists on the
+// coordinator.
+void GatherNodeReadyRequestLists(HorovodGlobalState& state,
+                                 MPIRequestList& message_list,
+                                 std::vector<MPIRequestList>& request_lists) {
+  std::vector<MPIRequestList> local_request_lists;
+  GatherRequestLists(message_list, local_request_lists, state.tensor_ids,
+                     state.negotiation_local_comm, RANK_ZERO);
+  if (state.local_rank != RANK_ZERO) {
+    return;
+  }
+
+  auto& node_request_table = *state.node_request_table;
+  MPIRequestList node_ready_list;
+  for (auto& local_request_list : local_request_lists) {
+    for (auto& request : local_request_list.requests()) {
+      auto tensor_id = request.tensor_id();
+      auto it = node_request_table.find(tensor_id);
+      if (it == node_request_table.end()) {
+        NodeRequestTableEntry entry;
+        entry.request = request;
+        entry.start_at = std::chrono::steady_clock::now();
+        it = node_request_table.emplace(tensor_id, std::move(entry)).first;
+        state.tensor_ids.Acquire(tensor_id);
+      }
+      auto& entry = it->second;
+      if (request.signature() == entry.request.signature()) {
+        auto& shape = request.tensor_shape();
+        entry.request.add_node_rank(request.request_rank(), request.device(),
+                                    shape.empty() ? 0 : shape[0]);
+      } else {
+        entry.mismatched_requests.push_back(request);
+      }
+      if ((int)(entry.request.node_ranks().size() +
+                entry.mismatched_requests.size()) == state.local_size) {
+        node_ready_list.add_requests(entry.request);
+        for (auto& mismatched_request : entry.mismatched_requests) {
+          node_ready_list.add_requests(mismatched_request);
+        }
+        node_request_table.erase(it);
+        state.tensor_ids.Release(tensor_id);
+      }
+    }
+    if (local_request_list.shutdown()) {
+      node_ready_list.set_shutdown(true);
+    }
+  }
+
+  GatherRequestLists(node_ready_list, request_lists, state.tensor_ids,
+                     state.negotiation_cross_comm, RANK_ZERO);
+}
+
+// Rank coordinating the given shard of tensors with sharded negotiation.
+// Shard coordinators are spread evenly over the ranks, so that they end up on
+// different nodes.
+int ShardCoordinatorRank(const HorovodGlobalState& state, int shard) {
+  return (int)((int64_t)shard * state.size / state.coordinator_shards);
+}
+
+// Shard of tensors that the tensor belongs to with sharded negotiation. Since
+// local tensor IDs differ between ranks, and wire IDs may be reused while a
+// tensor waits for the other ranks, tensors are split by name hash.
+int TensorShard(const HorovodGlobalState& state, int32_t tensor_id) {
+  return (int)(state.tensor_ids.name_hash(tensor_id) %
+               (uint64_t)state.coordinator_shards);
+}
+
+// Sharded negotiation. Requests are split by tensor shard, and every rank
+// sends the requests of each shard to its coordinator in a single all-to-all
+// exchange, instead of one gather per shard. Requests of the shard
+// coordinated by this rank end up in request_lists, indexed by rank.
+void GatherShardRequestLists(HorovodGlobalState& state,
+                             MPIRequestList& message_list,
+                             std::vector<MPIRequestList>& request_lists) {
+  std::vector<MPIRequestList> shard_lists((size_t)state.coordinator_shards);
+  for (auto& request : message_list.requests()) {
+    shard_lists[TensorShard(state, request.tensor_id())].add_requests(
+        request);
+  }
+
+  // 1. Encode the request list of every shard for its coordinator. Other
+  // ranks receive nothing, and this rank keeps its own shard list as is.
+  std::vector<std::string> encoded_messages((size_t)state.size);
+  std::vector<int> sendcounts((size_t)state.size, 0);
+  int own_shard = -1;
+  for (int shard = 0; shard < state.coordinator_shards; shard++) {
+    auto& shard_list = shard_lists[shard];
+    shard_list.set_shutdown(message_list.shutdown());
+    int shard_coordinator = ShardCoordinatorRank(state, shard);
+    if (shard_coordinator == state.rank) {
+      own_shard = shard;
+      continue;
+    }
+    auto& encoded_message = encoded_messages[shard_coordinator];
+    state.tensor_ids.EncodeRequests(shard_list);
+    MPIRequestList::SerializeToString(shard_list, encoded_message);
+    sendcounts[shard_coordinator] = (int)encoded_message.length();
+  }
+
+  // 2. Exchange message lengths, and compute displacements.
+  std::vector<int> recvcounts((size_t)state.size);
+  MPI_Alltoall(sendcounts.data(), 1, MPI_INT, recvcounts.data(), 1, MPI_INT,
+               state.negotiation_comm);
+  std::vector<int> senddispls((size_t)state.size, 0);
+  std::vector<int> recvdispls((size_t)state.size, 0);
+  for (int i = 1; i < state.size; i++) {
+    senddispls[i] = senddispls[i - 1] + sendcounts[i - 1];
+    recvdispls[i] = recvdispls[i - 1] + recvcounts[i - 1];
+  }
+  std::string send_buffer;
+  for (auto& encoded_message : encoded_messages) {
+    send_buffer += encoded_message;
+  }
+  std::vector<char> recv_buffer(
+      (size_t)(recvdispls[state.size - 1] + recvcounts[state.size - 1]) + 1);
+
+  // 3. Exchange messages.
+  MPI_Alltoallv((void*)send_buffer.data(), sendcounts.data(),
+                senddispls.data(), MPI_BYTE, recv_buffer.data(),
+                recvcounts.data(), recvdispls.data(), MPI_BYTE,
+                state.negotiation_comm);
+
+  // 4. Parse the messages received by a shard coordinator.
+  if (own_shard < 0) {
+    return;
+  }
+  request_lists.resize((size_t)state.size);
+  request_lists[state.rank] = std::move(shard_lists[own_shard]);
+  for (int i = 0; i < state.size; i++) {
+    if (i == state.rank) {
+      continue;
+    }
+    std::string received_data(recv_buffer.data() + recvdispls[i],
+                              (size_t)recvcounts[i]);
+    MPIRequestList::ParseFromString(request_lists[i], received_data);
+    state.tensor_ids.DecodeRequests(request_lists[i]);
+  }
+}
+
+// Exchange the responses constructed by the shard coordinators, and merge
+// them in shard order, so that every rank ends up with the same response
+// list. Since responses of different shards may fuse together, every rank
+// fuses the merged responses itself.
+MPIResponseList
+AllgatherShardResponseLists(HorovodGlobalState& state,
+                            MPIResponseList& shard_response_list) {
+  // Ranks that do not coordinate a shard, and shard coordinators without
+  // responses, send nothing.
+  std::string encoded_response;
+  if (state.message_table && (!shard_response_list.responses().empty() ||
+                              shard_response_list.shutdown())) {
+    MPIResponseList wire_response_list = shard_response_list;
+    state.tensor_ids.EncodeResponses(wire_response_list);
+    MPIResponseList::SerializeToString(wire_response_list, encoded_response);
+  }
+  int encoded_response_length = (int)encoded_response.length();
+
+  auto recvcounts = new int[state.size];
+  MPI_Allgather(&encoded_response_length, 1, MPI_INT, recvcounts, 1, MPI_INT,
+                state.negotiation_comm);
+
+  auto displcmnts = new int[state.size];
+  size_t total_size = 0;
+  for (int i = 0; i < state.size; i++) {
+    if (i == 0) {
+      displcmnts[i] = 0;
+    } else {
+      displcmnts[i] = recvcounts[i - 1] + displcmnts[i - 1];
+    }
+    total_size += recvcounts[i];
+  }
+
+  // Idle cycles exchange nothing but the lengths.
+  auto buffer = new char[total_size];
+  if (total_size > 0) {
+    MPI_Allgatherv((void*)encoded_response.c_str(), encoded_response_length,
+                   MPI_BYTE, buffer, recvcounts, displcmnts, MPI_BYTE,
+                   state.negotiation_comm);
+  }
+
+  // Shard coordinators are ordered by shard, so merging in rank order
+  // merges in shard order.
+  std::deque<MPIResponse> responses;
+  bool shutdown = false;
+  for (int i = 0; i < state.size; i++) {
+    if (recvcounts[i] == 0) {
+      continue;
+    }
+    std::string received_data(buffer + displcmnts[i], (size_t)recvcounts[i]);
+    MPIResponseList received_response_list;
+    MPIResponseList::ParseFromString(received_response_list, received_data);
+    state.tensor_ids.DecodeResponses(received_response_list);
+    for (auto& response : received_response_list.responses()) {
+      responses.push_back(response);
+    }
+    if (received_response_list.shutdown()) {
+      shutdown = true;
+    }
+  }
+
+  delete[] recvcounts;
+  delete[] displcmnts;
+  delete[] buffer;
+
+  MPIResponseList response_list = FuseResponses(responses, state);
+  response_list.set_shutdown(shutdown);
+  return response_list;
+}
+
+// Perform the collective operation of the response, or queue it for the
+// execution thread if negotiation overlaps with execution. Either way, every
+// rank performs the responses in the same order.
+void ExecuteResponse(HorovodGlobalState& state, const MPIResponse& response) {
+  if (!state.overlap_negotiation) {
+    PerformOperation(state.tensor_table, response);
+    return;
+  }
+
+  std::lock_guard<std::mutex> guard(state.execution_mutex);
+  state.execution_queue.push(response);
+  state.execution_cv.notify_one();
+}
+
+// The execution thread performs the collective operations of the responses
+// queued by the background thread, until the background thread is done and
+// all queued responses are performed.
+void ExecutionThreadLoop(HorovodGlobalState& state) {
+  while (true) {
+    MPIResponse response;
+    {
+      std::unique_lock<std::mutex> lock(state.execution_mutex);
+      if (state.execution_queue.empty() &&
+          !state.in_flight_operations.empty()) {
+        // Complete in-flight operations before waiting for more responses.
+        lock.unlock();
+        CompleteInFlightOperations();
+        continue;
+      }
+      state.execution_cv.wait(lock, [&state]() {
+        return !state.execution_queue.empty() || state.execution_done;
+      });
+      if (state.execution_queue.empty()) {
+        return;
+      }
+      response = std::move(state.execution_queue.front());
+      state.execution_queue.pop();
+    }
+    PerformOperation(state.tensor_table, response);
+  }
+}
+
+// Round fusion thresholds up to whole fusion threshold units.
+int64_t RoundFusionThreshold(const HorovodGlobalState& state,
+                             int64_t fusion_threshold) {
+  int64_t unit = state.fusion_threshold_unit;
+  return ((fusion_threshold + unit - 1) / unit) * unit;
+}
+
+// Set the parameters tuned by the autotuner.
+void SetTunedParameters(HorovodGlobalState& state, int64_t fusion_threshold,
+                        double cycle_time_ms) {
+  state.tensor_fusion_threshold = RoundFusionThreshold(state, fusion_threshold);
+  state.cycle_time_ms = cycle_time_ms;
+}
+
+// The MPI background thread loop coordinates all the MPI processes and the
+// tensor reductions. The design of the communicator mechanism is limited by a
+// few considerations:
+//
+//      1. Some MPI implementations require all MPI calls to happen from a
+//      single thread. Since TensorFlow may use several threads for graph
+//      processing, this means we must have our own dedicated thread for dealing
+//      with MPI.
+//      2. We want to gracefully handle errors, when MPI processes do not
+//      properly agree upon what should happen (such as mismatched types or
+//      shapes). To do so requires the MPI processes to know about the shapes
+//      and types of the relevant tensors on the other processes.
+//      3. The MPI reductions and gathers should be able to happen in parallel
+//      with other ongoing operations. This means that they cannot be blocking
+//      ops, but rather must be async ops, the execution of which happens on a
+//      separate thread.
+//      4. We cannot guarantee that all the MPI processes reduce their tensors
+//      in the same order, so we cannot dispatch one thread per tensor,
+//      otherwise we may end up dispatching many blocked threads and never make
+//      progress if we have a thread pool limit.
+bool RunLoopOnce(HorovodGlobalState& state, bool is_coordinator);
+void BackgroundThreadLoop(HorovodGlobalState& state) {
+  // Initialize MPI if it was not initialized. This must happen on the
+  // background thread, since not all MPI implementations support being called
+  // from multiple threads.
+  //
+  // In some cases MPI library has multi-threading support, but it slows down
+  // certain components, e.g. OpenIB BTL in OpenMPI gets disabled if
+  // MPI_THREAD_MULTIPLE is requested.
+  //
+  // By default, we will ask for multiple threads, so other libraries like
+  // mpi4py can be used together with Horovod if multi-threaded MPI is
+  // installed.
+  auto mpi_threads_disable = std::getenv(HOROVOD_MPI_THREADS_DISABLE);
+  int required = MPI_THREAD_MULTIPLE;
+  if (mpi_threads_disable != nullptr &&
+      std::strtol(mpi_threads_disable, nullptr, 10) > 0) {
+    required = MPI_THREAD_SINGLE;
+  }
+  int provided;
+  int is_mpi_initialized = 0;
+  MPI_Initialized(&is_mpi_initialized);
+  if (is_mpi_initialized) {
+    MPI_Query_thread(&provided);
+    if (provided < MPI_THREAD_MULTIPLE) {
+      std::cerr << "WARNING: MPI has already been initialized without "
+                   "multi-threading support (MPI_THREAD_MULTIPLE). This will "
+                   "likely cause a segmentation fault."
+                << std::endl;
+    }
+  } else {
+    MPI_Init_thread(NULL, NULL, required, &provided);
+    state.should_finalize = true;
+  }
+
+  if (state.ranks.size() > 0) {
+    MPI_Group world_group;
+    MPI_Comm_group(MPI_COMM_WORLD, &world_group);
+    MPI_Group work_group;
+    MPI_Group_incl(world_group, state.ranks.size(), &(state.ranks[0]),
+                   &work_group);
+    MPI_Comm_create_group(MPI_COMM_WORLD, work_group, 0, &(state.mpi_comm));
+    if (state.mpi_comm == MPI_COMM_NULL) {
+      std::cerr << "WARNING: Unable to create Horovod communicator, using "
+                   "MPI_COMM_WORLD instead."
+                << std::endl;
+      state.mpi_comm = MPI_COMM_WORLD;
+    }
+    MPI_Group_free(&world_group);
     MPI_Group_free(&work_group);
   } else if (!state.mpi_comm) {
     // No ranks were given and no communicator provided to horovod_init() so use
@@ -1536,9 +3298,22 @@ void BackgroundThreadLoop(HorovodGlobalState& state) {
   MPI_Type_contiguous(2, MPI_BYTE, &mpi_float16_t);
   MPI_Type_commit(&mpi_float16_t);
 
-  // Create custom MPI float16 summation op.
-  MPI_Op mpi_float16_sum;
-  MPI_Op_create(&float16_sum, 1, &mpi_float16_sum);
+  // Create custom MPI float16 reduction ops.
+  MPI_Op_create(&float16_sum, 1, &state.mpi_float16_ops[(int)ReduceOp::SUM]);
+  MPI_Op_create(&float16_min, 1, &state.mpi_float16_ops[(int)ReduceOp::MIN]);
+  MPI_Op_create(&float16_max, 1, &state.mpi_float16_ops[(int)ReduceOp::MAX]);
+  MPI_Op_create(&float16_product, 1,
+                &state.mpi_float16_ops[(int)ReduceOp::PRODUCT]);
+
+  // Create custom MPI bfloat16 data type and reduction ops.
+  MPI_Datatype mpi_bfloat16_t;
+  MPI_Type_contiguous(2, MPI_BYTE, &mpi_bfloat16_t);
+  MPI_Type_commit(&mpi_bfloat16_t);
+  MPI_Op_create(&bfloat16_sum, 1, &state.mpi_bfloat16_ops[(int)ReduceOp::SUM]);
+  MPI_Op_create(&bfloat16_min, 1, &state.mpi_bfloat16_ops[(int)ReduceOp::MIN]);
+  MPI_Op_create(&bfloat16_max, 1, &state.mpi_bfloat16_ops[(int)ReduceOp::MAX]);
+  MPI_Op_create(&bfloat16_product, 1,
+                &state.mpi_bfloat16_ops[(int)ReduceOp::PRODUCT]);
 
   state.rank = rank;
   state.local_rank = local_rank;
@@ -1549,7 +3324,7 @@ void BackgroundThreadLoop(HorovodGlobalState& state) {
   state.local_comm = local_comm;
   state.cross_comm = cross_comm;
   state.mpi_float16_t = mpi_float16_t;
-  state.mpi_float16_sum = mpi_float16_sum;
+  state.mpi_bfloat16_t = mpi_bfloat16_t;
   state.mpi_threads_supported = (provided == MPI_THREAD_MULTIPLE);
   state.local_comm_ranks = local_comm_ranks;
 
@@ -1565,6 +3340,19 @@ void BackgroundThreadLoop(HorovodGlobalState& state) {
     state.cycle_time_ms = std::strtof(horovod_cycle_time, nullptr);
   }
 
+  // Start cycles as soon as requests are enqueued.
+  auto horovod_event_driven_cycle = std::getenv(HOROVOD_EVENT_DRIVEN_CYCLE);
+  if (horovod_event_driven_cycle != nullptr &&
+      std::strtol(horovod_event_driven_cycle, nullptr, 10) > 0) {
+    state.event_driven_cycle = true;
+  }
+
+  // Override the time to wait for more requests after being woken up.
+  auto horovod_cycle_batch_time = std::getenv(HOROVOD_CYCLE_BATCH_TIME);
+  if (horovod_cycle_batch_time != nullptr) {
+    state.cycle_batch_time_ms = std::strtof(horovod_cycle_batch_time, nullptr);
+  }
+
   // Disable stall check.
   auto horovod_stall_check_disable = std::getenv(HOROVOD_STALL_CHECK_DISABLE);
   if (horovod_stall_check_disable != nullptr &&
@@ -1572,18 +3360,134 @@ void BackgroundThreadLoop(HorovodGlobalState& state) {
     state.perform_stall_check = false;
   }
 
-  // Set flag for hierarchical allreduce. Ignore if Horovod is running on a
+  // Set flag for hierarchical negotiation. Ignore if Horovod is running on a
   // single node.
+  auto horovod_hierarchical_negotiation =
+      std::getenv(HOROVOD_HIERARCHICAL_NEGOTIATION);
+  if (horovod_hierarchical_negotiation != nullptr &&
+      std::strtol(horovod_hierarchical_negotiation, nullptr, 10) > 0 &&
+      (size != local_size)) {
+    state.hierarchical_negotiation = true;
+  }
+
+  // Set flag for overlapping negotiation with execution. It requires MPI
+  // multi-threading support, since both threads make MPI calls.
+  auto horovod_overlap_negotiation = std::getenv(HOROVOD_OVERLAP_NEGOTIATION);
+  if (horovod_overlap_negotiation != nullptr &&
+      std::strtol(horovod_overlap_negotiation, nullptr, 10) > 0) {
+    if (state.mpi_threads_supported) {
+      state.overlap_negotiation = true;
+    } else if (is_coordinator) {
+      std::cerr << "WARNING: Overlapping negotiation with execution requires "
+                   "MPI multi-threading support (MPI_THREAD_MULTIPLE) and "
+                   "will be disabled."
+                << std::endl;
+    }
+  }
+
+  // Negotiate on separate communicators when overlapping with execution, so
+  // that negotiation does not interfere with the collective operations.
+  if (state.overlap_negotiation) {
+    MPI_Comm_dup(state.mpi_comm, &state.negotiation_comm);
+    MPI_Comm_dup(local_comm, &state.negotiation_local_comm);
+    MPI_Comm_dup(cross_comm, &state.negotiation_cross_comm);
+  } else {
+    state.negotiation_comm = state.mpi_comm;
+    state.negotiation_local_comm = local_comm;
+    state.negotiation_cross_comm = cross_comm;
+  }
+
+  // Read the rules of the algorithm registry on the coordinator and broadcast
+  // them, so that all ranks choose the same algorithms even if their
+  // environments differ.
+  std::string algorithm_spec;
+  if (is_coordinator) {
+    auto horovod_algorithms_file = std::getenv(HOROVOD_ALGORITHMS_FILE);
+    if (horovod_algorithms_file != nullptr) {
+      std::ifstream file(horovod_algorithms_file);
+      if (file) {
+        std::stringstream ss;
+        ss << file.rdbuf();
+        algorithm_spec = ss.str() + "\n";
+      } else {
+        std::cerr << "WARNING: Unable to read algorithm rules from "
+                  << horovod_algorithms_file << "." << std::endl;
+      }
+    }
+    auto horovod_algorithms = std::getenv(HOROVOD_ALGORITHMS);
+    if (horovod_algorithms != nullptr) {
+      algorithm_spec += horovod_algorithms;
+    }
+  }
+  int algorithm_spec_len = (int)algorithm_spec.size();
+  MPI_Bcast(&algorithm_spec_len, 1, MPI_INT, RANK_ZERO, state.mpi_comm);
+  algorithm_spec.resize((size_t)algorithm_spec_len);
+  MPI_Bcast(&algorithm_spec[0], algorithm_spec_len, MPI_BYTE, RANK_ZERO,
+            state.mpi_comm);
+  auto algorithm_status = state.algorithms.Parse(algorithm_spec);
+  if (is_coordinator && !algorithm_status.ok()) {
+    std::cerr << "WARNING: Ignoring algorithm rules: "
+              << algorithm_status.reason() << std::endl;
+  }
+
+  // The knobs below append rules after the rules of the user, so that the
+  // latter take precedence.
+
+  // Sum small tensors in host memory with the recursive-doubling allreduce.
+  auto horovod_recursive_doubling_threshold =
+      std::getenv(HOROVOD_RECURSIVE_DOUBLING_THRESHOLD);
+  if (horovod_recursive_doubling_threshold != nullptr &&
+      std::strtol(horovod_recursive_doubling_threshold, nullptr, 10) > 0) {
+    AlgorithmRule rule;
+    rule.op = MPIResponse::ALLREDUCE;
+    rule.gpu = false;
+    rule.max_bytes =
+        std::strtol(horovod_recursive_doubling_threshold, nullptr, 10);
+    rule.algorithm = "recursive_doubling";
+    state.algorithms.Add(rule);
+  }
+
+  // Sum tensors in host memory with the ring allreduce.
+  auto horovod_ring_allreduce = std::getenv(HOROVOD_RING_ALLREDUCE);
+  if (horovod_ring_allreduce != nullptr &&
+      std::strtol(horovod_ring_allreduce, nullptr, 10) > 0) {
+    AlgorithmRule rule;
+    rule.op = MPIResponse::ALLREDUCE;
+    rule.gpu = false;
+    rule.algorithm = "ring";
+    state.algorithms.Add(rule);
+  }
+
+  // Pipeline fused tensors in host memory in chunks of the given size.
+  auto horovod_fusion_chunk_size = std::getenv(HOROVOD_FUSION_CHUNK_SIZE);
+  if (horovod_fusion_chunk_size != nullptr &&
+      std::strtol(horovod_fusion_chunk_size, nullptr, 10) > 0) {
+    state.fusion_chunk_size =
+        std::strtol(horovod_fusion_chunk_size, nullptr, 10);
+    AlgorithmRule rule;
+    rule.op = MPIResponse::ALLREDUCE;
+    rule.gpu = false;
+    rule.algorithm = "pipelined";
+    state.algorithms.Add(rule);
+  }
+
+  // Do hierarchical allreduce of tensors on GPU. Rules only choose it if
+  // Horovod is running on more than one node.
   auto horovod_hierarchical_allreduce =
       std::getenv(HOROVOD_HIERARCHICAL_ALLREDUCE);
   if (horovod_hierarchical_allreduce != nullptr &&
-      std::strtol(horovod_hierarchical_allreduce, nullptr, 10) > 0 &&
-      (size != local_size)) {
-    state.hierarchical_allreduce = true;
+      std::strtol(horovod_hierarchical_allreduce, nullptr, 10) > 0) {
+    AlgorithmRule rule;
+    rule.op = MPIResponse::ALLREDUCE;
+    rule.gpu = true;
+    rule.algorithm = "hierarchical";
+    state.algorithms.Add(rule);
   }
+  bool hierarchical_allreduce =
+      size != local_size && state.algorithms.Uses("hierarchical");
 
   // Issue warning if hierarchical allreduce is enabled in heterogeneous cluster
-  if (is_coordinator && state.hierarchical_allreduce && !state.is_homogeneous) {
+  if (is_coordinator && hierarchical_allreduce && !state.is_homogeneous) {
     std::cerr
         << "WARNING: Using different number of ranks per node might hurt "
            "performance of hierarchical allreduce. Consider assigning the same "
@@ -1591,17 +3495,10 @@ void BackgroundThreadLoop(HorovodGlobalState& state) {
         << std::endl;
   }
 
-  // Override Tensor Fusion threshold, if it's set.
-  auto horovod_fusion_threshold = std::getenv("HOROVOD_FUSION_THRESHOLD");
-  int64_t proposed_fusion_threshold =
-      (horovod_fusion_threshold != nullptr)
-          ? std::strtol(horovod_fusion_threshold, nullptr, 10)
-          : state.tensor_fusion_threshold;
-
   // If the cluster is homogeneous and hierarchical allreduce is enabled,
   // adjust buffer size to make sure it is divisible by local_size to improve
   // performance.
-  if (state.is_homogeneous && state.hierarchical_allreduce) {
+  if (state.is_homogeneous && hierarchical_allreduce) {
     // Assume the worst-case data type float64, since if it is divisible with
     // float64, it will be divisible for other types too.
 
@@ -1609,18 +3506,167 @@ void BackgroundThreadLoop(HorovodGlobalState& state) {
     // FUSION_BUFFER_ATOMIC_UNIT for performance
     int mpi_double_size;
     MPI_Type_size(MPI_DOUBLE, &mpi_double_size);
-    int64_t div =
+    state.fusion_threshold_unit =
         state.local_size * mpi_double_size * FUSION_BUFFER_ATOMIC_UNIT;
-    state.tensor_fusion_threshold =
-        ((proposed_fusion_threshold + div - 1) / div) * div;
-  } else {
-    state.tensor_fusion_threshold = proposed_fusion_threshold;
+  }
+
+  // Override Tensor Fusion threshold, if it's set.
+  auto horovod_fusion_threshold = std::getenv("HOROVOD_FUSION_THRESHOLD");
+  int64_t proposed_fusion_threshold =
+      (horovod_fusion_threshold != nullptr)
+          ? std::strtol(horovod_fusion_threshold, nullptr, 10)
+          : state.tensor_fusion_threshold;
+  SetTunedParameters(state, proposed_fusion_threshold, state.cycle_time_ms);
+  state.fusion_buffer_size = state.tensor_fusion_threshold;
+
+  // Tune the fusion threshold and the cycle time while training runs, unless
+  // the coordinator finds parameters saved by a previous job. The coordinator
+  // broadcasts the initial parameters, whether tuning is active, and the
+  // largest fusion threshold it may choose.
+  auto horovod_autotune = std::getenv(HOROVOD_AUTOTUNE);
+  if (horovod_autotune != nullptr &&
+      std::strtol(horovod_autotune, nullptr, 10) > 0) {
+    auto horovod_autotune_file = std::getenv(HOROVOD_AUTOTUNE_FILE);
+    if (horovod_autotune_file != nullptr) {
+      state.autotune_file = horovod_autotune_file;
+    }
+
+    double message[4];
+    TunedParameters parameters;
+    if (is_coordinator && !state.autotune_file.empty() &&
+        AutoTuner::LoadParameters(state.autotune_file, &parameters)) {
+      message[0] = (double)parameters.fusion_threshold;
+      message[1] = parameters.cycle_time_ms;
+      message[2] = 0;
+      message[3] = message[0];
+    } else if (is_coordinator) {
+      int warmup_samples = 3;
+      auto horovod_autotune_warmup_samples =
+          std::getenv(HOROVOD_AUTOTUNE_WARMUP_SAMPLES);
+      if (horovod_autotune_warmup_samples != nullptr) {
+        warmup_samples = std::max(
+            (int)std::strtol(horovod_autotune_warmup_samples, nullptr, 10), 0);
+      }
+      int cycles_per_sample = 10;
+      auto horovod_autotune_cycles_per_sample =
+          std::getenv(HOROVOD_AUTOTUNE_CYCLES_PER_SAMPLE);
+      if (horovod_autotune_cycles_per_sample != nullptr) {
+        cycles_per_sample = std::max(
+            (int)std::strtol(horovod_autotune_cycles_per_sample, nullptr, 10),
+            1);
+      }
+
+      parameters.fusion_threshold = proposed_fusion_threshold;
+      parameters.cycle_time_ms = state.cycle_time_ms;
+      state.autotuner.Initialize(parameters, warmup_samples,
+                                 cycles_per_sample);
+      message[0] = (double)parameters.fusion_threshold;
+      message[1] = parameters.cycle_time_ms;
+      message[2] = 1;
+      message[3] = (double)state.autotuner.max_fusion_threshold();
+    }
+    MPI_Bcast(message, 4, MPI_DOUBLE, RANK_ZERO, state.mpi_comm);
+
+    SetTunedParameters(state, (int64_t)message[0], message[1]);
+    state.autotune = message[2] != 0;
+    state.fusion_buffer_size =
+        std::max(state.tensor_fusion_threshold,
+                 RoundFusionThreshold(state, (int64_t)message[3]));
+  }
+
+  // Override the number of fusion buffers per device and framework.
+  auto horovod_num_fusion_buffers = std::getenv(HOROVOD_NUM_FUSION_BUFFERS);
+  if (horovod_num_fusion_buffers != nullptr) {
+    state.num_fusion_buffers = std::max(
+        (int)std::strtol(horovod_num_fusion_buffers, nullptr, 10), 1);
+  }
+
+  // Override the size of the segments of the ring allreduce.
+  auto horovod_ring_segment_size = std::getenv(HOROVOD_RING_SEGMENT_SIZE);
+  if (horovod_ring_segment_size != nullptr) {
+    state.ring_segment_size =
+        std::max(std::strtol(horovod_ring_segment_size, nullptr, 10), 1l);
+  }
+
+  // Override the maximum number of in-flight operations.
+  state.max_in_flight = state.num_fusion_buffers;
+  auto horovod_max_in_flight = std::getenv(HOROVOD_MAX_IN_FLIGHT);
+  if (horovod_max_in_flight != nullptr) {
+    state.max_in_flight =
+        std::max((int)std::strtol(horovod_max_in_flight, nullptr, 10), 1);
+  }
+
+  // Override the number of threads that copy tensors into and out of the
+  // fusion buffer.
+  int memcpy_threads = 1;
+  auto horovod_memcpy_threads = std::getenv(HOROVOD_MEMCPY_THREADS);
+  if (horovod_memcpy_threads != nullptr) {
+    memcpy_threads = std::max(
+        (int)std::strtol(horovod_memcpy_threads, nullptr, 10), 1);
+  }
+  state.memcpy_pool.Initialize(memcpy_threads);
+
+  // Override the number of threads that reduce large buffers in host memory.
+  int reduction_threads = 1;
+  auto horovod_reduction_threads = std::getenv(HOROVOD_REDUCTION_THREADS);
+  if (horovod_reduction_threads != nullptr) {
+    reduction_threads = std::max(
+        (int)std::strtol(horovod_reduction_threads, nullptr, 10), 1);
+  }
+  GlobalReductionPool().Initialize(reduction_threads);
+
+  // Fuse tensors in the order in which they became ready.
+  auto horovod_ordered_fusion = std::getenv(HOROVOD_ORDERED_FUSION);
+  if (horovod_ordered_fusion != nullptr &&
+      std::strtol(horovod_ordered_fusion, nullptr, 10) > 0) {
+    state.ordered_fusion = true;
+  }
+
+  // Override the response cache capacity. Setting it to zero disables the
+  // response cache.
+  auto horovod_cache_capacity = std::getenv(HOROVOD_CACHE_CAPACITY);
+  if (horovod_cache_capacity != nullptr) {
+    state.cache_capacity =
+        (uint32_t)std::strtol(horovod_cache_capacity, nullptr, 10);
+  }
+  state.response_cache.set_capacity(state.cache_capacity);
+
+  // Override the number of coordinator shards. Sharded negotiation does not
+  // combine with hierarchical negotiation, which takes precedence.
+  auto horovod_coordinator_shards = std::getenv(HOROVOD_COORDINATOR_SHARDS);
+  if (horovod_coordinator_shards != nullptr) {
+    int shards = (int)std::strtol(horovod_coordinator_shards, nullptr, 10);
+    state.coordinator_shards = std::max(1, std::min(shards, size));
+  }
+  if (state.coordinator_shards > 1 && state.hierarchical_negotiation) {
+    if (is_coordinator) {
+      std::cerr << "WARNING: Sharded negotiation is not supported together "
+                   "with hierarchical negotiation and will be disabled."
+                << std::endl;
+    }
+    state.coordinator_shards = 1;
   }
 
   // Initialize the tensor count table. No tensors are available yet.
-  if (is_coordinator) {
+  bool is_shard_coordinator = false;
+  for (int shard = 0; shard < state.coordinator_shards; shard++) {
+    if (ShardCoordinatorRank(state, shard) == rank) {
+      is_shard_coordinator = true;
+    }
+  }
+  if (is_coordinator || is_shard_coordinator) {
     state.message_table = std::unique_ptr<MessageTable>(new MessageTable());
   }
+  if (state.hierarchical_negotiation && local_rank == 0) {
+    state.node_request_table =
+        std::unique_ptr<NodeRequestTable>(new NodeRequestTable());
+  }
+
+  // Start the execution thread.
+  if (state.overlap_negotiation) {
+    state.execution_done = false;
+    state.execution_thread = std::thread(ExecutionThreadLoop, std::ref(state));
+  }
 
   // Signal that initialization is completed.
   state.initialization_done = true;
@@ -1629,6 +3675,31 @@ void BackgroundThreadLoop(HorovodGlobalState& state) {
   while (RunLoopOnce(state, is_coordinator))
     ;
 
+  // Let the execution thread perform the remaining responses and stop.
+  if (state.overlap_negotiation) {
+    {
+      std::lock_guard<std::mutex> guard(state.execution_mutex);
+      state.execution_done = true;
+      state.execution_cv.notify_one();
+    }
+    state.execution_thread.join();
+    MPI_Comm_free(&state.negotiation_comm);
+    MPI_Comm_free(&state.negotiation_local_comm);
+    MPI_Comm_free(&state.negotiation_cross_comm);
+    state.overlap_negotiation = false;
+  }
+  state.memcpy_pool.Shutdown();
+  GlobalReductionPool().Shutdown();
+
+  // Free the custom MPI operations before MPI is finalized. The custom data
+  // types are freed by horovod_shutdown.
+  for (auto& op : state.mpi_float16_ops) {
+    MPI_Op_free(&op);
+  }
+  for (auto& op : state.mpi_bfloat16_ops) {
+    MPI_Op_free(&op);
+  }
+
   // Signal that shutdown has been requested.
   state.shut_down = true;
 
@@ -1657,11 +3728,73 @@ void BackgroundThreadLoop(HorovodGlobalState& state) {
       state.message_queue.pop();
     }
   }
+  state.cache_hits.clear();
+  state.uncached_requests.clear();
+  state.tensor_ids.clear();
+  state.message_table.reset();
+  state.node_request_table.reset();
   for (auto& cb : callbacks) {
     cb(SHUT_DOWN_ERROR);
   }
 }
 
+// Wait until requests are enqueued, up to the idle backoff. The backoff
+// doubles with every wait that times out, up to the cycle time, and is reset
+// while this rank has tensors in flight. Note that a cycle is a collective
+// operation, so it completes only once every rank has started it.
+void WaitForRequests(HorovodGlobalState& state) {
+  std::chrono::steady_clock::duration max_backoff =
+      std::chrono::microseconds(long(state.cycle_time_ms * 1000.));
+  bool woken_up;
+  {
+    std::unique_lock<std::mutex> lock(state.mutex);
+    if (!state.tensor_table.empty()) {
+      state.idle_backoff = IDLE_BACKOFF_MIN;
+    }
+    woken_up = state.cycle_cv.wait_for(lock, state.idle_backoff, [&state]() {
+      return !state.message_queue.empty() || state.shut_down;
+    });
+  }
+
+  if (woken_up) {
+    state.idle_backoff = IDLE_BACKOFF_MIN;
+    if (state.cycle_batch_time_ms > 0 && !state.shut_down) {
+      std::this_thread::sleep_for(
+          std::chrono::microseconds(long(state.cycle_batch_time_ms * 1000.)));
+    }
+  } else {
+    state.idle_backoff = std::min(2 * state.idle_backoff, max_backoff);
+  }
+}
+
+// Feed the bytes performed since the last cycle to the autotuner on the
+// coordinator, and broadcast the parameters of this cycle, so that all ranks
+// fuse responses with the same threshold. Once tuning ends, the coordinator
+// saves the best parameters.
+void UpdateTunedParameters(HorovodGlobalState& state, bool is_coordinator) {
+  double message[3];
+  if (is_coordinator) {
+    state.autotuner.Update(state.autotune_bytes.exchange(0),
+                           state.last_cycle_start);
+    auto parameters = state.autotuner.parameters();
+    message[0] = (double)parameters.fusion_threshold;
+    message[1] = parameters.cycle_time_ms;
+    message[2] = state.autotuner.active() ? 1 : 0;
+  }
+  MPI_Bcast(message, 3, MPI_DOUBLE, RANK_ZERO, state.negotiation_comm);
+
+  SetTunedParameters(state, (int64_t)message[0], message[1]);
+  if (message[2] != 0) {
+    return;
+  }
+  state.autotune = false;
+  if (is_coordinator && !state.autotune_file.empty() &&
+      !state.autotuner.SaveParameters(state.autotune_file)) {
+    std::cerr << "WARNING: Unable to save tuned parameters to "
+              << state.autotune_file << "." << std::endl;
+  }
+}
+
 // The coordinator currently follows a master-worker paradigm. Rank zero acts
 // as the master (the "coordinator"), whereas all other ranks are simply
 // workers. Each rank runs its own background thread which progresses in ticks.
@@ -1692,16 +3825,24 @@ void BackgroundThreadLoop(HorovodGlobalState& state) {
 //      If instead of "DONE" they receive "SHUTDOWN", they exit their background
 //      loop.
 bool RunLoopOnce(HorovodGlobalState& state, bool is_coordinator) {
-  // This delay determines thread frequency and MPI message latency
-  auto sleep_duration =
-      state.last_cycle_start +
-      std::chrono::microseconds(long(state.cycle_time_ms * 1000.)) -
-      std::chrono::steady_clock::now();
-  if (sleep_duration > std::chrono::steady_clock::duration::zero()) {
-    std::this_thread::sleep_for(sleep_duration);
+  if (state.event_driven_cycle) {
+    WaitForRequests(state);
+  } else {
+    // This delay determines thread frequency and MPI message latency
+    auto sleep_duration =
+        state.last_cycle_start +
+        std::chrono::microseconds(long(state.cycle_time_ms * 1000.)) -
+        std::chrono::steady_clock::now();
+    if (sleep_duration > std::chrono::steady_clock::duration::zero()) {
+      std::this_thread::sleep_for(sleep_duration);
+    }
   }
   state.last_cycle_start = std::chrono::steady_clock::now();
 
+  if (state.autotune) {
+    UpdateTunedParameters(state, is_coordinator);
+  }
+
   // Copy the data structures from global state under this lock.
   // However, don't keep the lock for the rest of the loop, so that
   // enqueued stream callbacks can continue.
@@ -1713,193 +3854,181 @@ bool RunLoopOnce(HorovodGlobalState& state, bool is_coordinator) {
       state.message_queue.pop();
       message_queue.push(message);
     }
+    // New algorithm rules apply to the requests enqueued after them. Since no
+    // operations may be outstanding when they are set, every rank applies them
+    // before it performs any of these requests.
+    if (state.pending_algorithms) {
+      state.algorithms = std::move(*state.pending_algorithms);
+      state.pending_algorithms.reset();
+    }
   }
 
+  // Free the IDs of tensors done since the last cycle. Every tensor ID in use
+  // is referenced between cycles.
+  state.tensor_ids.Collect();
+
   // Flag indicating that the background thread should shut down.
   bool should_shut_down = state.shut_down;
 
+  // Coordinate tensors that hit the response cache. Only requests that miss
+  // the cache are left in the message queue for full negotiation, which is
+  // skipped altogether if no rank has such requests.
+  std::deque<MPIResponse> cached_responses;
+  bool should_negotiate = true;
+  if (state.response_cache.capacity() > 0) {
+    should_negotiate = SynchronizeResponseCache(state, message_queue,
+                                                should_shut_down,
+                                                cached_responses);
+  }
+
   // Collect all tensors that are ready to be reduced. Record them in the
   // tensor count table (rank zero) or send them to rank zero to be
   // recorded (everyone else).
-  std::vector<std::string> ready_to_reduce;
-  if (is_coordinator) {
+  MPIResponseList response_list;
+  if (should_negotiate) {
+    MPIRequestList message_list;
+    message_list.set_shutdown(should_shut_down);
     while (!message_queue.empty()) {
-      // Pop the first available message message
-      MPIRequest message = message_queue.front();
+      message_list.add_requests(message_queue.front());
       message_queue.pop();
-
-      bool reduce =
-          IncrementTensorCount(state.message_table, message, state.size);
-      if (reduce) {
-        ready_to_reduce.push_back(message.tensor_name());
-      }
     }
 
-    // Rank zero has put all its own tensors in the tensor count table.
-    // Now, it should count all the tensors that are coming from other
-    // ranks at this tick.
-
-    // 1. Get message lengths from every rank.
-    auto recvcounts = new int[state.size];
-    recvcounts[0] = 0;
-    MPI_Gather(MPI_IN_PLACE, 1, MPI_INT, recvcounts, 1, MPI_INT, RANK_ZERO,
-               state.mpi_comm);
-
-    // 2. Compute displacements.
-    auto displcmnts = new int[state.size];
-    size_t total_size = 0;
-    for (int i = 0; i < state.size; i++) {
-      if (i == 0) {
-        displcmnts[i] = 0;
-      } else {
-        displcmnts[i] = recvcounts[i - 1] + displcmnts[i - 1];
-      }
-      total_size += recvcounts[i];
+    // Send the requests to rank zero, either directly or through local rank
+    // zero of every node, or to the shard coordinators of the tensors.
+    std::vector<MPIRequestList> request_lists;
+    if (state.hierarchical_negotiation) {
+      GatherNodeReadyRequestLists(state, message_list, request_lists);
+    } else if (state.coordinator_shards > 1) {
+      GatherShardRequestLists(state, message_list, request_lists);
+    } else {
+      GatherRequestLists(message_list, request_lists, state.tensor_ids,
+                         state.negotiation_comm, RANK_ZERO);
     }
 
-    // 3. Collect messages from every rank.
-    auto buffer = new char[total_size];
-    MPI_Gatherv(nullptr, 0, MPI_BYTE, buffer, recvcounts, displcmnts, MPI_BYTE,
-                RANK_ZERO, state.mpi_comm);
-
-    // 4. Process messages.
-    for (int i = 1; i < state.size; i++) {
-      std::string received_data(buffer + displcmnts[i], (size_t)recvcounts[i]);
-
-      MPIRequestList received_message_list;
-      MPIRequestList::ParseFromString(received_message_list, received_data);
-      for (auto& received_message : received_message_list.requests()) {
-        auto& received_name = received_message.tensor_name();
-
-        bool reduce = IncrementTensorCount(state.message_table,
-                                           received_message, state.size);
-        if (reduce) {
-          ready_to_reduce.push_back(received_name);
+    MPIResponseList shard_response_list;
+    if (state.message_table) {
+      std::vector<int32_t> ready_to_reduce;
+      for (auto& request_list : request_lists) {
+        for (auto& request : request_list.requests()) {
+          bool reduce =
+              IncrementTensorCount(state.message_table, request, state.size);
+          if (reduce) {
+            ready_to_reduce.push_back(request.tensor_id());
+          }
+        }
+        if (request_list.shutdown()) {
+          // Received SHUTDOWN request from one of the workers.
+          should_shut_down = true;
         }
       }
-      if (received_message_list.shutdown()) {
-        // Received SHUTDOWN request from one of the workers.
-        should_shut_down = true;
-      }
-    }
 
-    // 5. Free buffers.
-    delete[] recvcounts;
-    delete[] displcmnts;
-    delete[] buffer;
+      // At this point, rank zero should have a fully updated tensor count
+      // table and should know all the tensors that need to be reduced or
+      // gathered, and everyone else should have sent all their information
+      // to rank zero. We can now do reductions and gathers; rank zero will
+      // choose which ones and in what order, and will notify the other ranks
+      // before doing each reduction.
+      std::deque<MPIResponse> responses;
+      for (auto tensor_id : ready_to_reduce) {
+        MPIResponse response =
+            ConstructMPIResponse(state.message_table, tensor_id);
+        responses.push_back(std::move(response));
+      }
 
-    // At this point, rank zero should have a fully updated tensor count
-    // table and should know all the tensors that need to be reduced or
-    // gathered, and everyone else should have sent all their information
-    // to rank zero. We can now do reductions and gathers; rank zero will
-    // choose which ones and in what order, and will notify the other ranks
-    // before doing each reduction.
-    std::deque<MPIResponse> responses;
-    for (auto& tensor_name : ready_to_reduce) {
-      MPIResponse response =
-          ConstructMPIResponse(state.message_table, tensor_name);
-      responses.push_back(std::move(response));
-    }
-
-    MPIResponseList response_list;
-    response_list.set_shutdown(should_shut_down);
-
-    while (!responses.empty()) {
-      auto response = responses.front();
-      assert(response.tensor_names().size() == 1);
-      responses.pop_front();
-
-      if (response.response_type() == MPIResponse::ResponseType::ALLREDUCE) {
-        // Attempt to add more responses to this fused response.
-        auto& entry = state.tensor_table[response.tensor_names()[0]];
-        int64_t tensor_size = entry.tensor->size();
-
-        while (!responses.empty()) {
-          auto new_response = responses.front();
-          assert(new_response.tensor_names().size() == 1);
-          auto& new_entry = state.tensor_table[new_response.tensor_names()[0]];
-          int64_t new_tensor_size = new_entry.tensor->size();
-
-          if (response.response_type() == new_response.response_type() &&
-              response.devices() == new_response.devices() &&
-              entry.tensor->dtype() == new_entry.tensor->dtype() &&
-              tensor_size + new_tensor_size <= state.tensor_fusion_threshold) {
-            // These tensors will fuse together well.
-            tensor_size += new_tensor_size;
-            response.add_tensor_names(new_response.tensor_names()[0]);
-            responses.pop_front();
-          } else {
-            // Don't try to fuse additional tensors since they are usually
-            // computed in order of requests and skipping tensors may mean
-            // that the batch will have to wait longer while skipped tensors
-            // could be reduced at that time.
-            break;
-          }
+      if (state.coordinator_shards > 1) {
+        for (auto& response : responses) {
+          shard_response_list.add_responses(response);
         }
+        shard_response_list.set_shutdown(should_shut_down);
+      } else {
+        response_list = FuseResponses(responses, state);
+        response_list.set_shutdown(should_shut_down);
       }
-
-      response_list.add_responses(response);
     }
 
     // Notify all nodes which tensors we'd like to reduce at this step.
-    std::string encoded_response;
-    MPIResponseList::SerializeToString(response_list, encoded_response);
-    int encoded_response_length = (int)encoded_response.length() + 1;
-    MPI_Bcast(&encoded_response_length, 1, MPI_INT, RANK_ZERO, state.mpi_comm);
-    MPI_Bcast((void*)encoded_response.c_str(), encoded_response_length,
-              MPI_BYTE, RANK_ZERO, state.mpi_comm);
-
-    // Perform the collective operation. All nodes should end up performing
-    // the same operation.
-    for (auto& response : response_list.responses()) {
-      PerformOperation(state.tensor_table, response);
+    if (state.coordinator_shards > 1) {
+      response_list = AllgatherShardResponseLists(state, shard_response_list);
+    } else if (state.hierarchical_negotiation) {
+      if (state.local_rank == RANK_ZERO) {
+        BroadcastResponseList(response_list, state.tensor_ids,
+                              state.negotiation_cross_comm);
+      }
+      BroadcastResponseList(response_list, state.tensor_ids,
+                            state.negotiation_local_comm);
+    } else {
+      BroadcastResponseList(response_list, state.tensor_ids,
+                            state.negotiation_comm);
     }
 
-    // Check for stalled tensors.
-    if (state.perform_stall_check &&
-        std::chrono::steady_clock::now() - state.last_stall_check >
-            STALL_WARNING_TIME) {
-      CheckForStalledTensors(state);
-      state.last_stall_check = std::chrono::steady_clock::now();
-    }
-  } else {
-    std::string encoded_message;
-    MPIRequestList message_list;
-    message_list.set_shutdown(should_shut_down);
-    while (!message_queue.empty()) {
-      message_list.add_requests(message_queue.front());
-      message_queue.pop();
+    if (response_list.shutdown()) {
+      should_shut_down = true;
     }
-    MPIRequestList::SerializeToString(message_list, encoded_message);
-    int encoded_message_length = (int)encoded_message.length() + 1;
-    MPI_Gather(&encoded_message_length, 1, MPI_INT, nullptr, 1, MPI_INT,
-               RANK_ZERO, state.mpi_comm);
-    MPI_Gatherv((void*)encoded_message.c_str(), encoded_message_length,
-                MPI_BYTE, nullptr, nullptr, nullptr, MPI_BYTE, RANK_ZERO,
-                state.mpi_comm);
+  }
 
-    int msg_length;
-    MPI_Bcast(&msg_length, 1, MPI_INT, RANK_ZERO, state.mpi_comm);
-    auto buffer = new char[msg_length];
-    MPI_Bcast(buffer, msg_length, MPI_BYTE, RANK_ZERO, state.mpi_comm);
-    std::string received_message(buffer, (size_t)msg_length);
-    MPIResponseList response_list;
-    MPIResponseList::ParseFromString(response_list, received_message);
-    delete[] buffer;
+  // Every rank assigns wire IDs to new tensors and reuses the least recently
+  // used ones in the same order, once the response list has reached all
+  // ranks. Cached responses rely on the wire IDs to keep the local IDs of their
+  // tensors alive, so they are evicted along with them.
+  std::vector<int32_t> freed_ids;
+  for (auto& response : cached_responses) {
+    state.tensor_ids.AssignWireIds(response, freed_ids);
+  }
+  for (auto& response : response_list.responses()) {
+    state.tensor_ids.AssignWireIds(response, freed_ids);
+  }
+  for (auto tensor_id : freed_ids) {
+    state.response_cache.erase_tensor(tensor_id);
+  }
+
+  if (should_negotiate && state.response_cache.capacity() > 0) {
+    CacheResponses(state, response_list);
+  }
 
-    // Perform the collective operation. All nodes should end up performing
-    // the same operation.
-    for (auto& response : response_list.responses()) {
-      PerformOperation(state.tensor_table, response);
+  // Perform the collective operation. All nodes should end up performing
+  // the same operation. Cached and negotiated responses are both ordered by
+  // priority, and are merged by priority with cached tensors first among
+  // responses of equal priority.
+  MPIResponseList cached_response_list;
+  if (!cached_responses.empty()) {
+    cached_response_list = FuseResponses(cached_responses, state);
+  }
+  auto& cached = cached_response_list.responses();
+  auto& negotiated = response_list.responses();
+  auto cached_it = cached.begin();
+  for (auto& response : negotiated) {
+    while (cached_it != cached.end() &&
+           cached_it->priority() >= response.priority()) {
+      ExecuteResponse(state, *cached_it++);
     }
+    ExecuteResponse(state, response);
+  }
+  for (; cached_it != cached.end(); ++cached_it) {
+    ExecuteResponse(state, *cached_it);
+  }
+  if (!state.overlap_negotiation) {
+    CompleteInFlightOperations();
+  }
 
-    if (response_list.shutdown()) {
-      should_shut_down = true;
+  // Check for stalled tensors. With hierarchical negotiation, tensors that
+  // only some ranks of a node are ready for are reported by local rank zero.
+  // With sharded negotiation, every shard coordinator reports its tensors.
+  if ((state.message_table || state.node_request_table) &&
+      state.perform_stall_check &&
+      std::chrono::steady_clock::now() - state.last_stall_check >
+          STALL_WARNING_TIME) {
+    if (state.message_table) {
+      CheckForStalledTensors(*state.message_table, state.tensor_ids,
+                             state.size);
+    }
+    if (state.node_request_table) {
+      CheckForStalledTensors(*state.node_request_table, state.tensor_ids,
+                             state.local_comm_ranks);
     }
+    state.last_stall_check = std::chrono::steady_clock::now();
   }
 
   return !should_shut_down;
-  MPI_Op_free(&state.mpi_float16_sum);
 }
 
 // Start Horovod background thread. Ensure that this is
@@ -1947,6 +4076,7 @@ void horovod_init_comm(MPI_Comm comm) {
 void horovod_shutdown() {
   if (horovod_global.background_thread.joinable()) {
     horovod_global.shut_down = true;
+    horovod_global.cycle_cv.notify_one();
     horovod_global.background_thread.join();
     // Reset the initialization flag to allow restarting with horovod_init(...)
     horovod_global.initialize_flag.clear();
@@ -1970,6 +4100,10 @@ void horovod_shutdown() {
     MPI_Type_free(&horovod_global.mpi_float16_t);
   }
 
+  if (horovod_global.mpi_bfloat16_t != MPI_DATATYPE_NULL) {
+    MPI_Type_free(&horovod_global.mpi_bfloat16_t);
+  }
+
   if (horovod_global.should_finalize) {
 #if HAVE_DDL
     // ddl_finalize calls MPI_Finalize
@@ -2018,6 +4152,60 @@ int horovod_mpi_threads_supported() {
   }
   return horovod_global.mpi_threads_supported ? 1 : 0;
 }
+
+int horovod_gpu_allreduce_built() {
+#if HOROVOD_GPU_ALLREDUCE
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+const char* horovod_collective_algorithm(const char* op, const char* device,
+                                         const char* dtype,
+                                         long long num_bytes) {
+  if (!horovod_global.initialization_done) {
+    return nullptr;
+  }
+  MPIResponse::ResponseType response_type;
+  MPIDataType data_type;
+  if (!ParseResponseType(op, &response_type) ||
+      !ParseDataType(dtype, &data_type) ||
+      (std::strcmp(device, "cpu") != 0 && std::strcmp(device, "gpu") != 0)) {
+    return nullptr;
+  }
+  // The name is copied, since the rules may be replaced once the lock is
+  // released.
+  static thread_local std::string algorithm;
+  std::lock_guard<std::mutex> guard(horovod_global.mutex);
+  algorithm = CurrentAlgorithms(horovod_global)
+                  .Lookup(response_type, std::strcmp(device, "gpu") == 0,
+                          data_type, (int64_t)num_bytes, horovod_global.size);
+  return algorithm.c_str();
+}
+
+const char* horovod_collective_algorithm_rules() {
+  if (!horovod_global.initialization_done) {
+    return nullptr;
+  }
+  static thread_local std::string rules;
+  std::lock_guard<std::mutex> guard(horovod_global.mutex);
+  rules = CurrentAlgorithms(horovod_global).ToString();
+  return rules.c_str();
+}
+
+int horovod_set_collective_algorithm_rules(const char* rules) {
+  if (!horovod_global.initialization_done) {
+    return -1;
+  }
+  std::unique_ptr<AlgorithmRegistry> algorithms(new AlgorithmRegistry());
+  if (!algorithms->Parse(rules).ok()) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> guard(horovod_global.mutex);
+  horovod_global.pending_algorithms = std::move(algorithms);
+  return 1;
+}
 }
 
 // MPI must be initialized and the background thread must be running before
@@ -2027,16 +4215,39 @@ Status EnqueueTensorAllreduce(std::shared_ptr<OpContext> context,
                               std::shared_ptr<Tensor> output,
                               std::shared_ptr<ReadyEvent> ready_event,
                               const std::string name, const int device,
-                              StatusCallback callback) {
+                              StatusCallback callback,
+                              int32_t priority, ReduceOp reduce_op,
+                              double prescale_factor,
+                              double postscale_factor) {
+  if (!ReduceOpSupported(reduce_op, tensor->dtype())) {
+    return Status::InvalidArgument(
+        "Reduction operation " + ReduceOp_Name(reduce_op) +
+        " is not supported for tensors of type " +
+        MPIDataType_Name(tensor->dtype()) + ".");
+  }
+  if (prescale_factor != 1.0 || postscale_factor != 1.0) {
+    if (device != CPU_DEVICE_ID) {
+      return Status::InvalidArgument(
+          "Scaling factors are only supported for tensors in host memory.");
+    }
+    if (tensor->dtype() == HOROVOD_BOOL) {
+      return Status::InvalidArgument(
+          "Scaling factors are not supported for tensors of type " +
+          MPIDataType_Name(tensor->dtype()) + ".");
+    }
+  }
+
   MPIRequest message;
   message.set_request_rank(horovod_global.rank);
-  message.set_tensor_name(name);
   message.set_tensor_type(tensor->dtype());
   message.set_device(device);
   message.set_request_type(MPIRequest::ALLREDUCE);
+  message.set_reduce_op(reduce_op);
   for (int i = 0; i < tensor->shape().dims(); i++) {
     message.add_tensor_shape((int64_t)tensor->shape().dim_size(i));
   }
+  message.set_signature(MPIRequest::ComputeSignature(message));
+  message.set_priority(priority);
 
   TensorTableEntry e;
   e.tensor_name = name;
@@ -2046,17 +4257,23 @@ Status EnqueueTensorAllreduce(std::shared_ptr<OpContext> context,
   e.ready_event = ready_event;
   e.device = device;
   e.callback = callback;
+  e.prescale_factor = prescale_factor;
+  e.postscale_factor = postscale_factor;
 
   std::lock_guard<std::mutex> guard(horovod_global.mutex);
   if (horovod_global.shut_down) {
     return SHUT_DOWN_ERROR;
   }
-  if (horovod_global.tensor_table.find(name) !=
+  auto tensor_id = horovod_global.tensor_ids.Acquire(name);
+  if (horovod_global.tensor_table.find(tensor_id) !=
       horovod_global.tensor_table.end()) {
+    horovod_global.tensor_ids.Release(tensor_id);
     return DUPLICATE_NAME_ERROR;
   }
-  horovod_global.tensor_table.emplace(name, std::move(e));
+  horovod_global.tensor_table.emplace(tensor_id, std::move(e));
+  message.set_tensor_id(tensor_id);
   horovod_global.message_queue.push(message);
+  horovod_global.cycle_cv.notify_one();
   return Status::OK();
 }
 
@@ -2069,13 +4286,13 @@ Status EnqueueTensorAllgather(std::shared_ptr<OpContext> context,
                               StatusCallback callback) {
   MPIRequest message;
   message.set_request_rank(horovod_global.rank);
-  message.set_tensor_name(name);
   message.set_tensor_type(tensor->dtype());
   message.set_device(device);
   message.set_request_type(MPIRequest::ALLGATHER);
   for (int i = 0; i < tensor->shape().dims(); i++) {
     message.add_tensor_shape((int64_t)tensor->shape().dim_size(i));
   }
+  message.set_signature(MPIRequest::ComputeSignature(message));
 
   TensorTableEntry e;
   e.tensor_name = name;
@@ -2089,12 +4306,16 @@ Status EnqueueTensorAllgather(std::shared_ptr<OpContext> context,
   if (horovod_global.shut_down) {
     return SHUT_DOWN_ERROR;
   }
-  if (horovod_global.tensor_table.find(name) !=
+  auto tensor_id = horovod_global.tensor_ids.Acquire(name);
+  if (horovod_global.tensor_table.find(tensor_id) !=
       horovod_global.tensor_table.end()) {
+    horovod_global.tensor_ids.Release(tensor_id);
     return DUPLICATE_NAME_ERROR;
   }
-  horovod_global.tensor_table.emplace(name, std::move(e));
+  horovod_global.tensor_table.emplace(tensor_id, std::move(e));
+  message.set_tensor_id(tensor_id);
   horovod_global.message_queue.push(message);
+  horovod_global.cycle_cv.notify_one();
   return Status::OK();
 }
 
@@ -2108,7 +4329,6 @@ Status EnqueueTensorBroadcast(std::shared_ptr<OpContext> context,
                               StatusCallback callback) {
   MPIRequest message;
   message.set_request_rank(horovod_global.rank);
-  message.set_tensor_name(name);
   message.set_tensor_type(tensor->dtype());
   message.set_root_rank(root_rank);
   message.set_device(device);
@@ -2116,6 +4336,7 @@ Status EnqueueTensorBroadcast(std::shared_ptr<OpContext> context,
   for (int i = 0; i < tensor->shape().dims(); i++) {
     message.add_tensor_shape((int64_t)tensor->shape().dim_size(i));
   }
+  message.set_signature(MPIRequest::ComputeSignature(message));
 
   TensorTableEntry e;
   e.tensor_name = name;
@@ -2131,12 +4352,16 @@ Status EnqueueTensorBroadcast(std::shared_ptr<OpContext> context,
   if (horovod_global.shut_down) {
     return SHUT_DOWN_ERROR;
   }
-  if (horovod_global.tensor_table.find(name) !=
+  auto tensor_id = horovod_global.tensor_ids.Acquire(name);
+  if (horovod_global.tensor_table.find(tensor_id) !=
       horovod_global.tensor_table.end()) {
+    horovod_global.tensor_ids.Release(tensor_id);
     return DUPLICATE_NAME_ERROR;
   }
-  horovod_global.tensor_table.emplace(name, std::move(e));
+  horovod_global.tensor_table.emplace(tensor_id, std::move(e));
+  message.set_tensor_id(tensor_id);
   horovod_global.message_queue.push(message);
+  horovod_global.cycle_cv.notify_one();
   return Status::OK();
 }
 
@@ -36,6 +36,9 @@ namespace common {
 #define MEMCPY_IN_FUSION_BUFFER "MEMCPY_IN_FUSION_BUFFER"
 #define MEMCPY_IN_HOST_BUFFER "MEMCPY_IN_HOST_BUFFER"
 #define MPI_ALLREDUCE "MPI_ALLREDUCE"
+#define MPI_PIPELINED_ALLREDUCE "MPI_PIPELINED_ALLREDUCE"
+#define RING_ALLREDUCE "RING_ALLREDUCE"
+#define RECURSIVE_DOUBLING_ALLREDUCE "RECURSIVE_DOUBLING_ALLREDUCE"
 #define MEMCPY_OUT_HOST_BUFFER "MEMCPY_OUT_HOST_BUFFER"
 #define NCCL_ALLREDUCE "NCCL_ALLREDUCE"
 #define MEMCPY_OUT_FUSION_BUFFER "MEMCPY_OUT_FUSION_BUFFER"
@@ -53,9 +56,31 @@ namespace common {
 #define HOROVOD_MPI_THREADS_DISABLE "HOROVOD_MPI_THREADS_DISABLE"
 #define HOROVOD_TIMELINE "HOROVOD_TIMELINE"
 #define HOROVOD_FUSION_THRESHOLD "HOROVOD_FUSION_THRESHOLD"
+#define HOROVOD_ORDERED_FUSION "HOROVOD_ORDERED_FUSION"
+#define HOROVOD_FUSION_CHUNK_SIZE "HOROVOD_FUSION_CHUNK_SIZE"
+#define HOROVOD_NUM_FUSION_BUFFERS "HOROVOD_NUM_FUSION_BUFFERS"
+#define HOROVOD_MAX_IN_FLIGHT "HOROVOD_MAX_IN_FLIGHT"
+#define HOROVOD_MEMCPY_THREADS "HOROVOD_MEMCPY_THREADS"
+#define HOROVOD_REDUCTION_THREADS "HOROVOD_REDUCTION_THREADS"
+#define HOROVOD_RING_ALLREDUCE "HOROVOD_RING_ALLREDUCE"
+#define HOROVOD_RING_SEGMENT_SIZE "HOROVOD_RING_SEGMENT_SIZE"
+#define HOROVOD_RECURSIVE_DOUBLING_THRESHOLD \
+  "HOROVOD_RECURSIVE_DOUBLING_THRESHOLD"
+#define HOROVOD_ALGORITHMS "HOROVOD_ALGORITHMS"
+#define HOROVOD_ALGORITHMS_FILE "HOROVOD_ALGORITHMS_FILE"
 #define HOROVOD_CYCLE_TIME "HOROVOD_CYCLE_TIME"
+#define HOROVOD_AUTOTUNE "HOROVOD_AUTOTUNE"
+#define HOROVOD_AUTOTUNE_FILE "HOROVOD_AUTOTUNE_FILE"
+#define HOROVOD_AUTOTUNE_WARMUP_SAMPLES "HOROVOD_AUTOTUNE_WARMUP_SAMPLES"
+#define HOROVOD_AUTOTUNE_CYCLES_PER_SAMPLE "HOROVOD_AUTOTUNE_CYCLES_PER_SAMPLE"
+#define HOROVOD_EVENT_DRIVEN_CYCLE "HOROVOD_EVENT_DRIVEN_CYCLE"
+#define HOROVOD_CYCLE_BATCH_TIME "HOROVOD_CYCLE_BATCH_TIME"
 #define HOROVOD_STALL_CHECK_DISABLE "HOROVOD_STALL_CHECK_DISABLE"
 #define HOROVOD_HIERARCHICAL_ALLREDUCE "HOROVOD_HIERARCHICAL_ALLREDUCE"
+#define HOROVOD_HIERARCHICAL_NEGOTIATION "HOROVOD_HIERARCHICAL_NEGOTIATION"
+#define HOROVOD_OVERLAP_NEGOTIATION "HOROVOD_OVERLAP_NEGOTIATION"
+#define HOROVOD_COORDINATOR_SHARDS "HOROVOD_COORDINATOR_SHARDS"
+#define HOROVOD_CACHE_CAPACITY "HOROVOD_CACHE_CAPACITY"
 
 // A callback to call after the MPI communication completes. Since the
 // allreduce and allgather ops are asynchronous, this callback is what resumes
@@ -95,14 +120,48 @@ int horovod_local_size();
 // C interface to return flag indicating whether MPI multi-threading is
 // supported. Returns -1 if Horovod is not initialized.
 int horovod_mpi_threads_supported();
+
+// C interface to return flag indicating whether allreduces of tensors in GPU
+// memory are performed on the GPU, as built with HOROVOD_GPU_ALLREDUCE.
+int horovod_gpu_allreduce_built();
+
+// C interface to get the algorithm that performs a collective operation of the
+// given number of bytes, where op, device and dtype are named as in the rules
+// of HOROVOD_ALGORITHMS. Returns NULL if Horovod is not initialized or a name
+// is unknown.
+const char* horovod_collective_algorithm(const char* op, const char* device,
+                                         const char* dtype,
+                                         long long num_bytes);
+
+// C interface to get the rules of the algorithm registry, one per line.
+// Returns NULL if Horovod is not initialized.
+const char* horovod_collective_algorithm_rules();
+
+// C interface to replace the rules of the algorithm registry, in the format of
+// HOROVOD_ALGORITHMS. All ranks must set the same rules while no collective
+// operations are outstanding; operations enqueued afterwards use them. Returns
+// -1 if Horovod is not initialized, 0 if the rules are invalid and 1
+// otherwise.
+int horovod_set_collective_algorithm_rules(const char* rules);
 }
 
+// Tensors that are ready on all ranks are reduced in order of decreasing
+// priority, so a higher priority can be passed for tensors that are needed
+// first by the next step. All ranks must reduce a tensor with the same
+// reduction operation, which must apply to its data type. Tensors in host
+// memory may be multiplied by a prescale factor before the reduction and by a
+// postscale factor after it, which is applied as the tensor is copied into
+// and out of the fusion buffer. Averaging is a postscale factor of 1 / size.
 Status EnqueueTensorAllreduce(std::shared_ptr<OpContext> context,
                               std::shared_ptr<Tensor> tensor,
                               std::shared_ptr<Tensor> output,
                               std::shared_ptr<ReadyEvent> ready_event,
                               const std::string name, const int device,
-                              StatusCallback callback);
+                              StatusCallback callback,
+                              int32_t priority = 0,
+                              ReduceOp reduce_op = ReduceOp::SUM,
+                              double prescale_factor = 1.0,
+                              double postscale_factor = 1.0);
 
 Status EnqueueTensorAllgather(std::shared_ptr<OpContext> context,
                               std::shared_ptr<Tensor> tensor,
@@ -0,0 +1,919 @@
+// Copyright 2018 Uber Technologies, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+// Vectorized kernels are built with function target attributes rather than
+// compiler flags, so that a single build runs on any x86-64 CPU and picks the
+// kernels of the CPU it runs on.
+#if defined(__x86_64__) && defined(__GNUC__)
+#define HOROVOD_X86_KERNELS 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#include "half.h"
+#include "reduction_kernels.h"
+
+namespace horovod {
+namespace common {
+
+namespace {
+
+#if HOROVOD_X86_KERNELS
+#define HOROVOD_TARGET_AVX __attribute__((target("avx,f16c")))
+#define HOROVOD_TARGET_AVX2 __attribute__((target("avx2,f16c")))
+#define HOROVOD_TARGET_AVX512 __attribute__((target("avx512f,avx2,f16c")))
+#endif
+
+#define NUM_REDUCE_OPS (int(ReduceOp::BXOR) + 1)
+#define NUM_KERNEL_ISAS 4
+#define NUM_DATA_TYPES (HOROVOD_BFLOAT16 + 1)
+
+// Storage types of float16 and bfloat16 elements, so that kernels can be
+// specialized for them.
+struct Float16 {
+  uint16_t bits;
+};
+
+struct BFloat16 {
+  uint16_t bits;
+};
+
+template <ReduceOp op, typename T> struct Scalar {
+  static T Apply(T a, T b) {
+    switch (op) {
+    case ReduceOp::SUM:
+      return a + b;
+    case ReduceOp::MIN:
+      return a < b ? a : b;
+    case ReduceOp::MAX:
+      return a > b ? a : b;
+    default:
+      return a * b;
+    }
+  }
+};
+
+template <ReduceOp op> struct Scalar<op, Float16> {
+  static Float16 Apply(Float16 a, Float16 b) {
+    float a_float, b_float;
+    HalfBits2Float(&a.bits, &a_float);
+    HalfBits2Float(&b.bits, &b_float);
+    float result = Scalar<op, float>::Apply(a_float, b_float);
+    Float16 c;
+    Float2HalfBits(&result, &c.bits);
+    return c;
+  }
+};
+
+template <ReduceOp op> struct Scalar<op, BFloat16> {
+  static BFloat16 Apply(BFloat16 a, BFloat16 b) {
+    float a_float, b_float;
+    BFloat16Bits2Float(&a.bits, &a_float);
+    BFloat16Bits2Float(&b.bits, &b_float);
+    float result = Scalar<op, float>::Apply(a_float, b_float);
+    BFloat16 c;
+    Float2BFloat16Bits(&result, &c.bits);
+    return c;
+  }
+};
+
+template <ReduceOp op, typename T> struct Bitwise {
+  static T Apply(T a, T b) {
+    switch (op) {
+    case ReduceOp::BAND:
+      return a & b;
+    case ReduceOp::BOR:
+      return a | b;
+    default:
+      return a ^ b;
+    }
+  }
+};
+
+// Multiplication of elements by a factor, see ScaleKernel.
+template <typename T> struct Scaled {
+  static T Apply(T a, double factor) { return (T)(a * factor); }
+};
+
+template <> struct Scaled<float> {
+  static float Apply(float a, double factor) { return a * (float)factor; }
+};
+
+template <> struct Scaled<Float16> {
+  static Float16 Apply(Float16 a, double factor) {
+    float a_float;
+    HalfBits2Float(&a.bits, &a_float);
+    float result = Scaled<float>::Apply(a_float, factor);
+    Float16 c;
+    Float2HalfBits(&result, &c.bits);
+    return c;
+  }
+};
+
+template <> struct Scaled<BFloat16> {
+  static BFloat16 Apply(BFloat16 a, double factor) {
+    float a_float;
+    BFloat16Bits2Float(&a.bits, &a_float);
+    float result = Scaled<float>::Apply(a_float, factor);
+    BFloat16 c;
+    Float2BFloat16Bits(&result, &c.bits);
+    return c;
+  }
+};
+
+template <typename T, ReduceOp op>
+void ScalarKernel(void* dst, const void* src, int64_t count) {
+  auto* d = (T*)dst;
+  auto* s = (const T*)src;
+  for (int64_t i = 0; i < count; i++) {
+    d[i] = Scalar<op, T>::Apply(d[i], s[i]);
+  }
+}
+
+template <typename T, ReduceOp op>
+void BitwiseKernel(void* dst, const void* src, int64_t count) {
+  auto* d = (T*)dst;
+  auto* s = (const T*)src;
+  for (int64_t i = 0; i < count; i++) {
+    d[i] = Bitwise<op, T>::Apply(d[i], s[i]);
+  }
+}
+
+template <typename T>
+void ScalarScaleKernel(void* dst, const void* src, int64_t count,
+                       double factor) {
+  auto* d = (T*)dst;
+  auto* s = (const T*)src;
+  for (int64_t i = 0; i < count; i++) {
+    d[i] = Scaled<T>::Apply(s[i], factor);
+  }
+}
+
+#if HOROVOD_X86_KERNELS
+// Summation of float16 elements with AVX and F16C, eight elements at a time,
+// for CPUs without AVX2.
+HOROVOD_TARGET_AVX void AvxFloat16SumKernel(void* dst, const void* src,
+                                            int64_t count) {
+  auto* in = (const Float16*)src;
+  auto* inout = (Float16*)dst;
+  int64_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 in_m256 = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(in + i)));
+    __m256 inout_m256 =
+        _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(inout + i)));
+    __m256 new_inout_m256 = _mm256_add_ps(in_m256, inout_m256);
+    __m128i new_inout_m128i =
+        _mm256_cvtps_ph(new_inout_m256, _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128((__m128i*)(inout + i), new_inout_m128i);
+  }
+  ScalarKernel<Float16, ReduceOp::SUM>(inout + i, in + i, count - i);
+}
+
+// Vector traits of every data type: the element type T, the number of
+// elements per vector, loads and stores of whole vectors, and the reduction
+// of two vectors. Floating point traits also broadcast scaling factors.
+// Integer elements use signed comparisons, and the low 64
+// bits of products of 64-bit integers are built from 32-bit products, which
+// is all AVX2 and AVX-512F offer.
+struct Avx2Float {
+  typedef float T;
+  typedef __m256 V;
+  static const int lanes = 8;
+  HOROVOD_TARGET_AVX2 static V Load(const T* p) { return _mm256_loadu_ps(p); }
+  HOROVOD_TARGET_AVX2 static void Store(T* p, V v) { _mm256_storeu_ps(p, v); }
+  HOROVOD_TARGET_AVX2 static V Broadcast(double f) {
+    return _mm256_set1_ps((float)f);
+  }
+  HOROVOD_TARGET_AVX2 static V Reduce(ReduceOp op, V a, V b) {
+    switch (op) {
+    case ReduceOp::SUM:
+      return _mm256_add_ps(a, b);
+    case ReduceOp::MIN:
+      return _mm256_min_ps(a, b);
+    case ReduceOp::MAX:
+      return _mm256_max_ps(a, b);
+    default:
+      return _mm256_mul_ps(a, b);
+    }
+  }
+};
+
+struct Avx2Float16 : Avx2Float {
+  typedef Float16 T;
+  HOROVOD_TARGET_AVX2 static V Load(const T* p) {
+    return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)p));
+  }
+  HOROVOD_TARGET_AVX2 static void Store(T* p, V v) {
+    _mm_storeu_si128((__m128i*)p,
+                     _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+  }
+};
+
+// bfloat16 elements widen to float32 with a shift, and narrow with rounding
+// to nearest even, keeping NaNs quiet like Float2BFloat16Bits.
+struct Avx2BFloat16 : Avx2Float {
+  typedef BFloat16 T;
+  HOROVOD_TARGET_AVX2 static V Load(const T* p) {
+    __m256i bits = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)p));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(bits, 16));
+  }
+  HOROVOD_TARGET_AVX2 static void Store(T* p, V v) {
+    __m256i bits = _mm256_castps_si256(v);
+    __m256i lsb =
+        _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+    __m256i rounded = _mm256_add_epi32(
+        bits, _mm256_add_epi32(lsb, _mm256_set1_epi32(0x7fff)));
+    __m256i quiet = _mm256_or_si256(bits, _mm256_set1_epi32(0x400000));
+    __m256i nan = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+    bits = _mm256_srli_epi32(_mm256_blendv_epi8(rounded, quiet, nan), 16);
+    // Packing works within 128-bit lanes, which leaves the 16-bit halves of
+    // each lane in the first and third 64-bit elements.
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(bits, bits),
+                                              0x08);
+    _mm_storeu_si128((__m128i*)p, _mm256_castsi256_si128(packed));
+  }
+};
+
+struct Avx2Double {
+  typedef double T;
+  typedef __m256d V;
+  static const int lanes = 4;
+  HOROVOD_TARGET_AVX2 static V Load(const T* p) { return _mm256_loadu_pd(p); }
+  HOROVOD_TARGET_AVX2 static void Store(T* p, V v) { _mm256_storeu_pd(p, v); }
+  HOROVOD_TARGET_AVX2 static V Broadcast(double f) {
+    return _mm256_set1_pd(f);
+  }
+  HOROVOD_TARGET_AVX2 static V Reduce(ReduceOp op, V a, V b) {
+    switch (op) {
+    case ReduceOp::SUM:
+      return _mm256_add_pd(a, b);
+    case ReduceOp::MIN:
+      return _mm256_min_pd(a, b);
+    case ReduceOp::MAX:
+      return _mm256_max_pd(a, b);
+    default:
+      return _mm256_mul_pd(a, b);
+    }
+  }
+};
+
+struct Avx2Int32 {
+  typedef int32_t T;
+  typedef __m256i V;
+  static const int lanes = 8;
+  HOROVOD_TARGET_AVX2 static V Load(const T* p) {
+    return _mm256_loadu_si256((const __m256i*)p);
+  }
+  HOROVOD_TARGET_AVX2 static void Store(T* p, V v) {
+    _mm256_storeu_si256((__m256i*)p, v);
+  }
+  HOROVOD_TARGET_AVX2 static V Reduce(ReduceOp op, V a, V b) {
+    switch (op) {
+    case ReduceOp::SUM:
+      return _mm256_add_epi32(a, b);
+    case ReduceOp::MIN:
+      return _mm256_min_epi32(a, b);
+    case ReduceOp::MAX:
+      return _mm256_max_epi32(a, b);
+    default:
+      return _mm256_mullo_epi32(a, b);
+    }
+  }
+};
+
+struct Avx2Int64 {
+  typedef int64_t T;
+  typedef __m256i V;
+  static const int lanes = 4;
+  HOROVOD_TARGET_AVX2 static V Load(const T* p) {
+    return _mm256_loadu_si256((const __m256i*)p);
+  }
+  HOROVOD_TARGET_AVX2 static void Store(T* p, V v) {
+    _mm256_storeu_si256((__m256i*)p, v);
+  }
+  HOROVOD_TARGET_AVX2 static V Reduce(ReduceOp op, V a, V b) {
+    switch (op) {
+    case ReduceOp::SUM:
+      return _mm256_add_epi64(a, b);
+    case ReduceOp::MIN:
+      return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b));
+    case ReduceOp::MAX:
+      return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b));
+    default: {
+      V cross = _mm256_add_epi64(
+          _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)),
+          _mm256_mul_epu32(_mm256_srli_epi64(a, 32), b));
+      return _mm256_add_epi64(_mm256_mul_epu32(a, b),
+                              _mm256_slli_epi64(cross, 32));
+    }
+    }
+  }
+};
+
+// The AVX-512 traits also load and store the first n < lanes elements of a
+// vector for the tail of the buffers, with masked loads and stores. Unmasked
+// intrinsics of some compilers merge into undefined vectors, which
+// -Wmaybe-uninitialized reports once they are inlined, so operations that
+// have a zero-masking variant use it with every lane set.
+const __mmask16 ALL_LANES_16 = 0xffff;
+const __mmask8 ALL_LANES_8 = 0xff;
+
+struct Avx512Float {
+  typedef float T;
+  typedef __m512 V;
+  static const int lanes = 16;
+  HOROVOD_TARGET_AVX512 static V Load(const T* p) {
+    return _mm512_loadu_ps(p);
+  }
+  HOROVOD_TARGET_AVX512 static void Store(T* p, V v) {
+    _mm512_storeu_ps(p, v);
+  }
+  HOROVOD_TARGET_AVX512 static V LoadTail(const T* p, int n) {
+    return _mm512_maskz_loadu_ps((__mmask16)((1u << n) - 1), p);
+  }
+  HOROVOD_TARGET_AVX512 static void StoreTail(T* p, V v, int n) {
+    _mm512_mask_storeu_ps(p, (__mmask16)((1u << n) - 1), v);
+  }
+  HOROVOD_TARGET_AVX512 static V Broadcast(double f) {
+    return _mm512_set1_ps((float)f);
+  }
+  HOROVOD_TARGET_AVX512 static V Reduce(ReduceOp op, V a, V b) {
+    switch (op) {
+    case ReduceOp::SUM:
+      return _mm512_add_ps(a, b);
+    case ReduceOp::MIN:
+      return _mm512_maskz_min_ps(ALL_LANES_16, a, b);
+    case ReduceOp::MAX:
+      return _mm512_maskz_max_ps(ALL_LANES_16, a, b);
+    default:
+      return _mm512_mul_ps(a, b);
+    }
+  }
+};
+
+// Masked loads and stores of 16-bit elements need AVX-512BW, so the tail of
+// float16 and bfloat16 buffers is loaded and stored as pairs of elements with
+// 32-bit masks. The last element of an odd tail is inserted and extracted on
+// its own, since its pair extends past the end of the buffer.
+template <typename Conversion> struct Avx512Half : Avx512Float {
+  typedef typename Conversion::T T;
+  HOROVOD_TARGET_AVX512 static V Load(const T* p) {
+    return Conversion::Widen(_mm256_loadu_si256((const __m256i*)p));
+  }
+  HOROVOD_TARGET_AVX512 static void Store(T* p, V v) {
+    _mm256_storeu_si256((__m256i*)p, Conversion::Narrow(v));
+  }
+  HOROVOD_TARGET_AVX512 static V LoadTail(const T* p, int n) {
+    __m512i bits =
+        _mm512_maskz_loadu_epi32((__mmask16)((1u << (n / 2)) - 1), p);
+    if (n % 2) {
+      bits = _mm512_mask_set1_epi32(bits, (__mmask16)(1u << (n / 2)),
+                                    p[n - 1].bits);
+    }
+    return Conversion::Widen(
+        _mm512_maskz_extracti64x4_epi64(ALL_LANES_8, bits, 0));
+  }
+  HOROVOD_TARGET_AVX512 static void StoreTail(T* p, V v, int n) {
+    __m256i bits = Conversion::Narrow(v);
+    _mm512_mask_storeu_epi32(p, (__mmask16)((1u << (n / 2)) - 1),
+                             _mm512_castsi256_si512(bits));
+    if (n % 2) {
+      __m256i last =
+          _mm256_permutevar8x32_epi32(bits, _mm256_set1_epi32(n / 2));
+      p[n - 1].bits =
+          (uint16_t)_mm_cvtsi128_si32(_mm256_castsi256_si128(last));
+    }
+  }
+};
+
+struct Avx512Float16Conversion {
+  typedef Float16 T;
+  HOROVOD_TARGET_AVX512 static __m512 Widen(__m256i bits) {
+    return _mm512_maskz_cvtph_ps(ALL_LANES_16, bits);
+  }
+  HOROVOD_TARGET_AVX512 static __m256i Narrow(__m512 v) {
+    return _mm512_maskz_cvtps_ph(ALL_LANES_16, v, _MM_FROUND_TO_NEAREST_INT);
+  }
+};
+
+struct Avx512BFloat16Conversion {
+  typedef BFloat16 T;
+  HOROVOD_TARGET_AVX512 static __m512 Widen(__m256i bits) {
+    return _mm512_castsi512_ps(_mm512_maskz_slli_epi32(
+        ALL_LANES_16, _mm512_maskz_cvtepu16_epi32(ALL_LANES_16, bits), 16));
+  }
+  HOROVOD_TARGET_AVX512 static __m256i Narrow(__m512 v) {
+    __m512i bits = _mm512_castps_si512(v);
+    __m512i lsb =
+        _mm512_and_si512(_mm512_maskz_srli_epi32(ALL_LANES_16, bits, 16),
+                         _mm512_set1_epi32(1));
+    __m512i rounded = _mm512_add_epi32(
+        bits, _mm512_add_epi32(lsb, _mm512_set1_epi32(0x7fff)));
+    __mmask16 nan = _mm512_cmp_ps_mask(v, v, _CMP_UNORD_Q);
+    rounded = _mm512_mask_or_epi32(rounded, nan, bits,
+                                   _mm512_set1_epi32(0x400000));
+    return _mm512_maskz_cvtepi32_epi16(
+        ALL_LANES_16, _mm512_maskz_srli_epi32(ALL_LANES_16, rounded, 16));
+  }
+};
+
+typedef Avx512Half<Avx512Float16Conversion> Avx512Float16;
+typedef Avx512Half<Avx512BFloat16Conversion> Avx512BFloat16;
+
+struct Avx512Double {
+  typedef double T;
+  typedef __m512d V;
+  static const int lanes = 8;
+  HOROVOD_TARGET_AVX512 static V Load(const T* p) {
+    return _mm512_loadu_pd(p);
+  }
+  HOROVOD_TARGET_AVX512 static void Store(T* p, V v) {
+    _mm512_storeu_pd(p, v);
+  }
+  HOROVOD_TARGET_AVX512 static V LoadTail(const T* p, int n) {
+    return _mm512_maskz_loadu_pd((__mmask8)((1u << n) - 1), p);
+  }
+  HOROVOD_TARGET_AVX512 static void StoreTail(T* p, V v, int n) {
+    _mm512_mask_storeu_pd(p, (__mmask8)((1u << n) - 1), v);
+  }
+  HOROVOD_TARGET_AVX512 static V Broadcast(double f) {
+    return _mm512_set1_pd(f);
+  }
+  HOROVOD_TARGET_AVX512 static V Reduce(ReduceOp op, V a, V b) {
+    switch (op) {
+    case ReduceOp::SUM:
+      return _mm512_add_pd(a, b);
+    case ReduceOp::MIN:
+      return _mm512_maskz_min_pd(ALL_LANES_8, a, b);
+    case ReduceOp::MAX:
+      return _mm512_maskz_max_pd(ALL_LANES_8, a, b);
+    default:
+      return _mm512_mul_pd(a, b);
+    }
+  }
+};
+
+struct Avx512Int32 {
+  typedef int32_t T;
+  typedef __m512i V;
+  static const int lanes = 16;
+  HOROVOD_TARGET_AVX512 static V Load(const T* p) {
+    return _mm512_loadu_si512(p);
+  }
+  HOROVOD_TARGET_AVX512 static void Store(T* p, V v) {
+    _mm512_storeu_si512(p, v);
+  }
+  HOROVOD_TARGET_AVX512 static V LoadTail(const T* p, int n) {
+    return _mm512_maskz_loadu_epi32((__mmask16)((1u << n) - 1), p);
+  }
+  HOROVOD_TARGET_AVX512 static void StoreTail(T* p, V v, int n) {
+    _mm512_mask_storeu_epi32(p, (__mmask16)((1u << n) - 1), v);
+  }
+  HOROVOD_TARGET_AVX512 static V Reduce(ReduceOp op, V a, V b) {
+    switch (op) {
+    case ReduceOp::SUM:
+      return _mm512_add_epi32(a, b);
+    case ReduceOp::MIN:
+      return _mm512_maskz_min_epi32(ALL_LANES_16, a, b);
+    case ReduceOp::MAX:
+      return _mm512_maskz_max_epi32(ALL_LANES_16, a, b);
+    default:
+      return _mm512_mullo_epi32(a, b);
+    }
+  }
+};
+
+struct Avx512Int64 {
+  typedef int64_t T;
+  typedef __m512i V;
+  static const int lanes = 8;
+  HOROVOD_TARGET_AVX512 static V Load(const T* p) {
+    return _mm512_loadu_si512(p);
+  }
+  HOROVOD_TARGET_AVX512 static void Store(T* p, V v) {
+    _mm512_storeu_si512(p, v);
+  }
+  HOROVOD_TARGET_AVX512 static V LoadTail(const T* p, int n) {
+    return _mm512_maskz_loadu_epi64((__mmask8)((1u << n) - 1), p);
+  }
+  HOROVOD_TARGET_AVX512 static void StoreTail(T* p, V v, int n) {
+    _mm512_mask_storeu_epi64(p, (__mmask8)((1u << n) - 1), v);
+  }
+  HOROVOD_TARGET_AVX512 static V Reduce(ReduceOp op, V a, V b) {
+    switch (op) {
+    case ReduceOp::SUM:
+      return _mm512_add_epi64(a, b);
+    case ReduceOp::MIN:
+      return _mm512_maskz_min_epi64(ALL_LANES_8, a, b);
+    case ReduceOp::MAX:
+      return _mm512_maskz_max_epi64(ALL_LANES_8, a, b);
+    default: {
+      V a_high = _mm512_maskz_srli_epi64(ALL_LANES_8, a, 32);
+      V b_high = _mm512_maskz_srli_epi64(ALL_LANES_8, b, 32);
+      V cross =
+          _mm512_add_epi64(_mm512_maskz_mul_epu32(ALL_LANES_8, a, b_high),
+                           _mm512_maskz_mul_epu32(ALL_LANES_8, a_high, b));
+      return _mm512_add_epi64(_mm512_maskz_mul_epu32(ALL_LANES_8, a, b),
+                              _mm512_maskz_slli_epi64(ALL_LANES_8, cross, 32));
+    }
+    }
+  }
+};
+
+// Both kernels reduce four vectors per iteration, so that the loads and
+// reductions of independent vectors overlap. The AVX2 kernels reduce the
+// tail with the scalar kernel, and the AVX-512 kernels with one masked
+// vector.
+template <typename Traits, ReduceOp op>
+HOROVOD_TARGET_AVX2 void Avx2Kernel(void* dst, const void* src,
+                                    int64_t count) {
+  typedef typename Traits::T T;
+  const int lanes = Traits::lanes;
+  auto* d = (T*)dst;
+  auto* s = (const T*)src;
+  int64_t i = 0;
+  for (; i + 4 * lanes <= count; i += 4 * lanes) {
+    auto v0 = Traits::Reduce(op, Traits::Load(d + i), Traits::Load(s + i));
+    auto v1 = Traits::Reduce(op, Traits::Load(d + i + lanes),
+                             Traits::Load(s + i + lanes));
+    auto v2 = Traits::Reduce(op, Traits::Load(d + i + 2 * lanes),
+                             Traits::Load(s + i + 2 * lanes));
+    auto v3 = Traits::Reduce(op, Traits::Load(d + i + 3 * lanes),
+                             Traits::Load(s + i + 3 * lanes));
+    Traits::Store(d + i, v0);
+    Traits::Store(d + i + lanes, v1);
+    Traits::Store(d + i + 2 * lanes, v2);
+    Traits::Store(d + i + 3 * lanes, v3);
+  }
+  for (; i + lanes <= count; i += lanes) {
+    Traits::Store(d + i, Traits::Reduce(op, Traits::Load(d + i),
+                                        Traits::Load(s + i)));
+  }
+  ScalarKernel<T, op>(d + i, s + i, count - i);
+}
+
+template <typename Traits, ReduceOp op>
+HOROVOD_TARGET_AVX512 void Avx512Kernel(void* dst, const void* src,
+                                        int64_t count) {
+  typedef typename Traits::T T;
+  const int lanes = Traits::lanes;
+  auto* d = (T*)dst;
+  auto* s = (const T*)src;
+  int64_t i = 0;
+  for (; i + 4 * lanes <= count; i += 4 * lanes) {
+    auto v0 = Traits::Reduce(op, Traits::Load(d + i), Traits::Load(s + i));
+    auto v1 = Traits::Reduce(op, Traits::Load(d + i + lanes),
+                             Traits::Load(s + i + lanes));
+    auto v2 = Traits::Reduce(op, Traits::Load(d + i + 2 * lanes),
+                             Traits::Load(s + i + 2 * lanes));
+    auto v3 = Traits::Reduce(op, Traits::Load(d + i + 3 * lanes),
+                             Traits::Load(s + i + 3 * lanes));
+    Traits::Store(d + i, v0);
+    Traits::Store(d + i + lanes, v1);
+    Traits::Store(d + i + 2 * lanes, v2);
+    Traits::Store(d + i + 3 * lanes, v3);
+  }
+  for (; i + lanes <= count; i += lanes) {
+    Traits::Store(d + i, Traits::Reduce(op, Traits::Load(d + i),
+                                        Traits::Load(s + i)));
+  }
+  if (i < count) {
+    int n = (int)(count - i);
+    Traits::StoreTail(d + i,
+                      Traits::Reduce(op, Traits::LoadTail(d + i, n),
+                                     Traits::LoadTail(s + i, n)),
+                      n);
+  }
+}
+
+// Scaling kernels multiply by a broadcast factor in the same way.
+template <typename Traits>
+HOROVOD_TARGET_AVX2 void Avx2ScaleKernel(void* dst, const void* src,
+                                         int64_t count, double factor) {
+  typedef typename Traits::T T;
+  const int lanes = Traits::lanes;
+  const auto op = ReduceOp::PRODUCT;
+  auto* d = (T*)dst;
+  auto* s = (const T*)src;
+  auto f = Traits::Broadcast(factor);
+  int64_t i = 0;
+  for (; i + 4 * lanes <= count; i += 4 * lanes) {
+    auto v0 = Traits::Reduce(op, Traits::Load(s + i), f);
+    auto v1 = Traits::Reduce(op, Traits::Load(s + i + lanes), f);
+    auto v2 = Traits::Reduce(op, Traits::Load(s + i + 2 * lanes), f);
+    auto v3 = Traits::Reduce(op, Traits::Load(s + i + 3 * lanes), f);
+    Traits::Store(d + i, v0);
+    Traits::Store(d + i + lanes, v1);
+    Traits::Store(d + i + 2 * lanes, v2);
+    Traits::Store(d + i + 3 * lanes, v3);
+  }
+  for (; i + lanes <= count; i += lanes) {
+    Traits::Store(d + i, Traits::Reduce(op, Traits::Load(s + i), f));
+  }
+  ScalarScaleKernel<T>(d + i, s + i, count - i, factor);
+}
+
+template <typename Traits>
+HOROVOD_TARGET_AVX512 void Avx512ScaleKernel(void* dst, const void* src,
+                                             int64_t count, double factor) {
+  typedef typename Traits::T T;
+  const int lanes = Traits::lanes;
+  const auto op = ReduceOp::PRODUCT;
+  auto* d = (T*)dst;
+  auto* s = (const T*)src;
+  auto f = Traits::Broadcast(factor);
+  int64_t i = 0;
+  for (; i + 4 * lanes <= count; i += 4 * lanes) {
+    auto v0 = Traits::Reduce(op, Traits::Load(s + i), f);
+    auto v1 = Traits::Reduce(op, Traits::Load(s + i + lanes), f);
+    auto v2 = Traits::Reduce(op, Traits::Load(s + i + 2 * lanes), f);
+    auto v3 = Traits::Reduce(op, Traits::Load(s + i + 3 * lanes), f);
+    Traits::Store(d + i, v0);
+    Traits::Store(d + i + lanes, v1);
+    Traits::Store(d + i + 2 * lanes, v2);
+    Traits::Store(d + i + 3 * lanes, v3);
+  }
+  for (; i + lanes <= count; i += lanes) {
+    Traits::Store(d + i, Traits::Reduce(op, Traits::Load(s + i), f));
+  }
+  if (i < count) {
+    int n = (int)(count - i);
+    Traits::StoreTail(d + i, Traits::Reduce(op, Traits::LoadTail(s + i, n), f),
+                      n);
+  }
+}
+
+KernelIsa DetectKernelIsa() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_OSXSAVE) ||
+      !(ecx & bit_AVX) || !(ecx & bit_F16C)) {
+    return KernelIsa::SCALAR;
+  }
+
+  // The operating system must save the YMM and ZMM registers on context
+  // switches.
+  unsigned int xcr0_low, xcr0_high;
+  __asm__("xgetbv" : "=a"(xcr0_low), "=d"(xcr0_high) : "c"(0));
+  if ((xcr0_low & 0x6) != 0x6) {
+    return KernelIsa::SCALAR;
+  }
+  if (__get_cpuid_max(0, nullptr) < 7) {
+    return KernelIsa::AVX;
+  }
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  if ((ebx & bit_AVX512F) && (xcr0_low & 0xe6) == 0xe6) {
+    return KernelIsa::AVX512;
+  }
+  return (ebx & bit_AVX2) ? KernelIsa::AVX2 : KernelIsa::AVX;
+}
+#endif
+
+template <ReduceOp op>
+ReductionKernel MakeKernel(MPIDataType dtype, KernelIsa isa) {
+#if HOROVOD_X86_KERNELS
+  if (isa == KernelIsa::AVX512) {
+    switch (dtype) {
+    case HOROVOD_INT32:
+      return Avx512Kernel<Avx512Int32, op>;
+    case HOROVOD_INT64:
+      return Avx512Kernel<Avx512Int64, op>;
+    case HOROVOD_FLOAT16:
+      return Avx512Kernel<Avx512Float16, op>;
+    case HOROVOD_BFLOAT16:
+      return Avx512Kernel<Avx512BFloat16, op>;
+    case HOROVOD_FLOAT32:
+      return Avx512Kernel<Avx512Float, op>;
+    case HOROVOD_FLOAT64:
+      return Avx512Kernel<Avx512Double, op>;
+    default:
+      break;
+    }
+  }
+  if (isa >= KernelIsa::AVX2) {
+    switch (dtype) {
+    case HOROVOD_INT32:
+      return Avx2Kernel<Avx2Int32, op>;
+    case HOROVOD_INT64:
+      return Avx2Kernel<Avx2Int64, op>;
+    case HOROVOD_FLOAT16:
+      return Avx2Kernel<Avx2Float16, op>;
+    case HOROVOD_BFLOAT16:
+      return Avx2Kernel<Avx2BFloat16, op>;
+    case HOROVOD_FLOAT32:
+      return Avx2Kernel<Avx2Float, op>;
+    case HOROVOD_FLOAT64:
+      return Avx2Kernel<Avx2Double, op>;
+    default:
+      break;
+    }
+  }
+  if (isa == KernelIsa::AVX && op == ReduceOp::SUM &&
+      dtype == HOROVOD_FLOAT16) {
+    return AvxFloat16SumKernel;
+  }
+#endif
+  switch (dtype) {
+  case HOROVOD_UINT8:
+    return ScalarKernel<uint8_t, op>;
+  case HOROVOD_INT8:
+    return ScalarKernel<int8_t, op>;
+  case HOROVOD_UINT16:
+    return ScalarKernel<uint16_t, op>;
+  case HOROVOD_INT16:
+    return ScalarKernel<int16_t, op>;
+  case HOROVOD_INT32:
+    return ScalarKernel<int32_t, op>;
+  case HOROVOD_INT64:
+    return ScalarKernel<int64_t, op>;
+  case HOROVOD_FLOAT16:
+    return ScalarKernel<Float16, op>;
+  case HOROVOD_BFLOAT16:
+    return ScalarKernel<BFloat16, op>;
+  case HOROVOD_FLOAT32:
+    return ScalarKernel<float, op>;
+  case HOROVOD_FLOAT64:
+    return ScalarKernel<double, op>;
+  default:
+    return nullptr;
+  }
+}
+
+// Bitwise operations are only defined on integers, and are logical operations
+// on booleans, which hold 0 or 1. The compiler vectorizes these loops well
+// enough for any instruction set.
+template <ReduceOp op> ReductionKernel MakeBitwiseKernel(MPIDataType dtype) {
+  switch (dtype) {
+  case HOROVOD_UINT8:
+  case HOROVOD_INT8:
+  case HOROVOD_BOOL:
+    return BitwiseKernel<uint8_t, op>;
+  case HOROVOD_UINT16:
+  case HOROVOD_INT16:
+    return BitwiseKernel<uint16_t, op>;
+  case HOROVOD_INT32:
+    return BitwiseKernel<uint32_t, op>;
+  case HOROVOD_INT64:
+    return BitwiseKernel<uint64_t, op>;
+  default:
+    return nullptr;
+  }
+}
+
+// Integer elements are scaled with the scalar kernels, since AVX2 has no
+// conversions between 64-bit integers and doubles.
+ScaleKernel MakeScaleKernel(MPIDataType dtype, KernelIsa isa) {
+#if HOROVOD_X86_KERNELS
+  if (isa == KernelIsa::AVX512) {
+    switch (dtype) {
+    case HOROVOD_FLOAT16:
+      return Avx512ScaleKernel<Avx512Float16>;
+    case HOROVOD_BFLOAT16:
+      return Avx512ScaleKernel<Avx512BFloat16>;
+    case HOROVOD_FLOAT32:
+      return Avx512ScaleKernel<Avx512Float>;
+    case HOROVOD_FLOAT64:
+      return Avx512ScaleKernel<Avx512Double>;
+    default:
+      break;
+    }
+  }
+  if (isa >= KernelIsa::AVX2) {
+    switch (dtype) {
+    case HOROVOD_FLOAT16:
+      return Avx2ScaleKernel<Avx2Float16>;
+    case HOROVOD_BFLOAT16:
+      return Avx2ScaleKernel<Avx2BFloat16>;
+    case HOROVOD_FLOAT32:
+      return Avx2ScaleKernel<Avx2Float>;
+    case HOROVOD_FLOAT64:
+      return Avx2ScaleKernel<Avx2Double>;
+    default:
+      break;
+    }
+  }
+#endif
+  switch (dtype) {
+  case HOROVOD_UINT8:
+    return ScalarScaleKernel<uint8_t>;
+  case HOROVOD_INT8:
+    return ScalarScaleKernel<int8_t>;
+  case HOROVOD_UINT16:
+    return ScalarScaleKernel<uint16_t>;
+  case HOROVOD_INT16:
+    return ScalarScaleKernel<int16_t>;
+  case HOROVOD_INT32:
+    return ScalarScaleKernel<int32_t>;
+  case HOROVOD_INT64:
+    return ScalarScaleKernel<int64_t>;
+  case HOROVOD_FLOAT16:
+    return ScalarScaleKernel<Float16>;
+  case HOROVOD_BFLOAT16:
+    return ScalarScaleKernel<BFloat16>;
+  case HOROVOD_FLOAT32:
+    return ScalarScaleKernel<float>;
+  case HOROVOD_FLOAT64:
+    return ScalarScaleKernel<double>;
+  default:
+    return nullptr;
+  }
+}
+
+// Kernels of every operation, data type and instruction set, built once.
+struct KernelTable {
+  KernelTable() {
+    for (int dtype = 0; dtype < NUM_DATA_TYPES; dtype++) {
+      for (int isa = 0; isa < NUM_KERNEL_ISAS; isa++) {
+        auto t = (MPIDataType)dtype;
+        auto i = (KernelIsa)isa;
+        scale_kernels[dtype][isa] = MakeScaleKernel(t, i);
+        kernels[(int)ReduceOp::SUM][dtype][isa] =
+            MakeKernel<ReduceOp::SUM>(t, i);
+        kernels[(int)ReduceOp::MIN][dtype][isa] =
+            MakeKernel<ReduceOp::MIN>(t, i);
+        kernels[(int)ReduceOp::MAX][dtype][isa] =
+            MakeKernel<ReduceOp::MAX>(t, i);
+        kernels[(int)ReduceOp::PRODUCT][dtype][isa] =
+            MakeKernel<ReduceOp::PRODUCT>(t, i);
+        kernels[(int)ReduceOp::BAND][dtype][isa] =
+            MakeBitwiseKernel<ReduceOp::BAND>(t);
+        kernels[(int)ReduceOp::BOR][dtype][isa] =
+            MakeBitwiseKernel<ReduceOp::BOR>(t);
+        kernels[(int)ReduceOp::BXOR][dtype][isa] =
+            MakeBitwiseKernel<ReduceOp::BXOR>(t);
+      }
+    }
+  }
+
+  ReductionKernel kernels[NUM_REDUCE_OPS][NUM_DATA_TYPES][NUM_KERNEL_ISAS];
+  ScaleKernel scale_kernels[NUM_DATA_TYPES][NUM_KERNEL_ISAS];
+};
+
+const KernelTable& Kernels() {
+  static const KernelTable table;
+  return table;
+}
+
+} // namespace
+
+const char* KernelIsa_Name(KernelIsa isa) {
+  switch (isa) {
+  case KernelIsa::SCALAR:
+    return "scalar";
+  case KernelIsa::AVX:
+    return "avx";
+  case KernelIsa::AVX2:
+    return "avx2";
+  case KernelIsa::AVX512:
+    return "avx512";
+  default:
+    return "<unknown>";
+  }
+}
+
+KernelIsa SupportedKernelIsa() {
+#if HOROVOD_X86_KERNELS
+  static const KernelIsa isa = DetectKernelIsa();
+  return isa;
+#else
+  return KernelIsa::SCALAR;
+#endif
+}
+
+ReductionKernel GetReductionKernel(ReduceOp op, MPIDataType dtype) {
+  return GetReductionKernel(op, dtype, SupportedKernelIsa());
+}
+
+ReductionKernel GetReductionKernel(ReduceOp op, MPIDataType dtype,
+                                   KernelIsa isa) {
+  if (isa > SupportedKernelIsa() || dtype < 0 || dtype >= NUM_DATA_TYPES ||
+      (int)op < 0 || (int)op >= NUM_REDUCE_OPS) {
+    return nullptr;
+  }
+  return Kernels().kernels[(int)op][dtype][(int)isa];
+}
+
+ScaleKernel GetScaleKernel(MPIDataType dtype) {
+  return GetScaleKernel(dtype, SupportedKernelIsa());
+}
+
+ScaleKernel GetScaleKernel(MPIDataType dtype, KernelIsa isa) {
+  if (isa > SupportedKernelIsa() || dtype < 0 || dtype >= NUM_DATA_TYPES) {
+    return nullptr;
+  }
+  return Kernels().scale_kernels[dtype][(int)isa];
+}
+
+} // namespace common
+} // namespace horovod
@@ -0,0 +1,71 @@
+// Copyright 2018 Uber Technologies, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#ifndef HOROVOD_REDUCTION_KERNELS_H
+#define HOROVOD_REDUCTION_KERNELS_H
+
+#include <cstdint>
+
+#include "mpi_message.h"
+
+namespace horovod {
+namespace common {
+
+// Instruction sets that kernels are built for, from the least to the most
+// capable. AVX and AVX2 kernels also use F16C to convert float16 elements.
+// CPUs with AVX but without AVX2 only get a vectorized float16 summation.
+enum class KernelIsa { SCALAR = 0, AVX = 1, AVX2 = 2, AVX512 = 3 };
+
+const char* KernelIsa_Name(KernelIsa isa);
+
+// Reduces count elements of src into dst, such that dst[i] becomes
+// op(dst[i], src[i]). Elements of float16 and bfloat16 tensors are reduced in
+// float32 and rounded back.
+typedef void (*ReductionKernel)(void* dst, const void* src, int64_t count);
+
+// Writes count elements of src multiplied by factor to dst, which may be src.
+// Elements of float16, bfloat16 and float32 tensors are multiplied in float32,
+// and others in double precision, rounding integers toward zero.
+typedef void (*ScaleKernel)(void* dst, const void* src, int64_t count,
+                            double factor);
+
+// Most capable instruction set that both the CPU and the operating system
+// support, as queried once through CPUID.
+KernelIsa SupportedKernelIsa();
+
+// Returns the kernel that reduces elements of the data type with op, built
+// for the most capable instruction set of the CPU. Returns nullptr if the
+// operation does not apply to the data type, see ReduceOpSupported. Kernels
+// are chosen once, on first use.
+ReductionKernel GetReductionKernel(ReduceOp op, MPIDataType dtype);
+
+// Returns the kernel built for the instruction set, or nullptr if the CPU
+// does not support it. Data types without a vectorized kernel for the
+// instruction set get the scalar kernel.
+ReductionKernel GetReductionKernel(ReduceOp op, MPIDataType dtype,
+                                   KernelIsa isa);
+
+// Returns the kernel that scales elements of the data type, built for the
+// most capable instruction set of the CPU, or nullptr for boolean tensors.
+ScaleKernel GetScaleKernel(MPIDataType dtype);
+
+// Returns the scaling kernel built for the instruction set, or nullptr if the
+// CPU does not support it.
+ScaleKernel GetScaleKernel(MPIDataType dtype, KernelIsa isa);
+
+} // namespace common
+} // namespace horovod
+
+#endif // HOROVOD_REDUCTION_KERNELS_H
@@ -0,0 +1,138 @@
+// Copyright 2018 Uber Technologies, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+// Micro-benchmark of the reduction kernels. It is not part of the Horovod
+// library, and is built from the repository root with:
+//
+//   mpicxx -std=c++11 -O2 -pthread -I. -o reduction_kernels_benchmark
+//       horovod/common/reduction_kernels_benchmark.cc
+//       horovod/common/reduction_kernels.cc
+//       horovod/common/reduction_pool.cc
+//
+// Usage: reduction_kernels_benchmark [buffer bytes] [iterations] [threads]
+//
+// For every operation, data type and instruction set that the CPU supports,
+// it reports the memory traffic of the kernel in GB/s: every element of both
+// buffers is read and every element of the destination buffer is written.
+// The scaling kernels are reported as the "scale" operation, which reads the
+// source buffer and writes the destination buffer. It then reports the
+// traffic of the float16 and bfloat16 summations of the MPI operations, split
+// across reduction pools of 1 to the given number of threads.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "reduction_kernels.h"
+#include "reduction_pool.h"
+
+using namespace horovod::common;
+
+namespace {
+
+// Returns the memory traffic in GB/s of iterations of the reduction, which
+// reads or writes the given number of buffers of the given size.
+template <typename Reduce>
+double Measure(Reduce reduce, int64_t bytes, int iterations,
+               int buffers = 3) {
+  // Warm up the caches before timing.
+  reduce();
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    reduce();
+  }
+  double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+  return (double)buffers * bytes * iterations / seconds / 1e9;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  int64_t buffer_bytes = argc > 1 ? std::atoll(argv[1]) : 4 * 1024 * 1024;
+  int iterations = argc > 2 ? std::atoi(argv[2]) : 100;
+  int max_threads = argc > 3 ? std::atoi(argv[3]) : 4;
+
+  struct {
+    MPIDataType dtype;
+    const char* name;
+    int element_size;
+  } dtypes[] = {{HOROVOD_FLOAT16, "float16", 2},
+                {HOROVOD_BFLOAT16, "bfloat16", 2},
+                {HOROVOD_FLOAT32, "float32", 4},
+                {HOROVOD_FLOAT64, "float64", 8},
+                {HOROVOD_INT32, "int32", 4},
+                {HOROVOD_INT64, "int64", 8}};
+  struct {
+    ReduceOp op;
+    const char* name;
+  } ops[] = {{ReduceOp::SUM, "sum"},   {ReduceOp::MIN, "min"},
+             {ReduceOp::MAX, "max"},   {ReduceOp::PRODUCT, "product"},
+             {ReduceOp::BAND, "band"}, {ReduceOp::BOR, "bor"},
+             {ReduceOp::BXOR, "bxor"}};
+
+  // Zeroed buffers keep every operation away from overflows and denormals.
+  std::vector<uint8_t> dst((size_t)buffer_bytes), src((size_t)buffer_bytes);
+
+  std::printf("%-8s %-9s %-7s %10s\n", "op", "dtype", "isa", "GB/s");
+  for (auto& op : ops) {
+    for (auto& dtype : dtypes) {
+      int64_t count = buffer_bytes / dtype.element_size;
+      for (int isa = 0; isa <= (int)SupportedKernelIsa(); isa++) {
+        auto kernel = GetReductionKernel(op.op, dtype.dtype, (KernelIsa)isa);
+        if (kernel == nullptr) {
+          continue;
+        }
+        double gbps =
+            Measure([&]() { kernel(dst.data(), src.data(), count); },
+                    count * dtype.element_size, iterations);
+        std::printf("%-8s %-9s %-7s %10.2f\n", op.name, dtype.name,
+                    KernelIsa_Name((KernelIsa)isa), gbps);
+      }
+    }
+  }
+  for (auto& dtype : dtypes) {
+    int64_t count = buffer_bytes / dtype.element_size;
+    for (int isa = 0; isa <= (int)SupportedKernelIsa(); isa++) {
+      auto kernel = GetScaleKernel(dtype.dtype, (KernelIsa)isa);
+      double gbps =
+          Measure([&]() { kernel(dst.data(), src.data(), count, 0.5); },
+                  count * dtype.element_size, iterations, 2);
+      std::printf("%-8s %-9s %-7s %10.2f\n", "scale", dtype.name,
+                  KernelIsa_Name((KernelIsa)isa), gbps);
+    }
+  }
+
+  std::printf("\n%-8s %-9s %-7s %10s\n", "op", "dtype", "threads", "GB/s");
+  for (auto& dtype : dtypes) {
+    if (dtype.element_size != 2) {
+      continue;
+    }
+    int64_t count = buffer_bytes / 2;
+    auto kernel = GetReductionKernel(ReduceOp::SUM, dtype.dtype);
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+      ReductionPool pool;
+      pool.Initialize(threads);
+      double gbps = Measure(
+          [&]() { pool.Reduce(kernel, dst.data(), src.data(), count, 2); },
+          count * 2, iterations);
+      std::printf("%-8s %-9s %-7d %10.2f\n", "sum", dtype.name, threads,
+                  gbps);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,131 @@
+// Copyright 2018 Uber Technologies, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include <algorithm>
+
+#include "reduction_pool.h"
+
+namespace horovod {
+namespace common {
+
+ReductionPool::~ReductionPool() { Shutdown(); }
+
+void ReductionPool::Initialize(int num_threads) {
+  Shutdown();
+  shut_down_ = false;
+  generation_ = 0;
+  range_starts_.assign((size_t)std::max(num_threads, 1) + 1, 0);
+  for (size_t i = 1; i < (size_t)num_threads; i++) {
+    threads_.emplace_back(&ReductionPool::WorkerLoop, this, i);
+  }
+}
+
+void ReductionPool::Shutdown() {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    shut_down_ = true;
+  }
+  start_cv_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+}
+
+void ReductionPool::Reduce(ReductionKernel kernel, void* dst, const void* src,
+                           int64_t count, int element_size) {
+  std::unique_lock<std::mutex> busy(busy_mutex_, std::try_to_lock);
+  if (!busy.owns_lock() || threads_.empty() ||
+      count * element_size < PARALLEL_REDUCTION_MIN_SIZE) {
+    kernel(dst, src, count);
+    return;
+  }
+
+  // Split the elements into ranges aligned to cache lines.
+  size_t num_ranges = threads_.size() + 1;
+  int64_t line_elements = std::max(64 / element_size, 1);
+  int64_t range_count =
+      (count / (int64_t)num_ranges + line_elements - 1) / line_elements *
+      line_elements;
+  for (size_t i = 0; i < num_ranges; i++) {
+    range_starts_[i] = std::min((int64_t)i * range_count, count);
+  }
+  range_starts_[num_ranges] = count;
+
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    kernel_ = kernel;
+    dst_ = (uint8_t*)dst;
+    src_ = (const uint8_t*)src;
+    element_size_ = element_size;
+    pending_ = threads_.size();
+    generation_++;
+  }
+  start_cv_.notify_all();
+
+  kernel(dst, src, range_starts_[1]);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [this]() { return pending_ == 0; });
+  kernel_ = nullptr;
+}
+
+void ReductionPool::WorkerLoop(size_t index) {
+  uint64_t generation = 0;
+  while (true) {
+    ReductionKernel kernel;
+    uint8_t* dst;
+    const uint8_t* src;
+    int element_size;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_cv_.wait(lock, [this, generation]() {
+        return generation_ != generation || shut_down_;
+      });
+      if (shut_down_) {
+        return;
+      }
+      generation = generation_;
+      kernel = kernel_;
+      dst = dst_;
+      src = src_;
+      element_size = element_size_;
+    }
+
+    int64_t begin = range_starts_[index];
+    int64_t end = range_starts_[index + 1];
+    if (begin < end) {
+      kernel(dst + begin * element_size, src + begin * element_size,
+             end - begin);
+    }
+
+    bool done;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      done = --pending_ == 0;
+    }
+    if (done) {
+      done_cv_.notify_one();
+    }
+  }
+}
+
+ReductionPool& GlobalReductionPool() {
+  static ReductionPool pool;
+  return pool;
+}
+
+} // namespace common
+} // namespace horovod
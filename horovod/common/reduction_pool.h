@@ -0,0 +1,86 @@
+// Copyright 2018 Uber Technologies, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#ifndef HOROVOD_REDUCTION_POOL_H
+#define HOROVOD_REDUCTION_POOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "reduction_kernels.h"
+
+namespace horovod {
+namespace common {
+
+// Reductions of fewer bytes than this are not split across threads.
+#define PARALLEL_REDUCTION_MIN_SIZE (1024 * 1024)
+
+// Pool of helper threads that reduce large buffers in host memory. A
+// reduction is split into contiguous ranges of elements, one per thread, and
+// the calling thread reduces the first range itself.
+//
+// MPI calls custom reduction operations from whichever thread drives its
+// progress, so the pool is shared by the whole process and is separate from
+// the pool that copies tensors into and out of the fusion buffer.
+class ReductionPool {
+public:
+  ~ReductionPool();
+
+  // Starts num_threads - 1 helper threads. With a single thread all
+  // reductions are done by the calling thread.
+  void Initialize(int num_threads);
+  void Shutdown();
+
+  // Reduces count elements of src into dst with the kernel, and returns once
+  // done. While the pool is busy with a reduction of another thread, the
+  // calling thread reduces alone.
+  void Reduce(ReductionKernel kernel, void* dst, const void* src,
+              int64_t count, int element_size);
+
+private:
+  void WorkerLoop(size_t index);
+
+  std::vector<std::thread> threads_;
+
+  // Held by the thread whose reduction the pool performs.
+  std::mutex busy_mutex_;
+
+  std::mutex mutex_;
+  std::condition_variable start_cv_;
+  std::condition_variable done_cv_;
+
+  // The reduction being performed, the element ranges of the threads, and a
+  // counter that tells the helper threads that a new reduction started.
+  ReductionKernel kernel_ = nullptr;
+  uint8_t* dst_ = nullptr;
+  const uint8_t* src_ = nullptr;
+  int element_size_ = 0;
+  std::vector<int64_t> range_starts_;
+  uint64_t generation_ = 0;
+  size_t pending_ = 0;
+  bool shut_down_ = false;
+};
+
+// The pool used by the custom MPI reduction operations and the built-in
+// allreduce algorithms.
+ReductionPool& GlobalReductionPool();
+
+} // namespace common
+} // namespace horovod
+
+#endif // HOROVOD_REDUCTION_POOL_H
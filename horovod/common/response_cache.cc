@@ -0,0 +1,134 @@
+// Copyright 2018 Uber Technologies, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include <cassert>
+
+#include "response_cache.h"
+
+namespace horovod {
+namespace common {
+
+void ResponseCache::clear() {
+  entries_.clear();
+  lru_.clear();
+  tensor_id_to_bit_.clear();
+}
+
+void ResponseCache::set_capacity(uint32_t capacity) {
+  clear();
+  capacity_ = capacity;
+}
+
+uint32_t ResponseCache::capacity() const { return capacity_; }
+
+size_t ResponseCache::num_active_bits() const { return lru_.size(); }
+
+ResponseCache::CacheState
+ResponseCache::cached(const MPIRequest& request) const {
+  auto it = tensor_id_to_bit_.find(request.tensor_id());
+  if (it == tensor_id_to_bit_.end()) {
+    return CacheState::MISS;
+  }
+
+  auto& cached_request = entries_[it->second].request;
+  if (request.request_type() == cached_request.request_type() &&
+      request.tensor_type() == cached_request.tensor_type() &&
+      request.tensor_shape() == cached_request.tensor_shape() &&
+      request.root_rank() == cached_request.root_rank() &&
+      request.device() == cached_request.device() &&
+      request.priority() == cached_request.priority() &&
+      request.reduce_op() == cached_request.reduce_op()) {
+    return CacheState::HIT;
+  }
+  return CacheState::INVALID;
+}
+
+void ResponseCache::put(const MPIResponse& response,
+                        const MPIRequest& request) {
+  assert(response.tensor_ids().size() == 1);
+  if (capacity_ == 0) {
+    return;
+  }
+
+  auto tensor_id = response.tensor_ids()[0];
+  auto it = tensor_id_to_bit_.find(tensor_id);
+  if (it != tensor_id_to_bit_.end()) {
+    erase_response(it->second);
+  }
+
+  // Reuse the lowest free cache bit, or evict the least recently used entry
+  // if the cache is full.
+  uint32_t cache_bit = 0;
+  while (cache_bit < entries_.size() && entries_[cache_bit].active) {
+    cache_bit++;
+  }
+  if (cache_bit == entries_.size()) {
+    if (entries_.size() < capacity_) {
+      entries_.emplace_back();
+    } else {
+      cache_bit = lru_.back();
+      erase_response(cache_bit);
+    }
+  }
+
+  auto& entry = entries_[cache_bit];
+  entry.response = response;
+  entry.request = request;
+  entry.active = true;
+  lru_.push_front(cache_bit);
+  entry.lru_iter = lru_.begin();
+  tensor_id_to_bit_[tensor_id] = cache_bit;
+}
+
+const MPIResponse& ResponseCache::get_response(uint32_t cache_bit) {
+  auto& entry = entries_[cache_bit];
+  assert(entry.active);
+  lru_.splice(lru_.begin(), lru_, entry.lru_iter);
+  return entry.response;
+}
+
+const MPIResponse& ResponseCache::peek_response(uint32_t cache_bit) const {
+  assert(entries_[cache_bit].active);
+  return entries_[cache_bit].response;
+}
+
+uint32_t ResponseCache::peek_cache_bit(int32_t tensor_id) const {
+  auto it = tensor_id_to_bit_.find(tensor_id);
+  assert(it != tensor_id_to_bit_.end());
+  return it->second;
+}
+
+void ResponseCache::erase_response(uint32_t cache_bit) {
+  if (cache_bit >= entries_.size() || !entries_[cache_bit].active) {
+    return;
+  }
+
+  auto& entry = entries_[cache_bit];
+  tensor_id_to_bit_.erase(entry.response.tensor_ids()[0]);
+  lru_.erase(entry.lru_iter);
+  entry.response = MPIResponse();
+  entry.request = MPIRequest();
+  entry.active = false;
+}
+
+void ResponseCache::erase_tensor(int32_t tensor_id) {
+  auto it = tensor_id_to_bit_.find(tensor_id);
+  if (it != tensor_id_to_bit_.end()) {
+    erase_response(it->second);
+  }
+}
+
+} // namespace common
+} // namespace horovod
@@ -0,0 +1,92 @@
+// Copyright 2018 Uber Technologies, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#ifndef HOROVOD_RESPONSE_CACHE_H
+#define HOROVOD_RESPONSE_CACHE_H
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "mpi_message.h"
+
+namespace horovod {
+namespace common {
+
+// Cache of MPIResponses for tensors that were negotiated in previous ticks,
+// keyed by the local ID of the tensor. Every cached response is assigned a
+// cache bit, which ranks exchange instead of full MPIRequests once a tensor is
+// cached.
+//
+// The cache is only consistent across ranks as long as every rank applies the
+// same sequence of put(), get_response() and erase_response() calls, since
+// cache bits are assigned and evicted (least recently used first) based on
+// that sequence.
+class ResponseCache {
+public:
+  enum CacheState { MISS = 0, HIT = 1, INVALID = 2 };
+
+  void clear();
+
+  void set_capacity(uint32_t capacity);
+  uint32_t capacity() const;
+  size_t num_active_bits() const;
+
+  // Returns HIT if the request matches the request the cached response was
+  // constructed for, INVALID if a response is cached for the tensor but
+  // the request parameters changed, and MISS otherwise.
+  CacheState cached(const MPIRequest& request) const;
+
+  // Caches a single-tensor response along with the request of this rank that
+  // it answers, evicting the least recently used entry if the cache is full.
+  void put(const MPIResponse& response, const MPIRequest& request);
+
+  // Returns the response cached at the cache bit and marks it as most
+  // recently used.
+  const MPIResponse& get_response(uint32_t cache_bit);
+
+  // Returns the response cached at the cache bit without touching LRU order.
+  const MPIResponse& peek_response(uint32_t cache_bit) const;
+
+  uint32_t peek_cache_bit(int32_t tensor_id) const;
+
+  void erase_response(uint32_t cache_bit);
+
+  // Erases the response cached for the tensor, if there is one.
+  void erase_tensor(int32_t tensor_id);
+
+private:
+  struct CacheEntry {
+    MPIResponse response;
+    MPIRequest request;
+    bool active = false;
+    std::list<uint32_t>::iterator lru_iter;
+  };
+
+  uint32_t capacity_ = 0;
+
+  // Cache entries indexed by cache bit.
+  std::vector<CacheEntry> entries_;
+
+  // Cache bits ordered from most to least recently used.
+  std::list<uint32_t> lru_;
+
+  std::unordered_map<int32_t, uint32_t> tensor_id_to_bit_;
+};
+
+} // namespace common
+} // namespace horovod
+
+#endif // HOROVOD_RESPONSE_CACHE_H
@@ -0,0 +1,227 @@
+// Copyright 2018 Uber Technologies, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include <cassert>
+
+#include "tensor_id_table.h"
+
+namespace horovod {
+namespace common {
+
+const int32_t TensorIdTable::UNKNOWN_ID;
+const int32_t TensorIdTable::MAX_SIZE;
+
+namespace {
+
+// Names are hashed with 64-bit FNV-1a, like MPIRequest::ComputeSignature, since
+// std::hash may differ between the standard libraries of the ranks.
+uint64_t HashName(const std::string& name) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (char c : name) {
+    hash ^= (uint64_t)(unsigned char)c;
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+} // namespace
+
+void TensorIdTable::clear() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  names_.clear();
+  name_hashes_.clear();
+  wire_ids_.clear();
+  refs_.clear();
+  free_ids_.clear();
+  unreferenced_ids_.clear();
+  ids_.clear();
+  local_ids_.clear();
+  lru_iters_.clear();
+  lru_.clear();
+}
+
+int32_t TensorIdTable::Intern(const std::string& name) {
+  auto it = ids_.find(name);
+  if (it != ids_.end()) {
+    return it->second;
+  }
+
+  int32_t id;
+  if (!free_ids_.empty()) {
+    id = free_ids_.back();
+    free_ids_.pop_back();
+    names_[id] = name;
+    name_hashes_[id] = HashName(name);
+    wire_ids_[id] = UNKNOWN_ID;
+    refs_[id] = 0;
+  } else {
+    id = (int32_t)names_.size();
+    names_.push_back(name);
+    name_hashes_.push_back(HashName(name));
+    wire_ids_.push_back(UNKNOWN_ID);
+    refs_.push_back(0);
+  }
+  ids_.emplace(name, id);
+  // Names that are never referenced are freed as well.
+  unreferenced_ids_.push_back(id);
+  return id;
+}
+
+int32_t TensorIdTable::Acquire(const std::string& name) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto id = Intern(name);
+  refs_[id]++;
+  return id;
+}
+
+void TensorIdTable::Acquire(int32_t id) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  assert(id >= 0 && id < (int32_t)names_.size() && refs_[id] >= 0);
+  refs_[id]++;
+}
+
+void TensorIdTable::Release(int32_t id) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  assert(id >= 0 && id < (int32_t)names_.size() && refs_[id] > 0);
+  if (--refs_[id] == 0 && wire_ids_[id] == UNKNOWN_ID) {
+    unreferenced_ids_.push_back(id);
+  }
+}
+
+void TensorIdTable::Collect() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (auto id : unreferenced_ids_) {
+    // IDs may have been referenced again, or listed more than once.
+    if (refs_[id] != 0 || wire_ids_[id] != UNKNOWN_ID) {
+      continue;
+    }
+    ids_.erase(names_[id]);
+    names_[id].clear();
+    refs_[id] = -1;
+    free_ids_.push_back(id);
+  }
+  unreferenced_ids_.clear();
+}
+
+std::string TensorIdTable::name(int32_t id) const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  assert(id >= 0 && id < (int32_t)names_.size() && refs_[id] >= 0);
+  return names_[id];
+}
+
+uint64_t TensorIdTable::name_hash(int32_t id) const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  assert(id >= 0 && id < (int32_t)names_.size() && refs_[id] >= 0);
+  return name_hashes_[id];
+}
+
+int32_t TensorIdTable::wire_id(int32_t id) const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  assert(id >= 0 && id < (int32_t)names_.size());
+  return wire_ids_[id];
+}
+
+void TensorIdTable::AssignWireIds(const MPIResponse& response,
+                                  std::vector<int32_t>& freed_ids) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (auto id : response.tensor_ids()) {
+    auto wire_id = wire_ids_[id];
+    if (wire_id != UNKNOWN_ID) {
+      lru_.splice(lru_.begin(), lru_, lru_iters_[wire_id]);
+      continue;
+    }
+
+    if (local_ids_.size() < (size_t)MAX_SIZE) {
+      wire_id = (int32_t)local_ids_.size();
+      local_ids_.push_back(id);
+      lru_.push_front(wire_id);
+      lru_iters_.push_back(lru_.begin());
+    } else {
+      wire_id = lru_.back();
+      lru_.splice(lru_.begin(), lru_, lru_iters_[wire_id]);
+      auto freed_id = local_ids_[wire_id];
+      wire_ids_[freed_id] = UNKNOWN_ID;
+      if (refs_[freed_id] == 0) {
+        unreferenced_ids_.push_back(freed_id);
+      }
+      freed_ids.push_back(freed_id);
+      local_ids_[wire_id] = id;
+    }
+    wire_ids_[id] = wire_id;
+  }
+}
+
+void TensorIdTable::EncodeRequests(MPIRequestList& request_list) const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (auto& request : request_list.mutable_requests()) {
+    auto id = request.tensor_id();
+    request.set_tensor_id(wire_ids_[id]);
+    if (wire_ids_[id] == UNKNOWN_ID) {
+      request.set_tensor_name(names_[id]);
+    }
+  }
+}
+
+void TensorIdTable::DecodeRequests(MPIRequestList& request_list) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (auto& request : request_list.mutable_requests()) {
+    if (request.tensor_id() != UNKNOWN_ID) {
+      request.set_tensor_id(local_ids_[request.tensor_id()]);
+    } else {
+      request.set_tensor_id(Intern(request.tensor_name()));
+      request.set_tensor_name(std::string());
+    }
+  }
+}
+
+void TensorIdTable::EncodeResponses(MPIResponseList& response_list) const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (auto& response : response_list.mutable_responses()) {
+    std::vector<int32_t> tensor_ids;
+    tensor_ids.reserve(response.tensor_ids().size());
+    std::vector<std::string> unknown_names;
+    for (auto id : response.tensor_ids()) {
+      tensor_ids.push_back(wire_ids_[id]);
+      if (wire_ids_[id] == UNKNOWN_ID) {
+        unknown_names.push_back(names_[id]);
+      }
+    }
+    response.set_tensor_ids(tensor_ids);
+    response.set_tensor_names(unknown_names);
+  }
+}
+
+void TensorIdTable::DecodeResponses(MPIResponseList& response_list) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (auto& response : response_list.mutable_responses()) {
+    auto& unknown_names = response.tensor_names();
+    std::vector<int32_t> tensor_ids;
+    tensor_ids.reserve(response.tensor_ids().size());
+    size_t next_unknown = 0;
+    for (auto wire_id : response.tensor_ids()) {
+      if (wire_id != UNKNOWN_ID) {
+        tensor_ids.push_back(local_ids_[wire_id]);
+      } else {
+        assert(next_unknown < unknown_names.size());
+        tensor_ids.push_back(Intern(unknown_names[next_unknown++]));
+      }
+    }
+    response.set_tensor_ids(tensor_ids);
+    response.set_tensor_names(std::vector<std::string>());
+  }
+}
+
+} // namespace common
+} // namespace horovod
@@ -0,0 +1,131 @@
+// Copyright 2018 Uber Technologies, Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#ifndef HOROVOD_TENSOR_ID_TABLE_H
+#define HOROVOD_TENSOR_ID_TABLE_H
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mpi_message.h"
+
+namespace horovod {
+namespace common {
+
+// Interned tensor names. Every rank assigns a local ID to a tensor name when
+// the framework enqueues the tensor, or when the name first arrives in a
+// message. Local IDs key the tensor table, the message table and the response
+// cache, so names are only resolved at the framework boundary and to report
+// errors, stalls and timeline events.
+//
+// Local IDs differ between ranks. Every name also gets a 32-bit wire ID once
+// the first response for it is received from the coordinator, in the order of
+// the response list. Once MAX_SIZE names have one, the wire ID of the name
+// negotiated least recently is reused. Since every rank receives the same
+// response lists, wire IDs are identical across ranks without exchanging them
+// explicitly. Requests and responses of tensors with a wire ID send the wire
+// ID instead of the name, and are translated back to local IDs right after
+// the messages are parsed.
+//
+// Local IDs are reference counted. Names keep their local ID as long as they
+// have a wire ID, which the response cache relies on. Otherwise, local IDs
+// are freed by Collect() once nothing references them, so that programs that
+// generate new tensor names all the time, like unnamed PyTorch operations, do
+// not grow the table beyond MAX_SIZE names.
+//
+// The table is shared by the framework threads and the background threads, so
+// all methods lock it.
+class TensorIdTable {
+public:
+  static const int32_t UNKNOWN_ID = -1;
+
+  // Maximum number of names with a wire ID.
+  static const int32_t MAX_SIZE = 1 << 16;
+
+  void clear();
+
+  // Returns the local ID of the tensor name, assigning one if it has none,
+  // and takes a reference to it.
+  int32_t Acquire(const std::string& name);
+
+  // Takes another reference to a local ID, or drops one.
+  void Acquire(int32_t id);
+  void Release(int32_t id);
+
+  // Frees the local IDs of names without a wire ID that are no longer
+  // referenced. Only called by the background thread between negotiations,
+  // while every local ID in use is referenced.
+  void Collect();
+
+  std::string name(int32_t id) const;
+
+  // Returns a hash of the tensor name that is the same on every rank.
+  uint64_t name_hash(int32_t id) const;
+
+  // Returns the wire ID of the local ID, or UNKNOWN_ID if it has none.
+  int32_t wire_id(int32_t id) const;
+
+  // Assigns wire IDs to the tensors of the response that do not have one yet,
+  // and marks the wire IDs of all its tensors as most recently used. Once
+  // MAX_SIZE tensors have one, the least recently used wire ID is taken from
+  // its tensor, whose local ID is freed along with it by the next Collect()
+  // once unreferenced, and is appended to freed_ids.
+  void AssignWireIds(const MPIResponse& response,
+                     std::vector<int32_t>& freed_ids);
+
+  // Replace local IDs with wire IDs, or with names for tensors without a wire
+  // ID, before sending the messages, and restore local IDs after receiving
+  // the messages.
+  void EncodeRequests(MPIRequestList& request_list) const;
+  void DecodeRequests(MPIRequestList& request_list);
+  void EncodeResponses(MPIResponseList& response_list) const;
+  void DecodeResponses(MPIResponseList& response_list);
+
+private:
+  // Returns the local ID of the tensor name, assigning one if it has none,
+  // without taking a reference. The caller holds mutex_.
+  int32_t Intern(const std::string& name);
+
+  mutable std::mutex mutex_;
+
+  // Tensor names, their hashes, wire IDs and reference counts indexed by
+  // local ID. Freed local IDs have a negative reference count and are reused
+  // first.
+  std::vector<std::string> names_;
+  std::vector<uint64_t> name_hashes_;
+  std::vector<int32_t> wire_ids_;
+  std::vector<int32_t> refs_;
+  std::vector<int32_t> free_ids_;
+
+  // Local IDs that may no longer be referenced, checked by Collect().
+  std::vector<int32_t> unreferenced_ids_;
+
+  std::unordered_map<std::string, int32_t> ids_;
+
+  // Local IDs, and positions in lru_, indexed by wire ID.
+  std::vector<int32_t> local_ids_;
+  std::vector<std::list<int32_t>::iterator> lru_iters_;
+
+  // Wire IDs ordered from most to least recently used.
+  std::list<int32_t> lru_;
+};
+
+} // namespace common
+} // namespace horovod
+
+#endif // HOROVOD_TENSOR_ID_TABLE_H
@@ -44,8 +44,9 @@ enum MPIDataType {
   MPIDataType_HOROVOD_FLOAT32 = 7,
   MPIDataType_HOROVOD_FLOAT64 = 8,
   MPIDataType_HOROVOD_BOOL = 9,
+  MPIDataType_HOROVOD_BFLOAT16 = 10,
   MPIDataType_MIN = MPIDataType_HOROVOD_UINT8,
-  MPIDataType_MAX = MPIDataType_HOROVOD_BOOL
+  MPIDataType_MAX = MPIDataType_HOROVOD_BFLOAT16
 };
 
 inline const char **EnumNamesMPIDataType() {
@@ -60,6 +61,7 @@ inline const char **EnumNamesMPIDataType() {
     "HOROVOD_FLOAT32",
     "HOROVOD_FLOAT64",
     "HOROVOD_BOOL",
+    "HOROVOD_BFLOAT16",
     nullptr
   };
   return names;
@@ -70,6 +72,37 @@ inline const char *EnumNameMPIDataType(MPIDataType e) {
   return EnumNamesMPIDataType()[index];
 }
 
+enum MPIReduceOp {
+  MPIReduceOp_SUM = 0,
+  MPIReduceOp_MINIMUM = 1,
+  MPIReduceOp_MAXIMUM = 2,
+  MPIReduceOp_PRODUCT = 3,
+  MPIReduceOp_BAND = 4,
+  MPIReduceOp_BOR = 5,
+  MPIReduceOp_BXOR = 6,
+  MPIReduceOp_MIN = MPIReduceOp_SUM,
+  MPIReduceOp_MAX = MPIReduceOp_BXOR
+};
+
+inline const char **EnumNamesMPIReduceOp() {
+  static const char *names[] = {
+    "SUM",
+    "MINIMUM",
+    "MAXIMUM",
+    "PRODUCT",
+    "BAND",
+    "BOR",
+    "BXOR",
+    nullptr
+  };
+  return names;
+}
+
+inline const char *EnumNameMPIReduceOp(MPIReduceOp e) {
+  const size_t index = static_cast<int>(e);
+  return EnumNamesMPIReduceOp()[index];
+}
+
 enum MPIRequestType {
   MPIRequestType_ALLREDUCE = 0,
   MPIRequestType_ALLGATHER = 1,
@@ -126,7 +159,14 @@ struct MPIRequest FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
     VT_TENSOR_NAME = 10,
     VT_ROOT_RANK = 12,
     VT_DEVICE = 14,
-    VT_TENSOR_SHAPE = 16
+    VT_TENSOR_SHAPE = 16,
+    VT_TENSOR_ID = 18,
+    VT_SIGNATURE = 20,
+    VT_PRIORITY = 22,
+    VT_REDUCE_OP = 24,
+    VT_NODE_RANKS = 26,
+    VT_NODE_DEVICES = 28,
+    VT_NODE_FIRST_DIMS = 30
   };
   int32_t request_rank() const {
     return GetField<int32_t>(VT_REQUEST_RANK, 0);
@@ -149,6 +189,27 @@ struct MPIRequest FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
   const flatbuffers::Vector<int64_t> *tensor_shape() const {
     return GetPointer<const flatbuffers::Vector<int64_t> *>(VT_TENSOR_SHAPE);
   }
+  int32_t tensor_id() const {
+    return GetField<int32_t>(VT_TENSOR_ID, -1);
+  }
+  uint64_t signature() const {
+    return GetField<uint64_t>(VT_SIGNATURE, 0);
+  }
+  int32_t priority() const {
+    return GetField<int32_t>(VT_PRIORITY, 0);
+  }
+  MPIReduceOp reduce_op() const {
+    return static_cast<MPIReduceOp>(GetField<int8_t>(VT_REDUCE_OP, 0));
+  }
+  const flatbuffers::Vector<int32_t> *node_ranks() const {
+    return GetPointer<const flatbuffers::Vector<int32_t> *>(VT_NODE_RANKS);
+  }
+  const flatbuffers::Vector<int32_t> *node_devices() const {
+    return GetPointer<const flatbuffers::Vector<int32_t> *>(VT_NODE_DEVICES);
+  }
+  const flatbuffers::Vector<int64_t> *node_first_dims() const {
+    return GetPointer<const flatbuffers::Vector<int64_t> *>(VT_NODE_FIRST_DIMS);
+  }
   bool Verify(flatbuffers::Verifier &verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyField<int32_t>(verifier, VT_REQUEST_RANK) &&
@@ -160,6 +221,16 @@ struct MPIRequest FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
            VerifyField<int32_t>(verifier, VT_DEVICE) &&
            VerifyField<flatbuffers::uoffset_t>(verifier, VT_TENSOR_SHAPE) &&
            verifier.Verify(tensor_shape()) &&
+           VerifyField<int32_t>(verifier, VT_TENSOR_ID) &&
+           VerifyField<uint64_t>(verifier, VT_SIGNATURE) &&
+           VerifyField<int32_t>(verifier, VT_PRIORITY) &&
+           VerifyField<int8_t>(verifier, VT_REDUCE_OP) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, VT_NODE_RANKS) &&
+           verifier.Verify(node_ranks()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, VT_NODE_DEVICES) &&
+           verifier.Verify(node_devices()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, VT_NODE_FIRST_DIMS) &&
+           verifier.Verify(node_first_dims()) &&
            verifier.EndTable();
   }
 };
@@ -188,13 +259,34 @@ struct MPIRequestBuilder {
   void add_tensor_shape(flatbuffers::Offset<flatbuffers::Vector<int64_t>> tensor_shape) {
     fbb_.AddOffset(MPIRequest::VT_TENSOR_SHAPE, tensor_shape);
   }
+  void add_tensor_id(int32_t tensor_id) {
+    fbb_.AddElement<int32_t>(MPIRequest::VT_TENSOR_ID, tensor_id, -1);
+  }
+  void add_signature(uint64_t signature) {
+    fbb_.AddElement<uint64_t>(MPIRequest::VT_SIGNATURE, signature, 0);
+  }
+  void add_priority(int32_t priority) {
+    fbb_.AddElement<int32_t>(MPIRequest::VT_PRIORITY, priority, 0);
+  }
+  void add_reduce_op(MPIReduceOp reduce_op) {
+    fbb_.AddElement<int8_t>(MPIRequest::VT_REDUCE_OP, static_cast<int8_t>(reduce_op), 0);
+  }
+  void add_node_ranks(flatbuffers::Offset<flatbuffers::Vector<int32_t>> node_ranks) {
+    fbb_.AddOffset(MPIRequest::VT_NODE_RANKS, node_ranks);
+  }
+  void add_node_devices(flatbuffers::Offset<flatbuffers::Vector<int32_t>> node_devices) {
+    fbb_.AddOffset(MPIRequest::VT_NODE_DEVICES, node_devices);
+  }
+  void add_node_first_dims(flatbuffers::Offset<flatbuffers::Vector<int64_t>> node_first_dims) {
+    fbb_.AddOffset(MPIRequest::VT_NODE_FIRST_DIMS, node_first_dims);
+  }
   MPIRequestBuilder(flatbuffers::FlatBufferBuilder &_fbb)
         : fbb_(_fbb) {
     start_ = fbb_.StartTable();
   }
   MPIRequestBuilder &operator=(const MPIRequestBuilder &);
   flatbuffers::Offset<MPIRequest> Finish() {
-    const auto end = fbb_.EndTable(start_, 7);
+    const auto end = fbb_.EndTable(start_, 14);
     auto o = flatbuffers::Offset<MPIRequest>(end);
     return o;
   }
@@ -208,13 +300,27 @@ inline flatbuffers::Offset<MPIRequest> CreateMPIRequest(
     flatbuffers::Offset<flatbuffers::String> tensor_name = 0,
     int32_t root_rank = 0,
     int32_t device = 0,
-    flatbuffers::Offset<flatbuffers::Vector<int64_t>> tensor_shape = 0) {
+    flatbuffers::Offset<flatbuffers::Vector<int64_t>> tensor_shape = 0,
+    int32_t tensor_id = -1,
+    uint64_t signature = 0,
+    int32_t priority = 0,
+    MPIReduceOp reduce_op = MPIReduceOp_SUM,
+    flatbuffers::Offset<flatbuffers::Vector<int32_t>> node_ranks = 0,
+    flatbuffers::Offset<flatbuffers::Vector<int32_t>> node_devices = 0,
+    flatbuffers::Offset<flatbuffers::Vector<int64_t>> node_first_dims = 0) {
   MPIRequestBuilder builder_(_fbb);
+  builder_.add_signature(signature);
+  builder_.add_node_first_dims(node_first_dims);
+  builder_.add_node_devices(node_devices);
+  builder_.add_node_ranks(node_ranks);
+  builder_.add_priority(priority);
+  builder_.add_tensor_id(tensor_id);
   builder_.add_tensor_shape(tensor_shape);
   builder_.add_device(device);
   builder_.add_root_rank(root_rank);
   builder_.add_tensor_name(tensor_name);
   builder_.add_request_rank(request_rank);
+  builder_.add_reduce_op(reduce_op);
   builder_.add_tensor_type(tensor_type);
   builder_.add_request_type(request_type);
   return builder_.Finish();
@@ -228,7 +334,14 @@ inline flatbuffers::Offset<MPIRequest> CreateMPIRequestDirect(
     const char *tensor_name = nullptr,
     int32_t root_rank = 0,
     int32_t device = 0,
-    const std::vector<int64_t> *tensor_shape = nullptr) {
+    const std::vector<int64_t> *tensor_shape = nullptr,
+    int32_t tensor_id = -1,
+    uint64_t signature = 0,
+    int32_t priority = 0,
+    MPIReduceOp reduce_op = MPIReduceOp_SUM,
+    const std::vector<int32_t> *node_ranks = nullptr,
+    const std::vector<int32_t> *node_devices = nullptr,
+    const std::vector<int64_t> *node_first_dims = nullptr) {
   return horovod::common::wire::CreateMPIRequest(
       _fbb,
       request_rank,
@@ -237,7 +350,14 @@ inline flatbuffers::Offset<MPIRequest> CreateMPIRequestDirect(
       tensor_name ? _fbb.CreateString(tensor_name) : 0,
       root_rank,
       device,
-      tensor_shape ? _fbb.CreateVector<int64_t>(*tensor_shape) : 0);
+      tensor_shape ? _fbb.CreateVector<int64_t>(*tensor_shape) : 0,
+      tensor_id,
+      signature,
+      priority,
+      reduce_op,
+      node_ranks ? _fbb.CreateVector<int32_t>(*node_ranks) : 0,
+      node_devices ? _fbb.CreateVector<int32_t>(*node_devices) : 0,
+      node_first_dims ? _fbb.CreateVector<int64_t>(*node_first_dims) : 0);
 }
 
 struct MPIRequestList FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
@@ -308,7 +428,10 @@ struct MPIResponse FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
     VT_TENSOR_NAMES = 6,
     VT_ERROR_MESSAGE = 8,
     VT_DEVICES = 10,
-    VT_TENSOR_SIZES = 12
+    VT_TENSOR_SIZES = 12,
+    VT_TENSOR_IDS = 14,
+    VT_PRIORITY = 16,
+    VT_REDUCE_OP = 18
   };
   MPIResponseType response_type() const {
     return static_cast<MPIResponseType>(GetField<int8_t>(VT_RESPONSE_TYPE, 0));
@@ -325,6 +448,15 @@ struct MPIResponse FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
   const flatbuffers::Vector<int64_t> *tensor_sizes() const {
     return GetPointer<const flatbuffers::Vector<int64_t> *>(VT_TENSOR_SIZES);
   }
+  const flatbuffers::Vector<int32_t> *tensor_ids() const {
+    return GetPointer<const flatbuffers::Vector<int32_t> *>(VT_TENSOR_IDS);
+  }
+  int32_t priority() const {
+    return GetField<int32_t>(VT_PRIORITY, 0);
+  }
+  MPIReduceOp reduce_op() const {
+    return static_cast<MPIReduceOp>(GetField<int8_t>(VT_REDUCE_OP, 0));
+  }
   bool Verify(flatbuffers::Verifier &verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyField<int8_t>(verifier, VT_RESPONSE_TYPE) &&
@@ -337,6 +469,10 @@ struct MPIResponse FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
            verifier.Verify(devices()) &&
            VerifyField<flatbuffers::uoffset_t>(verifier, VT_TENSOR_SIZES) &&
            verifier.Verify(tensor_sizes()) &&
+           VerifyField<flatbuffers::uoffset_t>(verifier, VT_TENSOR_IDS) &&
+           verifier.Verify(tensor_ids()) &&
+           VerifyField<int32_t>(verifier, VT_PRIORITY) &&
+           VerifyField<int8_t>(verifier, VT_REDUCE_OP) &&
            verifier.EndTable();
   }
 };
@@ -359,13 +495,22 @@ struct MPIResponseBuilder {
   void add_tensor_sizes(flatbuffers::Offset<flatbuffers::Vector<int64_t>> tensor_sizes) {
     fbb_.AddOffset(MPIResponse::VT_TENSOR_SIZES, tensor_sizes);
   }
+  void add_tensor_ids(flatbuffers::Offset<flatbuffers::Vector<int32_t>> tensor_ids) {
+    fbb_.AddOffset(MPIResponse::VT_TENSOR_IDS, tensor_ids);
+  }
+  void add_priority(int32_t priority) {
+    fbb_.AddElement<int32_t>(MPIResponse::VT_PRIORITY, priority, 0);
+  }
+  void add_reduce_op(MPIReduceOp reduce_op) {
+    fbb_.AddElement<int8_t>(MPIResponse::VT_REDUCE_OP, static_cast<int8_t>(reduce_op), 0);
+  }
   MPIResponseBuilder(flatbuffers::FlatBufferBuilder &_fbb)
         : fbb_(_fbb) {
     start_ = fbb_.StartTable();
   }
   MPIResponseBuilder &operator=(const MPIResponseBuilder &);
   flatbuffers::Offset<MPIResponse> Finish() {
-    const auto end = fbb_.EndTable(start_, 5);
+    const auto end = fbb_.EndTable(start_, 8);
     auto o = flatbuffers::Offset<MPIResponse>(end);
     return o;
   }
@@ -377,12 +522,18 @@ inline flatbuffers::Offset<MPIResponse> CreateMPIResponse(
     flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>>> tensor_names = 0,
     flatbuffers::Offset<flatbuffers::String> error_message = 0,
     flatbuffers::Offset<flatbuffers::Vector<int32_t>> devices = 0,
-    flatbuffers::Offset<flatbuffers::Vector<int64_t>> tensor_sizes = 0) {
+    flatbuffers::Offset<flatbuffers::Vector<int64_t>> tensor_sizes = 0,
+    flatbuffers::Offset<flatbuffers::Vector<int32_t>> tensor_ids = 0,
+    int32_t priority = 0,
+    MPIReduceOp reduce_op = MPIReduceOp_SUM) {
   MPIResponseBuilder builder_(_fbb);
+  builder_.add_priority(priority);
+  builder_.add_tensor_ids(tensor_ids);
   builder_.add_tensor_sizes(tensor_sizes);
   builder_.add_devices(devices);
   builder_.add_error_message(error_message);
   builder_.add_tensor_names(tensor_names);
+  builder_.add_reduce_op(reduce_op);
   builder_.add_response_type(response_type);
   return builder_.Finish();
 }
@@ -393,14 +544,20 @@ inline flatbuffers::Offset<MPIResponse> CreateMPIResponseDirect(
     const std::vector<flatbuffers::Offset<flatbuffers::String>> *tensor_names = nullptr,
     const char *error_message = nullptr,
     const std::vector<int32_t> *devices = nullptr,
-    const std::vector<int64_t> *tensor_sizes = nullptr) {
+    const std::vector<int64_t> *tensor_sizes = nullptr,
+    const std::vector<int32_t> *tensor_ids = nullptr,
+    int32_t priority = 0,
+    MPIReduceOp reduce_op = MPIReduceOp_SUM) {
   return horovod::common::wire::CreateMPIResponse(
       _fbb,
       response_type,
       tensor_names ? _fbb.CreateVector<flatbuffers::Offset<flatbuffers::String>>(*tensor_names) : 0,
       error_message ? _fbb.CreateString(error_message) : 0,
       devices ? _fbb.CreateVector<int32_t>(*devices) : 0,
-      tensor_sizes ? _fbb.CreateVector<int64_t>(*tensor_sizes) : 0);
+      tensor_sizes ? _fbb.CreateVector<int64_t>(*tensor_sizes) : 0,
+      tensor_ids ? _fbb.CreateVector<int32_t>(*tensor_ids) : 0,
+      priority,
+      reduce_op);
 }
 
 struct MPIResponseList FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
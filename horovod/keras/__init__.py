@@ -23,6 +23,8 @@ from horovod.tensorflow import local_size
 from horovod.tensorflow import rank
 from horovod.tensorflow import local_rank
 from horovod.tensorflow import mpi_threads_supported
+from horovod.tensorflow import collective_algorithm, collective_algorithm_rules
+from horovod.tensorflow import set_collective_algorithm_rules
 from horovod.tensorflow import Compression
 
 from horovod.keras import callbacks
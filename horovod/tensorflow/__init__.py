@@ -30,6 +30,9 @@ from __future__ import division
 from __future__ import print_function
 
 from horovod.common import check_extension
+from horovod.common import Sum, Min, Max, Product
+from horovod.common import BitwiseAnd, BitwiseOr, BitwiseXor
+from horovod.common import resolve_reduce_op
 
 check_extension('horovod.tensorflow', 'HOROVOD_WITH_TENSORFLOW', __file__, 'mpi_lib')
 
@@ -38,19 +41,32 @@ from horovod.tensorflow.mpi_ops import allgather, broadcast, _allreduce
 from horovod.tensorflow.mpi_ops import init, shutdown
 from horovod.tensorflow.mpi_ops import size, local_size, rank, local_rank
 from horovod.tensorflow.mpi_ops import mpi_threads_supported
+from horovod.tensorflow.mpi_ops import gpu_allreduce_built
+from horovod.tensorflow.mpi_ops import collective_algorithm
+from horovod.tensorflow.mpi_ops import collective_algorithm_rules
+from horovod.tensorflow.mpi_ops import set_collective_algorithm_rules
 
 import tensorflow as tf
 
 
-def allreduce(tensor, average=True, device_dense='', device_sparse='',
-              compression=Compression.none):
+def _on_cpu(device):
+    """Returns whether an allreduce placed on the device runs on CPU."""
+    if not gpu_allreduce_built():
+        return True
+    return (bool(device) and
+            tf.DeviceSpec.from_string(device).device_type == 'CPU')
+
+
+def allreduce(tensor, average=None, device_dense='', device_sparse='',
+              compression=Compression.none, priority=0, op=None):
     """Perform an allreduce on a tf.Tensor or tf.IndexedSlices.
 
     Arguments:
         tensor: tf.Tensor, tf.Variable, or tf.IndexedSlices to reduce.
         The shape of the input must be identical across all ranks.
         average: If True, computes the average over all ranks.
-                 Otherwise, computes the sum over all ranks.
+                 Otherwise, computes the sum over all ranks. Defaults to True
+                 for sums, and only applies to sums.
         device_dense: Device to be used for dense tensors. Uses GPU by default
                       if Horovod was build with HOROVOD_GPU_ALLREDUCE.
         device_sparse: Device to be used for sparse tensors. Uses GPU by default
@@ -58,13 +74,22 @@ def allreduce(tensor, average=True, device_dense='', device_sparse='',
         compression: Compression algorithm used to reduce the amount of data
                      sent and received by each worker node.  Defaults to not
                      using compression.
+        priority: Tensors with a higher priority are reduced first once they
+                  are ready on all ranks. Defaults to 0.
+        op: The reduction operation, one of Sum, Min, Max or Product, or
+            BitwiseAnd, BitwiseOr or BitwiseXor for integer and boolean
+            tensors. Booleans only support the bitwise operations. Defaults
+            to Sum. Only sums are supported for tf.IndexedSlices.
 
     This function performs a bandwidth-optimal ring allreduce on the input
     tensor. If the input is an tf.IndexedSlices, the function instead does an
     allgather on the values and the indices, effectively doing an allreduce on
     the represented tensor.
     """
+    average, op = resolve_reduce_op(average, op)
     if isinstance(tensor, tf.IndexedSlices):
+        if op != Sum:
+            raise ValueError('Only sums are supported for tf.IndexedSlices.')
         with tf.device(device_sparse):
             # For IndexedSlices, do two allgathers intead of an allreduce.
             horovod_size = tf.cast(size(), tensor.values.dtype)
@@ -80,10 +105,19 @@ def allreduce(tensor, average=True, device_dense='', device_sparse='',
         with tf.device(device_dense):
             horovod_size = tf.cast(size(), dtype=tensor.dtype)
             tensor_compressed, ctx = compression.compress(tensor)
-            summed_tensor_compressed = _allreduce(tensor_compressed)
+            # Averages of tensors on CPU are scaled by Horovod as it copies the
+            # sums out of the fusion buffer, rather than by another op.
+            # Factors are float32, so float64 tensors are still divided.
+            scale = (average and
+                     tensor_compressed.dtype in (tf.float16, tf.bfloat16,
+                                                 tf.float32) and
+                     _on_cpu(device_dense or tensor.device))
+            summed_tensor_compressed = _allreduce(
+                tensor_compressed, priority=priority, op=op,
+                postscale_factor=1.0 / size() if scale else 1.0)
             summed_tensor = compression.decompress(summed_tensor_compressed, ctx)
             new_tensor = (tf.div(summed_tensor, horovod_size)
-                          if average else summed_tensor)
+                          if average and not scale else summed_tensor)
         return new_tensor
 
 
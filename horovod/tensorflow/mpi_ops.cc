@@ -186,6 +186,8 @@ const common::MPIDataType TFTensor::dtype() const {
     return common::HOROVOD_INT64;
   case DT_HALF:
     return common::HOROVOD_FLOAT16;
+  case DT_BFLOAT16:
+    return common::HOROVOD_BFLOAT16;
   case DT_FLOAT:
     return common::HOROVOD_FLOAT32;
   case DT_DOUBLE:
@@ -276,7 +278,14 @@ common::ReadyEvent* RecordReadyEvent(OpKernelContext* context) {
 class HorovodAllreduceOp : public AsyncOpKernel {
 public:
   explicit HorovodAllreduceOp(OpKernelConstruction* context)
-      : AsyncOpKernel(context) {}
+      : AsyncOpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("priority", &priority_));
+    OP_REQUIRES_OK(context, context->GetAttr("reduce_op", &reduce_op_));
+    OP_REQUIRES_OK(context,
+                   context->GetAttr("prescale_factor", &prescale_factor_));
+    OP_REQUIRES_OK(context,
+                   context->GetAttr("postscale_factor", &postscale_factor_));
+  }
 
   void ComputeAsync(OpKernelContext* context, DoneCallback done) override {
     OP_REQUIRES_OK_ASYNC(context, ConvertStatus(common::CheckInitialized()),
@@ -298,20 +307,39 @@ public:
         [context, done](const common::Status& status) {
           context->SetStatus(ConvertStatus(status));
           done();
-        });
+        },
+        priority_, (common::ReduceOp)reduce_op_, prescale_factor_,
+        postscale_factor_);
     OP_REQUIRES_OK_ASYNC(context, ConvertStatus(enqueue_result), done);
   }
+
+private:
+  int priority_;
+  int reduce_op_;
+  float prescale_factor_;
+  float postscale_factor_;
 };
 
 REGISTER_KERNEL_BUILDER(Name("HorovodAllreduce").Device(DEVICE_CPU),
                         HorovodAllreduceOp);
 #if HOROVOD_GPU_ALLREDUCE
-REGISTER_KERNEL_BUILDER(Name("HorovodAllreduce").Device(DEVICE_GPU),
+// NCCL has no reduction of booleans and 8 or 16-bit integers, which are placed
+// on the CPU kernel instead.
+REGISTER_KERNEL_BUILDER(Name("HorovodAllreduce")
+                            .Device(DEVICE_GPU)
+                            .TypeConstraint("T", {DT_INT32, DT_INT64, DT_HALF,
+                                                  DT_BFLOAT16, DT_FLOAT,
+                                                  DT_DOUBLE}),
                         HorovodAllreduceOp);
 #endif
 
 REGISTER_OP("HorovodAllreduce")
-    .Attr("T: {int32, int64, float16, float32, float64}")
+    .Attr("T: {uint8, int8, int16, int32, int64, float16, bfloat16, float32, "
+          "float64, bool}")
+    .Attr("priority: int = 0")
+    .Attr("reduce_op: int = 0")
+    .Attr("prescale_factor: float = 1.0")
+    .Attr("postscale_factor: float = 1.0")
     .Input("tensor: T")
     .Output("sum: T")
     .SetShapeFn([](shape_inference::InferenceContext* c) {
@@ -326,9 +354,18 @@ allreduce.
 
 Arguments
     tensor:     A tensor to reduce.
+    priority:   Tensors with a higher priority are reduced first once they are
+                ready on all processes.
+    reduce_op:  Reduction operation: 0 for sum, 1 for min, 2 for max, 3 for
+                product, and 4, 5 and 6 for bitwise and, or and xor of integer
+                and boolean tensors. Only bitwise operations apply to booleans.
+    prescale_factor:  Factor that the tensor is multiplied by before the
+                      reduction. Only supported on CPU.
+    postscale_factor: Factor that the result is multiplied by after the
+                      reduction. Only supported on CPU.
 
 Output
-    sum:    A tensor with the same shape as `tensor`, summed across all MPI processes.
+    sum:    A tensor with the same shape as `tensor`, reduced across all MPI processes.
 )doc");
 
 class HorovodAllgatherOp : public AsyncOpKernel {
@@ -368,7 +405,7 @@ REGISTER_KERNEL_BUILDER(Name("HorovodAllgather").Device(DEVICE_GPU),
 
 REGISTER_OP("HorovodAllgather")
     .Attr(
-        "T: {uint8, int8, uint16, int16, int32, int64, float16, float32, float64, bool}")
+        "T: {uint8, int8, uint16, int16, int32, int64, float16, bfloat16, float32, float64, bool}")
     .Input("tensor: T")
     .Output("output: T")
     .SetShapeFn([](shape_inference::InferenceContext* c) {
@@ -441,7 +478,7 @@ REGISTER_KERNEL_BUILDER(Name("HorovodBroadcast").Device(DEVICE_GPU),
 
 REGISTER_OP("HorovodBroadcast")
     .Attr(
-        "T: {uint8, int8, uint16, int16, int32, int64, float16, float32, float64, bool}")
+        "T: {uint8, int8, uint16, int16, int32, int64, float16, bfloat16, float32, float64, bool}")
     .Attr("root_rank: int")
     .Input("tensor: T")
     .Output("output: T")
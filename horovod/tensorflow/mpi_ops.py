@@ -27,6 +27,7 @@ from tensorflow.python.platform import resource_loader
 
 from horovod.common import get_ext_suffix
 from horovod.common import HorovodBasics as _HorovodBasics
+from horovod.common import Sum
 
 
 def _load_library(name, op_list=None):
@@ -67,6 +68,10 @@ local_size = _basics.local_size
 rank = _basics.rank
 local_rank = _basics.local_rank
 mpi_threads_supported = _basics.mpi_threads_supported
+gpu_allreduce_built = _basics.gpu_allreduce_built
+collective_algorithm = _basics.collective_algorithm
+collective_algorithm_rules = _basics.collective_algorithm_rules
+set_collective_algorithm_rules = _basics.set_collective_algorithm_rules
 
 
 def _normalize_name(name):
@@ -74,20 +79,29 @@ def _normalize_name(name):
     return re.sub('[^a-zA-Z0-9_]', '_', name)
 
 
-def _allreduce(tensor, name=None):
-    """An op which sums an input tensor over all the Horovod processes.
+def _allreduce(tensor, name=None, priority=0, op=Sum, prescale_factor=1.0,
+               postscale_factor=1.0):
+    """An op which reduces an input tensor over all the Horovod processes.
 
     The reduction operation is keyed by the name of the op. The tensor type and
     shape must be the same on all Horovod processes for a given name. The reduction
     will not start until all processes are ready to send and receive the tensor.
+    Tensors with a higher priority are reduced first once they are ready. All
+    processes must reduce the tensor with the same op, which is Sum by default.
+    Tensors on CPU are multiplied by prescale_factor before the reduction and by
+    postscale_factor after it, as they are copied into and out of the fusion
+    buffer.
 
     Returns:
-      A tensor of the same shape and type as `tensor`, summed across all
+      A tensor of the same shape and type as `tensor`, reduced across all
       processes.
     """
     if name is None:
         name = 'HorovodAllreduce_%s' % _normalize_name(tensor.name)
-    return MPI_LIB.horovod_allreduce(tensor, name=name)
+    return MPI_LIB.horovod_allreduce(tensor, name=name, priority=priority,
+                                     reduce_op=op,
+                                     prescale_factor=prescale_factor,
+                                     postscale_factor=postscale_factor)
 
 
 @ops.RegisterGradient('HorovodAllreduce')
@@ -101,7 +115,13 @@ def _allreduce_grad(op, grad):
     Returns:
       The gradient with respect to the input of the op.
     """
-    return _allreduce(grad)
+    if op.get_attr('reduce_op') != Sum:
+        raise NotImplementedError(
+            'Only the gradient of a summation allreduce is implemented.')
+    grad = _allreduce(grad, priority=op.get_attr('priority'))
+    # The gradient may be placed on GPU, where factors are not supported.
+    scale = op.get_attr('prescale_factor') * op.get_attr('postscale_factor')
+    return grad * scale if scale != 1.0 else grad
 
 
 def allgather(tensor, name=None):
@@ -18,6 +18,8 @@ from __future__ import division
 from __future__ import print_function
 
 from horovod.common import check_extension
+from horovod.common import Sum, Min, Max, Product
+from horovod.common import BitwiseAnd, BitwiseOr, BitwiseXor
 
 try:
     check_extension('horovod.torch', 'HOROVOD_WITH_PYTORCH',
@@ -33,7 +35,9 @@ from horovod.torch.mpi_ops import broadcast, broadcast_async, broadcast_, broadc
 from horovod.torch.mpi_ops import poll, synchronize
 from horovod.torch.mpi_ops import init, shutdown
 from horovod.torch.mpi_ops import size, local_size, rank, local_rank
-from horovod.torch.mpi_ops import mpi_threads_supported
+from horovod.torch.mpi_ops import mpi_threads_supported, gpu_allreduce_built
+from horovod.torch.mpi_ops import collective_algorithm, collective_algorithm_rules
+from horovod.torch.mpi_ops import set_collective_algorithm_rules
 
 import torch
 import collections
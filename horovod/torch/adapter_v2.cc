@@ -50,10 +50,18 @@ const MPIDataType TorchTensor::dtype() const {
     return common::HOROVOD_INT64;
   case ::torch::kHalf:
     return common::HOROVOD_FLOAT16;
+#if TORCH_VERSION >= 1003000000
+  case ::torch::kBFloat16:
+    return common::HOROVOD_BFLOAT16;
+#endif
   case ::torch::kFloat:
     return common::HOROVOD_FLOAT32;
   case ::torch::kDouble:
     return common::HOROVOD_FLOAT64;
+#if TORCH_VERSION >= 1002000000
+  case ::torch::kBool:
+    return common::HOROVOD_BOOL;
+#endif
   default:
     throw std::logic_error("Invalid tensor type.");
   }
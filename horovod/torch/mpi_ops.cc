@@ -39,10 +39,24 @@ std::string GetOpName(const std::string& prefix, char* name, int handle) {
   return prefix + ".noname." + std::to_string(handle);
 }
 
+// Averages of floating point tensors in host memory are computed by the core,
+// which scales the sums as it copies them. Integer tensors keep the integer
+// division of DivideTensorInPlace, and tensors on GPU are divided on the
+// device.
+double GetPostscaleFactor(MPIDataType dtype, int average, int device) {
+  if (average && device == CPU_DEVICE_ID &&
+      (dtype == HOROVOD_FLOAT16 || dtype == HOROVOD_BFLOAT16 ||
+       dtype == HOROVOD_FLOAT32 || dtype == HOROVOD_FLOAT64)) {
+    return 1.0 / horovod_size();
+  }
+  return 1.0;
+}
+
 } // namespace
 
 template <MPIDataType DT, DeviceType Dev, class T>
-int DoAllreduce(T* tensor, T* output, int average, char* name) {
+int DoAllreduce(T* tensor, T* output, int average, char* name,
+                int priority, int reduce_op) {
   ThrowIfError(common::CheckInitialized());
 
   auto handle = handle_manager.AllocateHandle();
@@ -52,16 +66,19 @@ int DoAllreduce(T* tensor, T* output, int average, char* name) {
   auto hvd_context =
       std::make_shared<TorchOpContext<DT, Dev, T>>(device, output);
   auto hvd_output = std::make_shared<TorchTensor<DT, Dev, T>>(output);
+  auto postscale_factor = GetPostscaleFactor(DT, average, device);
+  bool divide = average && postscale_factor == 1.0;
 
   auto enqueue_result = EnqueueTensorAllreduce(
       hvd_context, hvd_tensor, hvd_output, ready_event,
       GetOpName("allreduce", name, handle), device,
-      [handle, average, output](const Status& status) {
-        if (average) {
+      [handle, divide, output](const Status& status) {
+        if (divide) {
           TensorUtil::DivideTensorInPlace<DT, Dev, T>(output, horovod_size());
         }
         handle_manager.MarkDone(handle, status);
-      });
+      },
+      priority, (common::ReduceOp)reduce_op, 1.0, postscale_factor);
   ThrowIfError(enqueue_result);
 
   return handle;
@@ -69,7 +86,8 @@ int DoAllreduce(T* tensor, T* output, int average, char* name) {
 
 #if HAVE_CUDA
 template <MPIDataType DT, class TC, class T>
-int DoAllreduceCudaOnCPU(TC* tensor, TC* output, int average, char* name) {
+int DoAllreduceCudaOnCPU(TC* tensor, TC* output, int average, char* name,
+                         int priority, int reduce_op) {
   ThrowIfError(common::CheckInitialized());
 
   // Make async copy of input tensor to CPU tensor and record completion event.
@@ -84,17 +102,20 @@ int DoAllreduceCudaOnCPU(TC* tensor, TC* output, int average, char* name) {
       CPU_DEVICE_ID, hvd_cpu_buffer->tensor());
 
   auto handle = handle_manager.AllocateHandle();
+  auto postscale_factor = GetPostscaleFactor(DT, average, CPU_DEVICE_ID);
+  bool divide = average && postscale_factor == 1.0;
   auto enqueue_result = EnqueueTensorAllreduce(
       hvd_context, hvd_cpu_buffer, hvd_cpu_buffer, ready_event,
       GetOpName("allreduce", name, handle), CPU_DEVICE_ID,
-      [handle, average, hvd_cpu_buffer, output](const Status& status) {
+      [handle, divide, hvd_cpu_buffer, output](const Status& status) {
         TensorUtil::CopyCPUToCuda<DT>(hvd_cpu_buffer->tensor(), output);
-        if (average) {
+        if (divide) {
           TensorUtil::DivideTensorInPlace<DT, DeviceType::GPU>(output,
                                                                horovod_size());
         }
         handle_manager.MarkDone(handle, status);
-      });
+      },
+      priority, (common::ReduceOp)reduce_op, 1.0, postscale_factor);
   ThrowIfError(enqueue_result);
 
   return handle;
@@ -218,9 +239,10 @@ int DoBroadcastCudaOnCPU(TC* tensor, TC* output, int root_rank, char* name) {
 
 #define ALLREDUCE(torch_Tensor, HorovodType, DeviceType, THTensor)             \
   extern "C" int horovod_torch_allreduce_async_##torch_Tensor(                 \
-      THTensor* tensor, THTensor* output, int average, char* name) {           \
+      THTensor* tensor, THTensor* output, int average, char* name,             \
+      int priority, int reduce_op) {                                           \
     return DoAllreduce<HorovodType, DeviceType>(tensor, output, average,       \
-                                                name);                         \
+                                                name, priority, reduce_op);    \
   }
 
 ALLREDUCE(torch_IntTensor, MPIDataType::HOROVOD_INT32, DeviceType::CPU,
@@ -245,9 +267,10 @@ ALLREDUCE(torch_cuda_DoubleTensor, MPIDataType::HOROVOD_FLOAT64,
 
 #define ALLREDUCE_CUDA_ON_CPU(torch_Tensor, HorovodType, THCTensor, THTensor)  \
   extern "C" int horovod_torch_allreduce_async_##torch_Tensor(                 \
-      THCTensor* tensor, THCTensor* output, int average, char* name) {         \
+      THCTensor* tensor, THCTensor* output, int average, char* name,           \
+      int priority, int reduce_op) {                                           \
     return DoAllreduceCudaOnCPU<HorovodType, THCTensor, THTensor>(             \
-        tensor, output, average, name);                                        \
+        tensor, output, average, name, priority, reduce_op);                   \
   }
 
 #if !HOROVOD_GPU_ALLREDUCE && HAVE_CUDA
@@ -36,6 +36,7 @@ else:
     _NULL = mpi_lib._ffi.NULL
     _basics = _HorovodBasics(__file__, 'mpi_lib_impl', '_mpi_lib_impl')
 
+from horovod.common import Sum, resolve_reduce_op
 from horovod.torch.compression import Compression
 
 # import basic methods
@@ -46,6 +47,10 @@ local_size = _basics.local_size
 rank = _basics.rank
 local_rank = _basics.local_rank
 mpi_threads_supported = _basics.mpi_threads_supported
+gpu_allreduce_built = _basics.gpu_allreduce_built
+collective_algorithm = _basics.collective_algorithm
+collective_algorithm_rules = _basics.collective_algorithm_rules
+set_collective_algorithm_rules = _basics.set_collective_algorithm_rules
 
 
 # Schema: handle -> input, output
@@ -70,20 +75,21 @@ def _allreduce_function_factory(tensor):
     return 'horovod_torch_allreduce_async_' + tensor.type().replace('.', '_')
 
 
-def _allreduce_async(tensor, output, average, name):
+def _allreduce_async(tensor, output, average, name, priority=0, op=Sum):
     if tensor.dtype == torch.float16 and not _fp16_supported:
         raise NotImplementedError(
             'float16 allreduce is not supported for PyTorch version {} < 1.0.0'
             .format(torch.__version__))
 
     function = _check_function(_allreduce_function_factory, tensor)
-    handle = getattr(mpi_lib, function)(tensor, output, average,
-                                        name.encode() if name is not None else _NULL)
+    handle = getattr(mpi_lib, function)(
+        tensor, output, average, name.encode() if name is not None else _NULL,
+        priority, op)
     _handle_map[handle] = (tensor, output)
     return handle
 
 
-def allreduce_async(tensor, average=True, name=None):
+def allreduce_async(tensor, average=None, name=None, priority=0, op=None):
     """
     A function that performs asynchronous averaging or summation of the input tensor
     over all the Horovod processes. The input tensor is not modified.
@@ -96,32 +102,46 @@ def allreduce_async(tensor, average=True, name=None):
     Arguments:
         tensor: A tensor to average and sum.
         average: A flag indicating whether to compute average or summation,
-                 defaults to average.
+                 defaults to average for sums. Only sums can be averaged.
         name: A name of the reduction operation.
+        priority: Tensors with a higher priority are reduced first once they
+                  are ready on all processes. Defaults to 0.
+        op: The reduction operation, one of Sum, Min, Max or Product, or
+            BitwiseAnd, BitwiseOr or BitwiseXor for integer and boolean
+            tensors. Booleans only support the bitwise operations. Defaults
+            to Sum.
 
     Returns:
         A handle to the allreduce operation that can be used with `poll()` or
         `synchronize()`.
     """
+    average, op = resolve_reduce_op(average, op)
     output = tensor.new(tensor.shape)
-    return _allreduce_async(tensor, output, average, name)
+    return _allreduce_async(tensor, output, average, name, priority, op)
 
 
 class HorovodAllreduce(torch.autograd.Function):
     """An autograd function that performs allreduce on a tensor."""
 
     @staticmethod
-    def forward(ctx, tensor, average, name):
+    def forward(ctx, tensor, average, name, priority, op):
         ctx.average = average
-        handle = allreduce_async(tensor, average, name)
+        ctx.priority = priority
+        ctx.op = op
+        handle = allreduce_async(tensor, average, name, priority, op)
         return synchronize(handle)
 
     @staticmethod
     def backward(ctx, grad_output):
-        return allreduce(grad_output, ctx.average), None, None
+        if ctx.op != Sum:
+            raise NotImplementedError(
+                'Only the gradient of a summation allreduce is implemented.')
+        return (allreduce(grad_output, ctx.average, priority=ctx.priority),
+                None, None, None, None)
 
 
-def allreduce(tensor, average=True, name=None, compression=Compression.none):
+def allreduce(tensor, average=None, name=None, compression=Compression.none,
+              priority=0, op=None):
     """
     A function that performs averaging or summation of the input tensor over all the
     Horovod processes. The input tensor is not modified.
@@ -138,22 +158,30 @@ def allreduce(tensor, average=True, name=None, compression=Compression.none):
     Arguments:
         tensor: A tensor to average and sum.
         average: A flag indicating whether to compute average or summation,
-                 defaults to average.
+                 defaults to average for sums. Only sums can be averaged.
         name: A name of the reduction operation.
         compression: Compression algorithm used during allreduce to reduce the amount
                      of data sent during the each parameter update step.  Defaults to
                      not using compression.
+        priority: Tensors with a higher priority are reduced first once they
+                  are ready on all processes. Defaults to 0.
+        op: The reduction operation, one of Sum, Min, Max or Product, or
+            BitwiseAnd, BitwiseOr or BitwiseXor for integer and boolean
+            tensors. Booleans only support the bitwise operations. Defaults
+            to Sum.
 
     Returns:
         A tensor of the same shape and type as `tensor`, averaged or summed across all
         processes.
     """
+    average, op = resolve_reduce_op(average, op)
     tensor_compressed, ctx = compression.compress(tensor)
-    summed_tensor_compressed = HorovodAllreduce.apply(tensor_compressed, average, name)
+    summed_tensor_compressed = HorovodAllreduce.apply(
+        tensor_compressed, average, name, priority, op)
     return compression.decompress(summed_tensor_compressed, ctx)
 
 
-def allreduce_async_(tensor, average=True, name=None):
+def allreduce_async_(tensor, average=None, name=None, priority=0, op=None):
     """
     A function that performs asynchronous in-place averaging or summation of the input
     tensor over all the Horovod processes.
@@ -166,17 +194,24 @@ def allreduce_async_(tensor, average=True, name=None):
     Arguments:
         tensor: A tensor to average and sum.
         average: A flag indicating whether to compute average or summation,
-                 defaults to average.
+                 defaults to average for sums. Only sums can be averaged.
         name: A name of the reduction operation.
+        priority: Tensors with a higher priority are reduced first once they
+                  are ready on all processes. Defaults to 0.
+        op: The reduction operation, one of Sum, Min, Max or Product, or
+            BitwiseAnd, BitwiseOr or BitwiseXor for integer and boolean
+            tensors. Booleans only support the bitwise operations. Defaults
+            to Sum.
 
     Returns:
         A handle to the allreduce operation that can be used with `poll()` or
         `synchronize()`.
     """
-    return _allreduce_async(tensor, tensor, average, name)
+    average, op = resolve_reduce_op(average, op)
+    return _allreduce_async(tensor, tensor, average, name, priority, op)
 
 
-def allreduce_(tensor, average=True, name=None):
+def allreduce_(tensor, average=None, name=None, priority=0, op=None):
     """
     A function that performs in-place averaging or summation of the input tensor over
     all the Horovod processes.
@@ -189,14 +224,20 @@ def allreduce_(tensor, average=True, name=None):
     Arguments:
         tensor: A tensor to average and sum.
         average: A flag indicating whether to compute average or summation,
-                 defaults to average.
+                 defaults to average for sums. Only sums can be averaged.
         name: A name of the reduction operation.
+        priority: Tensors with a higher priority are reduced first once they
+                  are ready on all processes. Defaults to 0.
+        op: The reduction operation, one of Sum, Min, Max or Product, or
+            BitwiseAnd, BitwiseOr or BitwiseXor for integer and boolean
+            tensors. Booleans only support the bitwise operations. Defaults
+            to Sum.
 
     Returns:
         A tensor of the same shape and type as `tensor`, averaged or summed across all
         processes.
     """
-    handle = allreduce_async_(tensor, average, name)
+    handle = allreduce_async_(tensor, average, name, priority, op)
     return synchronize(handle)
 
 
@@ -47,10 +47,22 @@ int GetDeviceID(const ::torch::Tensor& tensor) {
   return CPU_DEVICE_ID;
 }
 
+// Averages of floating point tensors in host memory are computed by the core,
+// which scales the sums as it copies them. Integer tensors keep the integer
+// division of div_, and tensors on GPU are divided on the device.
+double GetPostscaleFactor(const ::torch::Tensor& tensor, int average,
+                          int device) {
+  if (average && device == CPU_DEVICE_ID &&
+      ::torch::isFloatingType(tensor.scalar_type())) {
+    return 1.0 / horovod_size();
+  }
+  return 1.0;
+}
+
 } // namespace
 
 int DoAllreduce(::torch::Tensor tensor, ::torch::Tensor output, int average,
-                const std::string& name) {
+                const std::string& name, int priority, int reduce_op) {
   ThrowIfError(common::CheckInitialized());
 
   auto handle = handle_manager.AllocateHandle();
@@ -59,24 +71,28 @@ int DoAllreduce(::torch::Tensor tensor, ::torch::Tensor output, int average,
   auto hvd_tensor = std::make_shared<TorchTensor>(tensor);
   auto hvd_context = std::make_shared<TorchOpContext>(device, output);
   auto hvd_output = std::make_shared<TorchTensor>(output);
+  auto postscale_factor = GetPostscaleFactor(tensor, average, device);
+  bool divide = average && postscale_factor == 1.0;
 
   auto enqueue_result = EnqueueTensorAllreduce(
       hvd_context, hvd_tensor, hvd_output, ready_event,
       GetOpName("allreduce", name, handle), device,
-      [handle, average, output](const Status& status) mutable {
+      [handle, divide, output](const Status& status) mutable {
         // Will execute in the `device` context.
-        if (average) {
+        if (divide) {
           output.div_(horovod_size());
         }
         handle_manager.MarkDone(handle, status);
-      });
+      },
+      priority, (common::ReduceOp)reduce_op, 1.0, postscale_factor);
   ThrowIfError(enqueue_result);
 
   return handle;
 }
 
 int DoAllreduceCudaOnCPU(::torch::Tensor tensor, ::torch::Tensor output, int average,
-                         const std::string& name) {
+                         const std::string& name, int priority,
+                         int reduce_op) {
   ThrowIfError(common::CheckInitialized());
 
   // Make async copy of input tensor to CPU tensor and record completion event.
@@ -90,20 +106,24 @@ int DoAllreduceCudaOnCPU(::torch::Tensor tensor, ::torch::Tensor output, int ave
       std::make_shared<TorchOpContext>(CPU_DEVICE_ID, cpu_buffer);
 
   auto handle = handle_manager.AllocateHandle();
+  auto postscale_factor =
+      GetPostscaleFactor(cpu_buffer, average, CPU_DEVICE_ID);
+  bool divide = average && postscale_factor == 1.0;
   auto enqueue_result = EnqueueTensorAllreduce(
       hvd_context, hvd_cpu_buffer, hvd_cpu_buffer, ready_event,
       GetOpName("allreduce", name, handle), CPU_DEVICE_ID,
-      [handle, average, cpu_buffer, output,
+      [handle, divide, cpu_buffer, output,
        device](const Status& status) mutable {
         // Since the operation was on CPU, need to perform copy with the GPU
         // device guard.
         with_device device_guard(device);
         output.copy_(cpu_buffer);
-        if (average) {
+        if (divide) {
           output.div_(horovod_size());
         }
         handle_manager.MarkDone(handle, status);
-      });
+      },
+      priority, (common::ReduceOp)reduce_op, 1.0, postscale_factor);
   ThrowIfError(enqueue_result);
 
   return handle;
@@ -235,11 +255,32 @@ void WaitAndClear(int handle) {
 
 PYBIND11_MODULE(mpi_lib_v2, m) {
   // allreduce
+  m.def("horovod_torch_allreduce_async_torch_ByteTensor", &DoAllreduce);
+  m.def("horovod_torch_allreduce_async_torch_CharTensor", &DoAllreduce);
+  m.def("horovod_torch_allreduce_async_torch_ShortTensor", &DoAllreduce);
   m.def("horovod_torch_allreduce_async_torch_IntTensor", &DoAllreduce);
   m.def("horovod_torch_allreduce_async_torch_LongTensor", &DoAllreduce);
   m.def("horovod_torch_allreduce_async_torch_HalfTensor", &DoAllreduce);
   m.def("horovod_torch_allreduce_async_torch_FloatTensor", &DoAllreduce);
   m.def("horovod_torch_allreduce_async_torch_DoubleTensor", &DoAllreduce);
+#if TORCH_VERSION >= 1003000000
+  m.def("horovod_torch_allreduce_async_torch_BFloat16Tensor", &DoAllreduce);
+  // NCCL cannot reduce bfloat16, so GPU tensors are always reduced on the CPU.
+  m.def("horovod_torch_allreduce_async_torch_cuda_BFloat16Tensor",
+        &DoAllreduceCudaOnCPU);
+#endif
+  // Nor booleans and 8 or 16-bit integers.
+#if TORCH_VERSION >= 1002000000
+  m.def("horovod_torch_allreduce_async_torch_BoolTensor", &DoAllreduce);
+  m.def("horovod_torch_allreduce_async_torch_cuda_BoolTensor",
+        &DoAllreduceCudaOnCPU);
+#endif
+  m.def("horovod_torch_allreduce_async_torch_cuda_ByteTensor",
+        &DoAllreduceCudaOnCPU);
+  m.def("horovod_torch_allreduce_async_torch_cuda_CharTensor",
+        &DoAllreduceCudaOnCPU);
+  m.def("horovod_torch_allreduce_async_torch_cuda_ShortTensor",
+        &DoAllreduceCudaOnCPU);
 #if HOROVOD_GPU_ALLREDUCE
   m.def("horovod_torch_allreduce_async_torch_cuda_IntTensor", &DoAllreduce);
   m.def("horovod_torch_allreduce_async_torch_cuda_LongTensor", &DoAllreduce);
@@ -268,6 +309,9 @@ PYBIND11_MODULE(mpi_lib_v2, m) {
   m.def("horovod_torch_allgather_async_torch_HalfTensor", &DoAllgather);
   m.def("horovod_torch_allgather_async_torch_FloatTensor", &DoAllgather);
   m.def("horovod_torch_allgather_async_torch_DoubleTensor", &DoAllgather);
+#if TORCH_VERSION >= 1003000000
+  m.def("horovod_torch_allgather_async_torch_BFloat16Tensor", &DoAllgather);
+#endif
 #if HOROVOD_GPU_ALLGATHER
   m.def("horovod_torch_allgather_async_torch_cuda_ByteTensor", &DoAllgather);
   m.def("horovod_torch_allgather_async_torch_cuda_CharTensor", &DoAllgather);
@@ -277,6 +321,9 @@ PYBIND11_MODULE(mpi_lib_v2, m) {
   m.def("horovod_torch_allgather_async_torch_cuda_HalfTensor", &DoAllgather);
   m.def("horovod_torch_allgather_async_torch_cuda_FloatTensor", &DoAllgather);
   m.def("horovod_torch_allgather_async_torch_cuda_DoubleTensor", &DoAllgather);
+#if TORCH_VERSION >= 1003000000
+  m.def("horovod_torch_allgather_async_torch_cuda_BFloat16Tensor", &DoAllgather);
+#endif
 #else
   m.def("horovod_torch_allgather_async_torch_cuda_ByteTensor",
         &DoAllgatherCudaOnCPU);
@@ -294,6 +341,10 @@ PYBIND11_MODULE(mpi_lib_v2, m) {
         &DoAllgatherCudaOnCPU);
   m.def("horovod_torch_allgather_async_torch_cuda_DoubleTensor",
         &DoAllgatherCudaOnCPU);
+#if TORCH_VERSION >= 1003000000
+  m.def("horovod_torch_allgather_async_torch_cuda_BFloat16Tensor",
+        &DoAllgatherCudaOnCPU);
+#endif
 #endif
 
   // broadcast
@@ -305,6 +356,9 @@ PYBIND11_MODULE(mpi_lib_v2, m) {
   m.def("horovod_torch_broadcast_async_torch_HalfTensor", &DoBroadcast);
   m.def("horovod_torch_broadcast_async_torch_FloatTensor", &DoBroadcast);
   m.def("horovod_torch_broadcast_async_torch_DoubleTensor", &DoBroadcast);
+#if TORCH_VERSION >= 1003000000
+  m.def("horovod_torch_broadcast_async_torch_BFloat16Tensor", &DoBroadcast);
+#endif
 #if HOROVOD_GPU_BROADCAST
   m.def("horovod_torch_broadcast_async_torch_cuda_ByteTensor", &DoBroadcast);
   m.def("horovod_torch_broadcast_async_torch_cuda_CharTensor", &DoBroadcast);
@@ -314,6 +368,9 @@ PYBIND11_MODULE(mpi_lib_v2, m) {
   m.def("horovod_torch_broadcast_async_torch_cuda_HalfTensor", &DoBroadcast);
   m.def("horovod_torch_broadcast_async_torch_cuda_FloatTensor", &DoBroadcast);
   m.def("horovod_torch_broadcast_async_torch_cuda_DoubleTensor", &DoBroadcast);
+#if TORCH_VERSION >= 1003000000
+  m.def("horovod_torch_broadcast_async_torch_cuda_BFloat16Tensor", &DoBroadcast);
+#endif
 #else
   m.def("horovod_torch_broadcast_async_torch_cuda_ByteTensor",
         &DoBroadcastCudaOnCPU);
@@ -331,6 +388,10 @@ PYBIND11_MODULE(mpi_lib_v2, m) {
         &DoBroadcastCudaOnCPU);
   m.def("horovod_torch_broadcast_async_torch_cuda_DoubleTensor",
         &DoBroadcastCudaOnCPU);
+#if TORCH_VERSION >= 1003000000
+  m.def("horovod_torch_broadcast_async_torch_cuda_BFloat16Tensor",
+        &DoBroadcastCudaOnCPU);
+#endif
 #endif
 
   // basics
@@ -429,7 +429,15 @@ def get_common_options(build_ext):
     SOURCES = ['horovod/common/common.cc',
                'horovod/common/mpi_message.cc',
                'horovod/common/half.cc',
+               'horovod/common/memcpy_pool.cc',
                'horovod/common/operations.cc',
+               'horovod/common/reduction_kernels.cc',
+               'horovod/common/reduction_pool.cc',
+               'horovod/common/response_cache.cc',
+               'horovod/common/algorithm_registry.cc',
+               'horovod/common/allreduce_algorithms.cc',
+               'horovod/common/autotuner.cc',
+               'horovod/common/tensor_id_table.cc',
                'horovod/common/timeline.cc']
     COMPILE_FLAGS = cpp_flags + shlex.split(mpi_flags)
     LINK_FLAGS = link_flags + shlex.split(mpi_flags)
@@ -23,6 +23,7 @@ from __future__ import print_function
 import itertools
 import numpy as np
 import tensorflow as tf
+import time
 
 import horovod.tensorflow as hvd
 
@@ -53,6 +54,101 @@ class MPITests(tf.test.TestCase):
         size = hvd.size()
         assert true_size == size
 
+    def test_horovod_collective_algorithm(self):
+        """Test that collective operations use the algorithm of the first rule
+        that matches them, and the default algorithm without rules."""
+        hvd.init()
+        rules = hvd.collective_algorithm_rules()
+        try:
+            hvd.set_collective_algorithm_rules('')
+            assert hvd.collective_algorithm_rules() == ''
+            for op in ['allreduce', 'allgather', 'broadcast']:
+                algorithm = hvd.collective_algorithm(op, 'float32', 1024)
+                assert algorithm == 'default'
+
+            hvd.set_collective_algorithm_rules(
+                'op=allreduce device=cpu dtype=float32 bytes=-4096 '
+                'algorithm=recursive_doubling\n'
+                'op=allreduce device=cpu algorithm=ring')
+            chosen = [
+                (('allreduce', 'float32', 1024), 'recursive_doubling'),
+                (('allreduce', 'float32', 4096), 'ring'),
+                (('allreduce', 'float64', 1024), 'ring'),
+                (('allgather', 'float32', 1024), 'default'),
+                (('broadcast', 'float32', 1024), 'default'),
+            ]
+            for args, algorithm in chosen:
+                assert hvd.collective_algorithm(*args) == algorithm, \
+                    'hvd.collective_algorithm%s is not %s' % (args, algorithm)
+            assert hvd.collective_algorithm(
+                'allreduce', 'float32', 1024, device='gpu') == 'default'
+        finally:
+            hvd.set_collective_algorithm_rules(rules)
+
+    def test_horovod_collective_algorithm_error(self):
+        """Test that the algorithm of an unknown operation cannot be looked up,
+        and that invalid rules cannot be set."""
+        hvd.init()
+        try:
+            hvd.collective_algorithm('reducescatter', 'float32', 1024)
+            assert False, 'hvd.collective_algorithm did not throw error'
+        except ValueError:
+            pass
+
+        rules = hvd.collective_algorithm_rules()
+        try:
+            hvd.set_collective_algorithm_rules('op=allgather algorithm=ring')
+            assert False, \
+                'hvd.set_collective_algorithm_rules did not throw error'
+        except ValueError:
+            pass
+        assert hvd.collective_algorithm_rules() == rules
+
+    def check_allreduce_cpu_algorithm(self, algorithm):
+        """Check on CPU that allreduces that are forced to use the algorithm
+        sum tensors whose number of elements does not divide evenly by the
+        number of ranks, including tensors with fewer elements than ranks."""
+        hvd.init()
+        size = hvd.size()
+        rules = hvd.collective_algorithm_rules()
+        try:
+            hvd.set_collective_algorithm_rules(
+                'op=allreduce device=cpu algorithm=' + algorithm)
+            with self.test_session(config=self.config) as session:
+                dtypes = [tf.int32, tf.int64, tf.float32, tf.float64]
+                counts = [1, max(size - 1, 1), size + 1, 3 * size + 1, 100003]
+                for dtype, count in itertools.product(dtypes, counts):
+                    num_bytes = count * dtype.size
+                    self.assertEqual(hvd.collective_algorithm(
+                        'allreduce', dtype.name, num_bytes), algorithm)
+                    with tf.device("/cpu:0"):
+                        tf.set_random_seed(1234)
+                        tensor = tf.random_uniform(
+                            [count], -100, 100, dtype=tf.int32)
+                        tensor = tf.cast(tensor, dtype)
+                        summed = hvd.allreduce(tensor, average=False)
+                    max_difference = tf.reduce_max(
+                        tf.abs(summed - tensor * size))
+                    # Run each allreduce on its own, so that it is not fused
+                    # with others into a size that does divide evenly.
+                    diff = session.run(max_difference)
+                    self.assertTrue(diff == 0,
+                                    "hvd.allreduce with %s produces "
+                                    "incorrect results" % algorithm)
+        finally:
+            hvd.set_collective_algorithm_rules(rules)
+
+    def test_horovod_allreduce_cpu_ring(self):
+        """Test on CPU that the ring allreduce correctly sums tensors of sizes
+        that do not divide evenly by the number of ranks."""
+        self.check_allreduce_cpu_algorithm('ring')
+
+    def test_horovod_allreduce_cpu_recursive_doubling(self):
+        """Test on CPU that the recursive doubling allreduce correctly sums
+        tensors of sizes that do not divide evenly by the number of ranks. CI
+        also runs this test on 3 ranks, which are not a power of two."""
+        self.check_allreduce_cpu_algorithm('recursive_doubling')
+
     def test_horovod_allreduce_cpu(self):
         """Test on CPU that the allreduce correctly sums 1D, 2D, 3D tensors."""
         hvd.init()
@@ -84,6 +180,28 @@ class MPITests(tf.test.TestCase):
                 self.assertTrue(diff <= threshold,
                                 "hvd.allreduce produces incorrect results")
 
+    def test_horovod_allreduce_cpu_bfloat16(self):
+        """Test on CPU that the allreduce correctly sums bfloat16 tensors."""
+        hvd.init()
+        size = hvd.size()
+        # Integer sums below 256 are exact in bfloat16.
+        if size > 25:
+            return
+        with self.test_session(config=self.config) as session:
+            dims = [1, 2, 3]
+            for dim in dims:
+                with tf.device("/cpu:0"):
+                    tf.set_random_seed(1234)
+                    tensor = tf.round(tf.random_uniform(
+                        [17] * dim, -10, 10, dtype=tf.float32))
+                    summed = hvd.allreduce(tf.cast(tensor, tf.bfloat16),
+                                           average=False)
+                    summed = tf.cast(summed, tf.float32)
+                max_difference = tf.reduce_max(tf.abs(summed - tensor * size))
+                diff = session.run(max_difference)
+                self.assertTrue(diff == 0,
+                                "hvd.allreduce produces incorrect results")
+
     def test_horovod_allreduce_cpu_fused(self):
         """Test on CPU that the allreduce correctly sums 1D, 2D, 3D tensors
         with Tensor Fusion."""
@@ -118,6 +236,192 @@ class MPITests(tf.test.TestCase):
             self.assertTrue(session.run(tf.reduce_all(tests)),
                             "hvd.allreduce produces incorrect results")
 
+    def test_horovod_allreduce_cpu_response_cache(self):
+        """Test on CPU that an allreduce repeated across steps, which hits the
+        response cache, sums correctly, and that changing the shape of its
+        tensor renegotiates it. CI also runs this test with
+        HOROVOD_CACHE_CAPACITY=0."""
+        hvd.init()
+        size = hvd.size()
+        with self.test_session(config=self.config) as session:
+            with tf.device("/cpu:0"):
+                tensor = tf.placeholder(tf.float32)
+                summed = hvd.allreduce(tensor, average=False)
+            shapes = [[17, 17]] * 3 + [[17, 5], [3], [17, 17], [17, 17]]
+            for step, shape in enumerate(shapes):
+                np.random.seed(1234 + step)
+                value = np.random.randint(-100, 100, size=shape)
+                value = value.astype(np.float32)
+                result = session.run(summed, feed_dict={tensor: value})
+                self.assertTrue(np.array_equal(result, value * size),
+                                "hvd.allreduce produces incorrect results")
+
+    def test_horovod_allreduce_cpu_priority(self):
+        """Test on CPU that the allreduce correctly sums tensors submitted with
+        different priorities."""
+        hvd.init()
+        size = hvd.size()
+        with self.test_session(config=self.config) as session:
+            tests = []
+            for priority in range(-4, 5):
+                with tf.device("/cpu:0"):
+                    tf.set_random_seed(1234)
+                    tensor = tf.random_uniform(
+                        [17, 17], -100, 100, dtype=tf.int32)
+                    summed = hvd.allreduce(tensor, average=False,
+                                           priority=priority)
+                multiplied = tensor * size
+                max_difference = tf.reduce_max(tf.abs(summed - multiplied))
+                tests.append(max_difference <= 0)
+            self.assertTrue(session.run(tf.reduce_all(tests)),
+                            "hvd.allreduce produces incorrect results")
+
+    def test_horovod_allreduce_cpu_priority_order(self):
+        """Test on CPU that an allreduce with a higher priority is performed
+        before allreduces that are ready at the same time."""
+        hvd.init()
+        # Tensors of different data types are not fused, so each one is
+        # reduced on its own and takes long enough for the order in which they
+        # complete to be observed. The allreduces of a trial may become ready in
+        # different cycles, so the order is checked over a few trials, on whose
+        # outcome all ranks agree.
+        dtypes = [tf.int32, tf.int64, tf.float64, tf.float32]
+        with self.test_session(config=self.config) as session:
+            completion_times = []
+            with tf.device("/cpu:0"):
+                for i, dtype in enumerate(dtypes):
+                    tensor = tf.ones([1 << 20], dtype=dtype)
+                    priority = 1 if i == len(dtypes) - 1 else 0
+                    summed = hvd.allreduce(tensor, average=False,
+                                           priority=priority)
+                    completion_times.append(tf.py_func(
+                        lambda _: np.float64(time.time()), [summed],
+                        tf.float64))
+                high_first = tf.reduce_all(
+                    [completion_times[-1] <= t for t in completion_times[:-1]])
+                high_first = hvd.allreduce(tf.cast(high_first, tf.int32),
+                                           op=hvd.Min)
+            for trial in range(3):
+                result = session.run(high_first)
+                if result:
+                    break
+            self.assertTrue(result,
+                            "hvd.allreduce does not perform tensors with a "
+                            "higher priority first")
+
+    def test_horovod_allreduce_cpu_min_max_product(self):
+        """Test on CPU that the allreduce correctly computes the minimum,
+        maximum and product of tensors."""
+        hvd.init()
+        rank = hvd.rank()
+        size = hvd.size()
+        with self.test_session(config=self.config) as session:
+            dtypes = [tf.int32, tf.int64, tf.float32, tf.float64]
+            tests = []
+            for dtype in dtypes:
+                with tf.device("/cpu:0"):
+                    tensor = tf.fill([17, 17], tf.cast(rank + 1, dtype))
+                    minimum = hvd.allreduce(tensor, op=hvd.Min)
+                    maximum = hvd.allreduce(tensor, op=hvd.Max)
+                tests.append(tf.reduce_all(tf.equal(minimum, 1)))
+                tests.append(tf.reduce_all(tf.equal(maximum, size)))
+                # Factorials are exact in all data types up to 10 ranks.
+                if size <= 10:
+                    with tf.device("/cpu:0"):
+                        product = hvd.allreduce(tensor, op=hvd.Product)
+                    expected = 1
+                    for r in range(size):
+                        expected *= r + 1
+                    tests.append(tf.reduce_all(tf.equal(product, expected)))
+            self.assertTrue(session.run(tf.reduce_all(tests)),
+                            "hvd.allreduce produces incorrect results")
+
+    def test_horovod_allreduce_cpu_bitwise(self):
+        """Test on CPU that the allreduce correctly computes the bitwise and,
+        or and xor of integer tensors."""
+        hvd.init()
+        rank = hvd.rank()
+        size = hvd.size()
+        # Values fit in the smallest signed integer type.
+        dtypes = {tf.uint8: 7, tf.int8: 7, tf.int16: 15, tf.int32: 31,
+                  tf.int64: 31}
+        with self.test_session(config=self.config) as session:
+            tests = []
+            for dtype, bits in dtypes.items():
+                values = [(1 << (r % (bits - 1))) | (1 << (bits - 1))
+                          for r in range(size)]
+                expected_and, expected_or, expected_xor = values[0], 0, 0
+                for value in values:
+                    expected_and &= value
+                    expected_or |= value
+                    expected_xor ^= value
+                with tf.device("/cpu:0"):
+                    tensor = tf.fill([17, 17], tf.constant(values[rank], dtype))
+                    reduced_and = hvd.allreduce(tensor, op=hvd.BitwiseAnd)
+                    reduced_or = hvd.allreduce(tensor, op=hvd.BitwiseOr)
+                    reduced_xor = hvd.allreduce(tensor, op=hvd.BitwiseXor)
+                tests.append(tf.reduce_all(tf.equal(reduced_and, expected_and)))
+                tests.append(tf.reduce_all(tf.equal(reduced_or, expected_or)))
+                tests.append(tf.reduce_all(tf.equal(reduced_xor, expected_xor)))
+            self.assertTrue(session.run(tf.reduce_all(tests)),
+                            "hvd.allreduce produces incorrect results")
+
+    def test_horovod_allreduce_cpu_bool(self):
+        """Test on CPU that the allreduce correctly computes the logical and,
+        or and xor of boolean tensors, and rejects arithmetic operations on
+        them."""
+        hvd.init()
+        rank = hvd.rank()
+        size = hvd.size()
+        with self.test_session(config=self.config) as session:
+            values = [[r % 2 == 0, r % 3 == 0, True, False]
+                      for r in range(size)]
+            expected_and = [all(column) for column in zip(*values)]
+            expected_or = [any(column) for column in zip(*values)]
+            expected_xor = [sum(column) % 2 == 1 for column in zip(*values)]
+            with tf.device("/cpu:0"):
+                tensor = tf.constant(values[rank], dtype=tf.bool)
+                reduced_and = hvd.allreduce(tensor, op=hvd.BitwiseAnd)
+                reduced_or = hvd.allreduce(tensor, op=hvd.BitwiseOr)
+                reduced_xor = hvd.allreduce(tensor, op=hvd.BitwiseXor)
+            tests = [tf.reduce_all(tf.equal(reduced_and, expected_and)),
+                     tf.reduce_all(tf.equal(reduced_or, expected_or)),
+                     tf.reduce_all(tf.equal(reduced_xor, expected_xor))]
+            self.assertTrue(session.run(tf.reduce_all(tests)),
+                            "hvd.allreduce produces incorrect results")
+
+            with tf.device("/cpu:0"):
+                summed = hvd.allreduce(tensor, average=False)
+            with self.assertRaises(tf.errors.InvalidArgumentError):
+                session.run(summed)
+
+    def test_horovod_allreduce_cpu_scaled(self):
+        """Test on CPU that the allreduce correctly averages tensors and
+        applies prescale and postscale factors."""
+        hvd.init()
+        rank = hvd.rank()
+        size = hvd.size()
+        # The sums must be exact in float16.
+        if size > 40:
+            return
+        with self.test_session(config=self.config) as session:
+            tests = []
+            for dtype in [tf.float16, tf.float32, tf.float64]:
+                with tf.device("/cpu:0"):
+                    tensor = tf.fill([17, 17], tf.cast(rank + 1, dtype))
+                    averaged = hvd.allreduce(tensor, average=True)
+                    scaled = hvd._allreduce(tensor, prescale_factor=2.0,
+                                            postscale_factor=0.25)
+                expected = (size + 1) / 2.0
+                tests.append(tf.reduce_all(tf.less_equal(
+                    tf.abs(tf.cast(averaged, tf.float64) - expected),
+                    1e-3 * expected)))
+                expected = size * (size + 1) / 4.0
+                tests.append(tf.reduce_all(tf.equal(
+                    tf.cast(scaled, tf.float64), expected)))
+            self.assertTrue(session.run(tf.reduce_all(tests)),
+                            "hvd.allreduce produces incorrect results")
+
     def test_horovod_allreduce_gpu(self):
         """Test that the allreduce works on GPUs.
 
@@ -294,6 +598,30 @@ class MPITests(tf.test.TestCase):
             with self.assertRaises(tf.errors.FailedPreconditionError):
                 session.run(hvd.allreduce(tensor))
 
+    def test_horovod_allreduce_op_error(self):
+        """Test that the allreduce raises an error if different ranks try to
+        reduce a tensor with different operations, or if the operation does not
+        apply to the tensor."""
+        hvd.init()
+        rank = hvd.rank()
+        size = hvd.size()
+
+        with self.test_session(config=self.config) as session:
+            tensor = tf.ones([17] * 3, dtype=tf.float32)
+            with self.assertRaises(tf.errors.InvalidArgumentError):
+                session.run(hvd.allreduce(tensor, op=hvd.BitwiseAnd))
+
+            with self.assertRaises(ValueError):
+                hvd.allreduce(tensor, average=True, op=hvd.Max)
+
+            # This test does not apply if there is only one worker.
+            if size == 1:
+                return
+
+            op = hvd.Min if rank % 2 == 0 else hvd.Max
+            with self.assertRaises(tf.errors.FailedPreconditionError):
+                session.run(hvd.allreduce(tensor, op=op))
+
     def test_horovod_allreduce_cpu_gpu_error(self):
         """Test that the allreduce raises an error if different ranks try to
         perform reduction on CPU and GPU."""
@@ -431,6 +759,50 @@ class MPITests(tf.test.TestCase):
                             tf.equal(tf.cast(rank_tensor, tf.int32), value))),
                         "hvd.allgather produces incorrect gathered tensor")
 
+    def test_horovod_allgather_fused(self):
+        """Test that the allgather correctly gathers tensors of different data
+        types and sizes along the first dim that are gathered together, so
+        that they are fused."""
+        hvd.init()
+        rank = hvd.rank()
+        size = hvd.size()
+
+        def rows(rank, first_dim, dim):
+            # Row j of rank r holds r * 10 + j, so that misplaced rows are
+            # detected.
+            values = np.arange(first_dim, dtype=np.float64) + rank * 10
+            values = values.reshape([first_dim] + [1] * (dim - 1))
+            return np.broadcast_to(values, [first_dim] + [17] * (dim - 1))
+
+        with self.test_session(config=self.config) as session:
+            dtypes = [tf.uint8, tf.int32, tf.int64, tf.float16, tf.float32,
+                      tf.float64]
+            dims = [1, 2, 3]
+            tests = []
+            gathered = []
+            for i, (dtype, dim) in enumerate(itertools.product(dtypes, dims)):
+                # Every rank gathers a different number of rows.
+                first_dims = [r + 1 + i % 3 for r in range(size)]
+                tensor = tf.constant(rows(rank, first_dims[rank], dim),
+                                     dtype=dtype)
+                tests.append((first_dims, dim))
+                gathered.append(hvd.allgather(tensor))
+
+            # All allgathers run together, so that they are fused.
+            gathered_tensors = session.run(gathered)
+            for (first_dims, dim), gathered_tensor in zip(tests,
+                                                          gathered_tensors):
+                self.assertEqual(list(gathered_tensor.shape),
+                                 [sum(first_dims)] + [17] * (dim - 1))
+                offset = 0
+                for r, first_dim in enumerate(first_dims):
+                    rank_tensor = gathered_tensor[offset:offset + first_dim]
+                    self.assertTrue(
+                        np.array_equal(rank_tensor.astype(np.float64),
+                                       rows(r, first_dim, dim)),
+                        "hvd.allgather produces incorrect gathered tensor")
+                    offset += first_dim
+
     def test_horovod_allgather_error(self):
         """Test that the allgather returns an error if any dimension besides
         the first is different among the tensors being gathered."""
@@ -536,6 +908,41 @@ class MPITests(tf.test.TestCase):
                         tf.cast(root_tensor, tf.int32), tf.cast(broadcasted_tensor, tf.int32)))),
                     "hvd.broadcast produces incorrect broadcasted tensor")
 
+    def test_horovod_allreduce_broadcast_cpu_in_flight(self):
+        """Test on CPU that many fused allreduces and broadcasts that run
+        together produce correct results. CI also runs this test with
+        HOROVOD_MAX_IN_FLIGHT and HOROVOD_NUM_FUSION_BUFFERS set, so that
+        several fused operations are in flight at the same time."""
+        hvd.init()
+        rank = hvd.rank()
+        size = hvd.size()
+        with self.test_session(config=self.config) as session:
+            # Tensors of different data types and broadcasts from different
+            # root ranks are fused into different operations.
+            dtypes = [tf.int32, tf.int64, tf.float32, tf.float64]
+            tests = []
+            for i in range(10):
+                for j, dtype in enumerate(dtypes):
+                    with tf.device("/cpu:0"):
+                        tf.set_random_seed(1234 + i)
+                        tensor = tf.random_uniform(
+                            [17 + i, 3], -100, 100, dtype=tf.int32)
+                        tensor = tf.cast(tensor, dtype)
+                        summed = hvd.allreduce(tensor, average=False)
+                        root_rank = (i + j) % size
+                        broadcasted = hvd.broadcast(
+                            tf.cast(tf.fill([17 + i, 3], rank), dtype),
+                            root_rank)
+                    tests.append(tf.reduce_all(tf.equal(summed,
+                                                        tensor * size)))
+                    tests.append(tf.reduce_all(tf.equal(
+                        broadcasted, tf.cast(root_rank, dtype))))
+            # All operations run together, so that they are outstanding at
+            # once.
+            self.assertTrue(session.run(tf.reduce_all(tests)),
+                            "hvd.allreduce or hvd.broadcast produces "
+                            "incorrect results")
+
     def test_horovod_broadcast_error(self):
         """Test that the broadcast returns an error if any dimension besides
         the first is different among the tensors being broadcasted."""
@@ -33,6 +33,8 @@ import horovod.torch as hvd
 from common import mpi_env_rank_and_size
 
 _fp16_supported = LooseVersion(torch.__version__) >= LooseVersion('1.0.0')
+_bf16_supported = LooseVersion(torch.__version__) >= LooseVersion('1.3.0')
+_bool_supported = LooseVersion(torch.__version__) >= LooseVersion('1.2.0')
 
 
 class TorchTests(unittest.TestCase):
@@ -51,6 +53,14 @@ class TorchTests(unittest.TestCase):
                 result.append(value)
         return result
 
+    def allgather_rows(self, rank, first_dim, dim):
+        # Tensor of first_dim rows of 17^(dim - 1) elements, in which row j
+        # holds rank * 10 + j.
+        rows = torch.arange(0, first_dim).float().add(rank * 10)
+        shape = [first_dim] + [17] * (dim - 1)
+        return rows.view(*([first_dim] + [1] * (dim - 1))).expand(
+            *shape).contiguous()
+
     def test_horovod_rank(self):
         """Test that the rank returned by hvd.rank() is correct."""
         true_rank, _ = mpi_env_rank_and_size()
@@ -65,6 +75,96 @@ class TorchTests(unittest.TestCase):
         size = hvd.size()
         assert true_size == size
 
+    def test_horovod_collective_algorithm(self):
+        """Test that collective operations use the algorithm of the first rule
+        that matches them, and the default algorithm without rules."""
+        hvd.init()
+        rules = hvd.collective_algorithm_rules()
+        try:
+            hvd.set_collective_algorithm_rules('')
+            assert hvd.collective_algorithm_rules() == ''
+            for op in ['allreduce', 'allgather', 'broadcast']:
+                algorithm = hvd.collective_algorithm(op, 'float32', 1024)
+                assert algorithm == 'default'
+
+            hvd.set_collective_algorithm_rules(
+                'op=allreduce device=cpu dtype=float32 bytes=-4096 '
+                'algorithm=recursive_doubling\n'
+                'op=allreduce device=cpu algorithm=ring')
+            chosen = [
+                (('allreduce', 'float32', 1024), 'recursive_doubling'),
+                (('allreduce', 'float32', 4096), 'ring'),
+                (('allreduce', 'float64', 1024), 'ring'),
+                (('allgather', 'float32', 1024), 'default'),
+                (('broadcast', 'float32', 1024), 'default'),
+            ]
+            for args, algorithm in chosen:
+                assert hvd.collective_algorithm(*args) == algorithm, \
+                    'hvd.collective_algorithm%s is not %s' % (args, algorithm)
+            assert hvd.collective_algorithm(
+                'allreduce', 'float32', 1024, device='gpu') == 'default'
+        finally:
+            hvd.set_collective_algorithm_rules(rules)
+
+    def test_horovod_collective_algorithm_error(self):
+        """Test that the algorithm of an unknown operation cannot be looked up,
+        and that invalid rules cannot be set."""
+        hvd.init()
+        try:
+            hvd.collective_algorithm('reducescatter', 'float32', 1024)
+            assert False, 'hvd.collective_algorithm did not throw error'
+        except ValueError:
+            pass
+
+        rules = hvd.collective_algorithm_rules()
+        try:
+            hvd.set_collective_algorithm_rules('op=allgather algorithm=ring')
+            assert False, \
+                'hvd.set_collective_algorithm_rules did not throw error'
+        except ValueError:
+            pass
+        assert hvd.collective_algorithm_rules() == rules
+
+    def check_allreduce_algorithm(self, algorithm):
+        """Check that allreduces that are forced to use the algorithm sum
+        tensors whose number of elements does not divide evenly by the number
+        of ranks, including tensors with fewer elements than ranks."""
+        hvd.init()
+        size = hvd.size()
+        rules = hvd.collective_algorithm_rules()
+        try:
+            hvd.set_collective_algorithm_rules(
+                'op=allreduce device=cpu algorithm=' + algorithm)
+            dtypes = [torch.IntTensor, torch.LongTensor,
+                      torch.FloatTensor, torch.DoubleTensor]
+            counts = [1, max(size - 1, 1), size + 1, 3 * size + 1, 100003]
+            for dtype, count in itertools.product(dtypes, counts):
+                torch.manual_seed(1234)
+                tensor = torch.FloatTensor(count).random_(-100, 100)
+                tensor = tensor.type(dtype)
+                num_bytes = tensor.numel() * tensor.element_size()
+                dtype_name = str(tensor.numpy().dtype)
+                assert hvd.collective_algorithm(
+                    'allreduce', dtype_name, num_bytes) == algorithm
+                summed = hvd.allreduce(tensor, average=False)
+                max_difference = summed.sub(tensor * size).abs().max()
+                assert max_difference == 0, \
+                    'hvd.allreduce with %s produces incorrect results' % \
+                    algorithm
+        finally:
+            hvd.set_collective_algorithm_rules(rules)
+
+    def test_horovod_allreduce_ring(self):
+        """Test that the ring allreduce correctly sums tensors of sizes that
+        do not divide evenly by the number of ranks."""
+        self.check_allreduce_algorithm('ring')
+
+    def test_horovod_allreduce_recursive_doubling(self):
+        """Test that the recursive doubling allreduce correctly sums tensors of
+        sizes that do not divide evenly by the number of ranks. CI also runs
+        this test on 3 ranks, which are not a power of two."""
+        self.check_allreduce_algorithm('recursive_doubling')
+
     def test_horovod_allreduce(self):
         """Test that the allreduce correctly sums 1D, 2D, 3D tensors."""
         hvd.init()
@@ -102,6 +202,115 @@ class TorchTests(unittest.TestCase):
 
             assert max_difference <= threshold, 'hvd.allreduce produces incorrect results'
 
+    def test_horovod_allreduce_bfloat16(self):
+        """Test that the allreduce correctly sums bfloat16 tensors."""
+        if not _bf16_supported:
+            return
+        hvd.init()
+        size = hvd.size()
+        # Integer sums below 256 are exact in bfloat16.
+        if size > 25:
+            return
+        devices = ['cpu']
+        if torch.cuda.is_available():
+            devices += ['cuda']
+        dims = [1, 2, 3]
+        for device, dim in itertools.product(devices, dims):
+            torch.manual_seed(1234)
+            tensor = torch.FloatTensor(*([17] * dim)).random_(-10, 10)
+            tensor = tensor.to(device=device, dtype=torch.bfloat16)
+            summed = hvd.allreduce(tensor, average=False)
+            assert summed.dtype == torch.bfloat16
+            max_difference = summed.float().sub(tensor.float() * size).abs().max()
+            assert max_difference == 0, 'hvd.allreduce produces incorrect results'
+
+    def test_horovod_allreduce_min_max_product(self):
+        """Test that the allreduce correctly computes the minimum, maximum and
+        product of tensors."""
+        hvd.init()
+        rank = hvd.rank()
+        size = hvd.size()
+        dtypes = [torch.IntTensor, torch.LongTensor,
+                  torch.FloatTensor, torch.DoubleTensor]
+        if torch.cuda.is_available():
+            dtypes += [torch.cuda.IntTensor, torch.cuda.LongTensor,
+                       torch.cuda.FloatTensor, torch.cuda.DoubleTensor]
+        ops = [(hvd.Min, torch.min), (hvd.Max, torch.max),
+               (hvd.Product, torch.prod)]
+        for dtype, (op, reduce_fn) in itertools.product(dtypes, ops):
+            # Products of values in [1, 3) are exact on up to 20 ranks.
+            if op == hvd.Product and size > 20:
+                continue
+            tensors = []
+            for r in range(size):
+                torch.manual_seed(1234 + r)
+                tensors.append(torch.FloatTensor(17, 17).random_(1, 3))
+            expected = reduce_fn(torch.stack(tensors), 0)
+            if isinstance(expected, tuple):
+                expected = expected[0]
+            reduced = hvd.allreduce(tensors[rank].type(dtype), op=op)
+            assert torch.equal(reduced.cpu().float(), expected), \
+                'hvd.allreduce produces incorrect results'
+
+    def test_horovod_allreduce_bitwise(self):
+        """Test that the allreduce correctly computes the bitwise and, or and
+        xor of integer tensors."""
+        hvd.init()
+        rank = hvd.rank()
+        size = hvd.size()
+        # Values fit in the smallest signed integer type.
+        dtypes = {torch.ByteTensor: 7, torch.CharTensor: 7,
+                  torch.ShortTensor: 15, torch.IntTensor: 20,
+                  torch.LongTensor: 20}
+        ops = [(hvd.BitwiseAnd, lambda a, b: a & b),
+               (hvd.BitwiseOr, lambda a, b: a | b),
+               (hvd.BitwiseXor, lambda a, b: a ^ b)]
+        for dtype, (op, reduce_fn) in itertools.product(dtypes, ops):
+            tensors = []
+            for r in range(size):
+                torch.manual_seed(1234 + r)
+                tensors.append(torch.LongTensor(17, 17).random_(
+                    0, 1 << dtypes[dtype]))
+            expected = tensors[0]
+            for tensor in tensors[1:]:
+                expected = reduce_fn(expected, tensor)
+            reduced = hvd.allreduce(tensors[rank].type(dtype), op=op)
+            assert torch.equal(reduced.long(), expected), \
+                'hvd.allreduce produces incorrect results'
+
+    def test_horovod_allreduce_bool(self):
+        """Test that the allreduce correctly computes the logical and, or and
+        xor of boolean tensors, and rejects arithmetic operations on them."""
+        if not _bool_supported:
+            return
+        hvd.init()
+        rank = hvd.rank()
+        size = hvd.size()
+        devices = ['cpu']
+        if torch.cuda.is_available():
+            devices += ['cuda']
+        ops = [(hvd.BitwiseAnd, lambda a, b: a & b),
+               (hvd.BitwiseOr, lambda a, b: a | b),
+               (hvd.BitwiseXor, lambda a, b: a ^ b)]
+        tensors = []
+        for r in range(size):
+            torch.manual_seed(1234 + r)
+            tensors.append(torch.LongTensor(17, 17).random_(0, 2).bool())
+        for device, (op, reduce_fn) in itertools.product(devices, ops):
+            expected = tensors[0]
+            for tensor in tensors[1:]:
+                expected = reduce_fn(expected, tensor)
+            reduced = hvd.allreduce(tensors[rank].to(device), op=op)
+            assert reduced.dtype == torch.bool
+            assert torch.equal(reduced.cpu(), expected), \
+                'hvd.allreduce produces incorrect results'
+
+        try:
+            hvd.allreduce(tensors[rank], average=False)
+            assert False, 'hvd.allreduce did not throw error'
+        except (torch.FatalError, RuntimeError):
+            pass
+
     def test_horovod_allreduce_average(self):
         """Test that the allreduce correctly sums 1D, 2D, 3D tensors."""
         hvd.init()
@@ -222,6 +431,122 @@ class TorchTests(unittest.TestCase):
 
             assert max_difference <= threshold, 'hvd.allreduce produces incorrect results'
 
+    def test_horovod_allreduce_async_fused_average(self):
+        """Test that the allreduce correctly averages CPU tensors with Tensor
+        Fusion, which scales them as they are copied out of the fusion
+        buffer."""
+        hvd.init()
+        rank = hvd.rank()
+        size = hvd.size()
+        # The sums must not overflow float16.
+        if size > 30:
+            return
+        dtypes = [torch.FloatTensor, torch.DoubleTensor]
+        if _fp16_supported:
+            dtypes += [torch.HalfTensor]
+        dims = [1, 2, 3]
+        tests = []
+        for dtype, dim in itertools.product(dtypes, dims):
+            torch.manual_seed(1234)
+            tensor = torch.FloatTensor(*([17] * dim)).random_(-100, 100)
+            expected = tensor * (size + 1) / 2.0
+            tensor = (tensor * (rank + 1)).type(dtype)
+            handle = hvd.allreduce_async(tensor, average=True)
+            tests.append((expected, handle))
+
+        for expected, handle in tests:
+            averaged = hvd.synchronize(handle)
+            averaged, = self.convert_cpu_fp16_to_fp32(averaged)
+            max_difference = averaged.float().sub(expected).abs().max()
+            threshold = 1e-3 * expected.abs().max()
+            assert max_difference <= threshold, 'hvd.allreduce produces incorrect results'
+
+    def test_horovod_allreduce_response_cache(self):
+        """Test that allreduces repeated under the same names, which hit the
+        response cache, sum correctly, and that changing the shape or data
+        type of a tensor under the same name renegotiates it. CI also runs
+        this test with HOROVOD_CACHE_CAPACITY=0."""
+        hvd.init()
+        size = hvd.size()
+        steps = [([17, 17], torch.FloatTensor)] * 3 + [
+            ([17, 5], torch.FloatTensor), ([17, 5], torch.DoubleTensor),
+            ([17, 17], torch.FloatTensor), ([17, 17], torch.FloatTensor)]
+        for step, (shape, dtype) in enumerate(steps):
+            torch.manual_seed(1234 + step)
+            tests = []
+            # Only the first tensor changes shape and data type, and the
+            # others keep hitting the cache.
+            for i in range(3):
+                tensor_shape, tensor_dtype = ((shape, dtype) if i == 0 else
+                                              ([17, 17], torch.FloatTensor))
+                tensor = torch.FloatTensor(*tensor_shape).random_(-100, 100)
+                tensor = tensor.type(tensor_dtype)
+                handle = hvd.allreduce_async(tensor, average=False,
+                                             name='response_cache.%d' % i)
+                tests.append((tensor * size, handle))
+
+            for multiplied, handle in tests:
+                summed = hvd.synchronize(handle)
+                assert list(summed.shape) == list(multiplied.shape), \
+                    'hvd.allreduce produces incorrect shape'
+                assert summed.type() == multiplied.type(), \
+                    'hvd.allreduce produces incorrect data type'
+                max_difference = summed.sub(multiplied).abs().max()
+                assert max_difference == 0, \
+                    'hvd.allreduce produces incorrect results'
+
+    def test_horovod_allreduce_async_priority(self):
+        """Test that the allreduce correctly sums tensors submitted with
+        different priorities."""
+        hvd.init()
+        size = hvd.size()
+        tests = []
+        for priority in range(-4, 5):
+            torch.manual_seed(1234)
+            tensor = torch.IntTensor(17, 17).random_(-100, 100)
+            handle = hvd.allreduce_async(tensor, average=False,
+                                         name='priority.%d' % priority,
+                                         priority=priority)
+            tests.append((tensor * size, handle))
+
+        for multiplied, handle in tests:
+            summed = hvd.synchronize(handle)
+            max_difference = summed.sub(multiplied).max()
+            assert max_difference == 0, 'hvd.allreduce produces incorrect results'
+
+    def test_horovod_allreduce_async_priority_order(self):
+        """Test that an allreduce with a higher priority submitted last is
+        performed before the allreduces submitted before it."""
+        hvd.init()
+        # Tensors of different data types are not fused, so each one is
+        # reduced on its own and takes long enough for the order in which they
+        # complete to be observed. The allreduces of a trial may become ready in
+        # different cycles, so the order is checked over a few trials, on whose
+        # outcome all ranks agree.
+        dtypes = [torch.IntTensor, torch.LongTensor, torch.DoubleTensor,
+                  torch.FloatTensor]
+        for trial in range(3):
+            handles = []
+            for i, dtype in enumerate(dtypes):
+                tensor = dtype(1 << 20).fill_(1)
+                priority = 1 if i == len(dtypes) - 1 else 0
+                handles.append(hvd.allreduce_async(
+                    tensor, average=False, name='priority_order.%d' % i,
+                    priority=priority))
+            completed = []
+            while len(completed) < len(handles):
+                for handle in handles:
+                    if handle not in completed and hvd.poll(handle):
+                        completed.append(handle)
+            for handle in handles:
+                hvd.synchronize(handle)
+            high_first = torch.IntTensor([int(completed[0] == handles[-1])])
+            high_first = hvd.allreduce(high_first, op=hvd.Min).item()
+            if high_first:
+                break
+        assert high_first, 'hvd.allreduce does not perform tensors with a ' \
+                           'higher priority first'
+
     def test_horovod_allreduce_multi_gpu(self):
         """Test that the allreduce works on multiple GPUs."""
         # Only do this test if there are GPUs available.
@@ -320,6 +645,38 @@ class TorchTests(unittest.TestCase):
         except (torch.FatalError, RuntimeError):
             pass
 
+    def test_horovod_allreduce_op_error(self):
+        """Test that the allreduce raises an error if different ranks try to
+        reduce a tensor with different operations, or if the operation does not
+        apply to the tensor."""
+        hvd.init()
+        rank = hvd.rank()
+        size = hvd.size()
+
+        tensor = torch.FloatTensor(17, 17).random_(-100, 100)
+        try:
+            hvd.allreduce(tensor, op=hvd.BitwiseAnd)
+            assert False, 'hvd.allreduce did not throw error'
+        except (torch.FatalError, RuntimeError):
+            pass
+
+        try:
+            hvd.allreduce(tensor, average=True, op=hvd.Max)
+            assert False, 'hvd.allreduce did not throw error'
+        except ValueError:
+            pass
+
+        # This test does not apply if there is only one worker.
+        if size == 1:
+            return
+
+        op = hvd.Min if rank % 2 == 0 else hvd.Max
+        try:
+            hvd.allreduce(tensor, op=op)
+            assert False, 'hvd.allreduce did not throw error'
+        except (torch.FatalError, RuntimeError):
+            pass
+
     def test_horovod_allreduce_cpu_gpu_error(self):
         """Test that the allreduce raises an error if different ranks try to
         perform reduction on CPU and GPU."""
@@ -476,6 +833,45 @@ class TorchTests(unittest.TestCase):
                 assert rank_tensor.data.min() == i
                 assert rank_tensor.data.max() == i
 
+    def test_horovod_allgather_async_fused(self):
+        """Test that the allgather correctly gathers tensors of different data
+        types and sizes along the first dim that are submitted together, so
+        that they are fused."""
+        hvd.init()
+        rank = hvd.rank()
+        size = hvd.size()
+
+        dtypes = [torch.ByteTensor, torch.IntTensor, torch.LongTensor,
+                  torch.FloatTensor, torch.DoubleTensor]
+        if _fp16_supported:
+            dtypes += [torch.HalfTensor]
+        dims = [1, 2, 3]
+        tests = []
+        for i, (dtype, dim) in enumerate(itertools.product(dtypes, dims)):
+            # Every rank gathers a different number of rows, and rows hold
+            # different values, so that misplaced rows are detected.
+            first_dims = [r + 1 + i % 3 for r in range(size)]
+            tensor = self.allgather_rows(rank, first_dims[rank], dim)
+            handle = hvd.allgather_async(tensor.type(dtype),
+                                         name='allgather_fused.%d' % i)
+            tests.append((first_dims, dim, handle))
+
+        for first_dims, dim, handle in tests:
+            gathered = hvd.synchronize(handle)
+            gathered, = self.convert_cpu_fp16_to_fp32(gathered)
+            assert list(gathered.shape) == \
+                [sum(first_dims)] + [17] * (dim - 1), \
+                'hvd.allgather produces incorrect gathered shape'
+            offset = 0
+            for r, first_dim in enumerate(first_dims):
+                rank_tensor = gathered[offset:offset + first_dim]
+                expected = self.allgather_rows(r, first_dim, dim)
+                max_difference = rank_tensor.double().sub(
+                    expected.double()).abs().max()
+                assert max_difference == 0, \
+                    'hvd.allgather produces incorrect gathered tensor'
+                offset += first_dim
+
     def test_horovod_allgather_error(self):
         """Test that the allgather returns an error if any dimension besides
         the first is different among the tensors being gathered."""
@@ -634,6 +1030,47 @@ class TorchTests(unittest.TestCase):
             assert (broadcasted_tensor == root_tensor).min() == 1, \
                 'hvd.broadcast produces incorrect broadcasted tensor'
 
+    def test_horovod_allreduce_broadcast_in_flight(self):
+        """Test that many fused allreduces and broadcasts outstanding at once
+        produce correct results. CI also runs this test with
+        HOROVOD_MAX_IN_FLIGHT and HOROVOD_NUM_FUSION_BUFFERS set, so that
+        several fused operations are in flight at the same time."""
+        hvd.init()
+        rank = hvd.rank()
+        size = hvd.size()
+        # Tensors of different data types and broadcasts from different root
+        # ranks are fused into different operations.
+        dtypes = [torch.IntTensor, torch.LongTensor, torch.FloatTensor,
+                  torch.DoubleTensor]
+        allreduces = []
+        broadcasts = []
+        for i in range(10):
+            for j, dtype in enumerate(dtypes):
+                name = '%d.%d' % (i, j)
+                torch.manual_seed(1234 + i)
+                tensor = torch.FloatTensor(17 + i, 3).random_(-100, 100)
+                tensor = tensor.type(dtype)
+                handle = hvd.allreduce_async(
+                    tensor, average=False, name='in_flight.allreduce.' + name)
+                allreduces.append((tensor * size, handle))
+
+                root_rank = (i + j) % size
+                tensor = torch.FloatTensor(17 + i, 3).fill_(rank).type(dtype)
+                handle = hvd.broadcast_async(
+                    tensor, root_rank, name='in_flight.broadcast.' + name)
+                broadcasts.append((root_rank, handle))
+
+        for multiplied, handle in allreduces:
+            summed = hvd.synchronize(handle)
+            max_difference = summed.sub(multiplied).abs().max()
+            assert max_difference == 0, \
+                'hvd.allreduce produces incorrect results'
+        for root_rank, handle in broadcasts:
+            broadcasted = hvd.synchronize(handle)
+            assert broadcasted.min() == root_rank and \
+                broadcasted.max() == root_rank, \
+                'hvd.broadcast produces incorrect broadcasted tensor'
+
     def test_horovod_broadcast_error(self):
         """Test that the broadcast returns an error if any dimension besides
         the first is different among the tensors being broadcasted."""